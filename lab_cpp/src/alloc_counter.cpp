@@ -0,0 +1,93 @@
+#include "alloc_counter.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    // Полосы на отдельных кэш-линиях: потоки не толкаются на одном счетчике
+    constexpr unsigned STRIPES = 64;
+
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> count{0};
+    };
+
+    Stripe stripes[STRIPES];
+    std::atomic<unsigned> next_stripe{0};
+    thread_local unsigned stripe_of_thread = STRIPES;
+    thread_local uint64_t thread_count = 0;
+
+    void count_allocation() {
+        thread_count++;
+        if (stripe_of_thread == STRIPES) stripe_of_thread = next_stripe.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+        stripes[stripe_of_thread].count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* allocate(size_t size, size_t alignment, bool nothrow) {
+        count_allocation();
+        if (size == 0) size = 1;
+        for (;;) {
+            void* p;
+            if (alignment <= alignof(std::max_align_t)) {
+                p = std::malloc(size);
+            } else {
+#ifdef _WIN32
+                p = _aligned_malloc(size, alignment);
+#else
+                p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+            }
+            if (p) return p;
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) {
+                if (nothrow) return nullptr;
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+    void release(void* p, size_t alignment) {
+#ifdef _WIN32
+        if (alignment > alignof(std::max_align_t)) {
+            _aligned_free(p);
+            return;
+        }
+#else
+        (void)alignment;
+#endif
+        std::free(p);
+    }
+}
+
+uint64_t AllocationCounter::total() {
+    uint64_t sum = 0;
+    for (const Stripe& s : stripes) sum += s.count.load(std::memory_order_relaxed);
+    return sum;
+}
+
+uint64_t AllocationCounter::thread_total() {
+    return thread_count;
+}
+
+void* operator new(size_t size) { return allocate(size, 0, false); }
+void* operator new[](size_t size) { return allocate(size, 0, false); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0, true); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0, true); }
+void* operator new(size_t size, std::align_val_t al) { return allocate(size, (size_t)al, false); }
+void* operator new[](size_t size, std::align_val_t al) { return allocate(size, (size_t)al, false); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(size, (size_t)al, true); }
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(size, (size_t)al, true); }
+
+void operator delete(void* p) noexcept { release(p, 0); }
+void operator delete[](void* p) noexcept { release(p, 0); }
+void operator delete(void* p, size_t) noexcept { release(p, 0); }
+void operator delete[](void* p, size_t) noexcept { release(p, 0); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p, 0); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p, 0); }
+void operator delete(void* p, std::align_val_t al) noexcept { release(p, (size_t)al); }
+void operator delete[](void* p, std::align_val_t al) noexcept { release(p, (size_t)al); }
+void operator delete(void* p, size_t, std::align_val_t al) noexcept { release(p, (size_t)al); }
+void operator delete[](void* p, size_t, std::align_val_t al) noexcept { release(p, (size_t)al); }
+void operator delete(void* p, std::align_val_t al, const std::nothrow_t&) noexcept { release(p, (size_t)al); }
+void operator delete[](void* p, std::align_val_t al, const std::nothrow_t&) noexcept { release(p, (size_t)al); }
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+// Число выделений памяти в куче (все варианты operator new) с начала работы процесса.
+// Глобальные operator new/delete заменяются в alloc_counter.cpp, поэтому счетчик работает
+// только в программах, в которые этот файл слинкован
+namespace AllocationCounter {
+    uint64_t total();
+    // Только выделения вызывающего потока
+    uint64_t thread_total();
+}
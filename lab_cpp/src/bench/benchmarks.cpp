@@ -0,0 +1,142 @@
+#include "../fuzzy_matcher.hpp"
+#include "../set_ops.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <iterator>
+
+// Микробенчмарки ядра поиска на синтетических данных.
+// Размеры подобраны под корпус из README (~75 000 уникальных термов).
+
+template <class Func>
+double MeasureMicros(Func func, int iterations) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) func(i);
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+std::vector<std::string> MakeVocabulary(size_t size, std::mt19937& rng) {
+    static const std::vector<std::string> syllables = {
+        "ка", "ло", "ми", "на", "ро", "сти", "ва", "пре", "до", "за",
+        "ну", "ли", "ор", "те", "ба", "гу", "шо", "жи", "це", "фа"
+    };
+    std::uniform_int_distribution<size_t> syl(0, syllables.size() - 1);
+    std::uniform_int_distribution<int> len(2, 5);
+
+    std::vector<std::string> terms;
+    while (terms.size() < size * 2) {
+        std::string t;
+        int n = len(rng);
+        for (int k = 0; k < n; ++k) t += syllables[syl(rng)];
+        terms.push_back(t);
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    std::shuffle(terms.begin(), terms.end(), rng);
+    terms.resize(std::min(size, terms.size()));
+    std::sort(terms.begin(), terms.end());
+    return terms;
+}
+
+void BenchFuzzyLookup() {
+    std::mt19937 rng(42);
+    auto vocabulary = MakeVocabulary(75000, rng);
+
+    // Запросы - термы словаря с одной случайной заменой символа
+    std::vector<std::string> queries;
+    std::uniform_int_distribution<size_t> pick(0, vocabulary.size() - 1);
+    for (int i = 0; i < 200; ++i) {
+        std::string q = vocabulary[pick(rng)];
+        q.replace(0, 2, "ж");
+        queries.push_back(q);
+    }
+
+    std::cout << "Fuzzy lookup over " << vocabulary.size() << " terms" << std::endl;
+    for (int edits = 1; edits <= 2; ++edits) {
+        size_t visited = 0, found = 0;
+        double automaton_us = MeasureMicros([&](int i) {
+            FuzzyMatcher::Stats stats;
+            found += FuzzyMatcher(queries[i % queries.size()], edits).find(vocabulary, &stats).size();
+            visited += stats.visited_terms;
+        }, (int)queries.size());
+
+        double brute_us = MeasureMicros([&](int i) {
+            FuzzyMatcher(queries[i % queries.size()], edits).find_brute_force(vocabulary);
+        }, 20);
+
+        std::cout << "  d=" << edits << ": automaton " << std::fixed << std::setprecision(1) << automaton_us
+                  << " us/query (visited " << visited / queries.size() << " terms, "
+                  << (double)found / queries.size() << " matches), brute force " << brute_us << " us/query"
+                  << std::endl;
+    }
+}
+
+void BenchSetOperations() {
+    // Длинный список - 1M doc_id из 16M, короткий в ratio раз короче; std::set_* - прежняя реализация
+    std::mt19937 rng(42);
+    auto random_list = [&rng](size_t size) {
+        std::uniform_int_distribution<uint32_t> pick(0, 1 << 24);
+        std::vector<uint32_t> list(size);
+        for (auto& v : list) v = pick(rng);
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        return list;
+    };
+    const size_t LONG = 1 << 20;
+    auto a = random_list(LONG);
+    std::vector<uint32_t> out(2 * LONG + SetOps::OUTPUT_SLACK);
+
+    std::vector<SetOps::Kernel> kernels = {SetOps::Kernel::SCALAR};
+    if (SetOps::best_kernel() >= SetOps::Kernel::SSE42) kernels.push_back(SetOps::Kernel::SSE42);
+    if (SetOps::best_kernel() >= SetOps::Kernel::AVX2) kernels.push_back(SetOps::Kernel::AVX2);
+
+    std::cout << "\nSorted set operations, us/op (long list " << a.size() << " ids, best kernel: "
+              << SetOps::kernel_name(SetOps::best_kernel()) << ")" << std::endl;
+    std::cout << "  ratio  op    std::set_*";
+    for (auto kernel : kernels) std::cout << std::setw(10) << SetOps::kernel_name(kernel);
+    std::cout << std::endl;
+
+    for (size_t ratio : {1, 2, 8, 32, 128, 1024}) {
+        auto b = random_list(LONG / ratio);
+        int iterations = (int)std::max<size_t>(5, std::min<size_t>(200, ratio * 5));
+        for (const char* op : {"AND", "OR", "NOT"}) {
+            std::string name = op;
+            double baseline = MeasureMicros([&](int) {
+                std::vector<uint32_t> res;
+                if (name == "AND") std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
+                else if (name == "OR") std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
+                else std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
+            }, iterations);
+            std::cout << "  1:" << std::left << std::setw(5) << ratio << std::setw(5) << op << std::right
+                      << std::fixed << std::setprecision(1) << std::setw(10) << baseline;
+            for (auto kernel : kernels) {
+                SetOps::set_kernel(kernel);
+                double us = MeasureMicros([&](int) {
+                    if (name == "AND") SetOps::intersect(a.data(), a.size(), b.data(), b.size(), out.data());
+                    else if (name == "OR") SetOps::unite(a.data(), a.size(), b.data(), b.size(), out.data());
+                    else SetOps::difference(a.data(), a.size(), b.data(), b.size(), out.data());
+                }, iterations);
+                std::cout << std::setw(10) << us;
+            }
+            std::cout << std::endl;
+        }
+    }
+    SetOps::set_kernel(SetOps::best_kernel());
+}
+
+int main() {
+#ifdef _WIN32
+    system("chcp 65001 > nul");
+#endif
+
+    std::cout << "=== BENCHMARKS ===" << std::endl;
+    BenchFuzzyLookup();
+    BenchSetOperations();
+
+    return 0;
+}
@@ -18,13 +18,35 @@ namespace BinaryUtils {
         out.write(reinterpret_cast<const char*>(&val), sizeof(val));
     }
 
+    inline void write_u64(std::ofstream& out, uint64_t val) {
+        out.write(reinterpret_cast<const char*>(&val), sizeof(val));
+    }
+
     inline void write_string(std::ofstream& out, const std::string& str) {
         out.write(str.data(), str.size());
     }
     
+    inline uint8_t read_u8(std::ifstream& in) {
+        uint8_t val = 0;
+        in.read(reinterpret_cast<char*>(&val), sizeof(val));
+        return val;
+    }
+
+    inline uint16_t read_u16(std::ifstream& in) {
+        uint16_t val = 0;
+        in.read(reinterpret_cast<char*>(&val), sizeof(val));
+        return val;
+    }
+
     inline uint32_t read_u32(std::ifstream& in) {
         uint32_t val;
         in.read(reinterpret_cast<char*>(&val), sizeof(val));
         return val;
     }
+
+    inline uint64_t read_u64(std::ifstream& in) {
+        uint64_t val = 0;
+        in.read(reinterpret_cast<char*>(&val), sizeof(val));
+        return val;
+    }
 }
\ No newline at end of file
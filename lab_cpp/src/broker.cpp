@@ -0,0 +1,397 @@
+#include "broker.hpp"
+#include <iostream>
+#include <exception>
+#include <iterator>
+#include <algorithm>
+#include <map>
+
+ShardBroker::~ShardBroker() {
+    {
+        std::lock_guard<std::mutex> lock(reload_thread_mutex);
+        if (reload_thread.joinable()) reload_thread.join();
+    }
+    std::atomic_store(&current, std::shared_ptr<IndexSnapshot>());
+    free_retired();
+}
+
+ShardBroker::IndexSnapshot::~IndexSnapshot() {
+    for (auto& shard : shards) {
+        if (!shard->worker.joinable()) continue;
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->stop = true;
+        }
+        shard->cv.notify_one();
+        shard->worker.join();
+    }
+}
+
+void ShardBroker::load_index(const std::string& index_dir) {
+    std::atomic_store(&current, build_snapshot(index_dir));
+    generation_counter++;
+    free_retired();
+}
+
+void ShardBroker::free_retired(const IndexSnapshot* wait_for) {
+    std::vector<IndexSnapshot*> snaps;
+    {
+        std::unique_lock<std::mutex> lock(retire_mutex);
+        if (wait_for) {
+            retire_cv.wait(lock, [&] { return std::find(retired.begin(), retired.end(), wait_for) != retired.end(); });
+        }
+        snaps.swap(retired);
+    }
+    for (IndexSnapshot* snap : snaps) delete snap;
+}
+
+std::shared_ptr<ShardBroker::IndexSnapshot> ShardBroker::build_snapshot(const std::string& index_dir) const {
+    SearchOptions opt;
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        opt = options;
+    }
+
+    auto snap = std::make_unique<IndexSnapshot>();
+    snap->index_dir = index_dir;
+    std::vector<ShardInfo> manifest = ShardManifest::read(index_dir);
+
+    if (manifest.empty()) {
+        auto shard = std::make_unique<Shard>();
+        shard->engine.load_index(index_dir);
+        shard->engine.set_options(opt);
+        shard->info = {0, shard->engine.get_total_docs()};
+        snap->shards.push_back(std::move(shard));
+        return share(std::move(snap));
+    }
+
+    std::cerr << "Broker mode: " << manifest.size() << " shards." << std::endl;
+    for (uint32_t k = 0; k < manifest.size(); ++k) {
+        auto shard = std::make_unique<Shard>();
+        shard->info = manifest[k];
+        shard->engine.load_index(ShardManifest::shard_dir(index_dir, k));
+        shard->engine.set_options(opt);
+        if (shard->engine.get_total_docs() != shard->info.doc_count) {
+            throw std::runtime_error("Shard " + std::to_string(k) + " does not match shards manifest");
+        }
+        // Шарды публикуются по очереди: часть из них может быть уже от новой сборки
+        if (k > 0 && shard->engine.get_build_id() != snap->shards[0]->engine.get_build_id()) {
+            throw std::runtime_error("Mixed index generation in " + index_dir + ": shard " + std::to_string(k) +
+                                     " is from another build (index is being rebuilt?)");
+        }
+        snap->shards.push_back(std::move(shard));
+    }
+
+    // Шард 0 выполняется в вызывающем потоке, остальным нужны рабочие потоки
+    for (size_t k = 1; k < snap->shards.size(); ++k) {
+        Shard& shard = *snap->shards[k];
+        shard.worker = std::thread(&ShardBroker::worker_loop, std::ref(shard));
+    }
+    return share(std::move(snap));
+}
+
+std::shared_ptr<ShardBroker::IndexSnapshot> ShardBroker::share(std::unique_ptr<IndexSnapshot> snap) const {
+    return std::shared_ptr<IndexSnapshot>(snap.release(), [this](IndexSnapshot* retired_snap) {
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        retired.push_back(retired_snap);
+        retire_cv.notify_all();
+    });
+}
+
+bool ShardBroker::start_reload(const std::string& index_dir) {
+    // reloading сбрасывается в конце run_reload, до выхода из потока: следующий вызов
+    // может прийти, пока прошлый еще присваивает reload_thread, поэтому join под мьютексом
+    std::lock_guard<std::mutex> lock(reload_thread_mutex);
+    if (reloading.exchange(true)) return false;
+    if (reload_thread.joinable()) reload_thread.join();
+
+    std::string dir = index_dir.empty() ? snapshot()->index_dir : index_dir;
+    reload_thread = std::thread(&ShardBroker::run_reload, this, dir);
+    return true;
+}
+
+void ShardBroker::run_reload(const std::string& index_dir) {
+    try {
+        std::shared_ptr<IndexSnapshot> fresh = build_snapshot(index_dir);
+        std::shared_ptr<IndexSnapshot> old = std::atomic_exchange(&current, fresh);
+        fresh.reset();
+        generation_counter++;
+        {
+            std::lock_guard<std::mutex> lock(reload_mutex);
+            reload_error.clear();
+        }
+        std::cerr << "Index reloaded from " << index_dir << " (generation " << generation() << ")." << std::endl;
+
+        // После подмены новых ссылок на старый снимок не появляется: последний из запросов,
+        // начатых до нее, кладет его в retired, а освобождается он здесь, а не в потоке запроса
+        const IndexSnapshot* old_raw = old.get();
+        old.reset();
+        free_retired(old_raw);
+    } catch (const std::exception& e) {
+        std::cerr << "Reload failed, keeping current index: " << e.what() << std::endl;
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        reload_error = e.what();
+    }
+    reloading = false;
+}
+
+std::string ShardBroker::last_reload_error() const {
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    return reload_error;
+}
+
+void ShardBroker::worker_loop(Shard& shard) {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            shard.cv.wait(lock, [&shard] { return shard.stop || !shard.jobs.empty(); });
+            if (shard.jobs.empty()) return;
+            job = std::move(shard.jobs.front());
+            shard.jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void ShardBroker::IndexSnapshot::fan_out(const std::function<void(size_t)>& fn) {
+    if (shards.size() == 1) {
+        fn(0);
+        return;
+    }
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t remaining = shards.size() - 1;
+    std::exception_ptr error;
+
+    for (size_t k = 1; k < shards.size(); ++k) {
+        Shard& shard = *shards[k];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.jobs.push_back([&, k] {
+                std::exception_ptr job_error;
+                try {
+                    fn(k);
+                } catch (...) {
+                    job_error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> done_lock(done_mutex);
+                if (job_error && !error) error = job_error;
+                if (--remaining == 0) done_cv.notify_one();
+            });
+        }
+        shard.cv.notify_one();
+    }
+
+    std::exception_ptr local_error;
+    try {
+        fn(0);
+    } catch (...) {
+        local_error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&remaining] { return remaining == 0; });
+    if (local_error) std::rethrow_exception(local_error);
+    if (error) std::rethrow_exception(error);
+}
+
+size_t ShardBroker::shard_count() const {
+    return snapshot()->shards.size();
+}
+
+uint32_t ShardBroker::get_total_docs() const {
+    uint32_t total = 0;
+    for (const auto& shard : snapshot()->shards) total += shard->info.doc_count;
+    return total;
+}
+
+void ShardBroker::set_options(const SearchOptions& opt) {
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        options = opt;
+    }
+    for (auto& shard : snapshot()->shards) shard->engine.set_options(opt);
+}
+
+MemoryUsage ShardBroker::memory_usage() const {
+    MemoryUsage total;
+    for (const auto& shard : snapshot()->shards) total += shard->engine.memory_usage();
+    return total;
+}
+
+size_t ShardBroker::merge_status(const IndexSnapshot& snap, const QueryStatus* shard_status, size_t count,
+                                 QueryStatus* status) {
+    QueryStatus merged;
+    size_t used = count;
+    for (size_t k = 0; k < count; ++k) {
+        const QueryStatus& st = shard_status[k];
+        merged.estimated_cost += st.estimated_cost;
+        merged.postings_touched += st.postings_touched;
+        if (used == count && st.partial) {
+            merged.partial = true;
+            merged.reason = st.reason;
+            merged.docs_covered = snap.shards[k]->info.doc_base + st.docs_covered;
+            used = k + 1;
+        }
+    }
+    if (!merged.partial) {
+        for (const auto& shard : snap.shards) merged.docs_covered += shard->info.doc_count;
+    }
+    if (status) *status = merged;
+    return used;
+}
+
+std::vector<SearchResult> ShardBroker::search(const std::string& query, QueryStatus* status,
+                                              const std::atomic<bool>* cancel) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    std::vector<std::vector<SearchResult>> partial(snap->shards.size());
+    std::vector<QueryStatus> shard_status(snap->shards.size());
+
+    snap->fan_out([&](size_t k) {
+        Shard& shard = *snap->shards[k];
+        partial[k] = shard.engine.search(query, &shard_status[k], cancel);
+        for (auto& r : partial[k]) r.doc_id += shard.info.doc_base;
+    });
+    partial.resize(merge_status(*snap, shard_status.data(), shard_status.size(), status));
+
+    // Диапазоны id шардов не пересекаются и идут по возрастанию: склейка сохраняет порядок
+    size_t total = 0;
+    for (const auto& p : partial) total += p.size();
+
+    std::vector<SearchResult> results;
+    results.reserve(total);
+    for (auto& p : partial) {
+        std::move(p.begin(), p.end(), std::back_inserter(results));
+    }
+    return results;
+}
+
+std::vector<uint32_t> ShardBroker::search_ids(const std::string& query, QueryStatus* status,
+                                              const std::atomic<bool>* cancel) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    std::vector<std::vector<uint32_t>> partial(snap->shards.size());
+    std::vector<QueryStatus> shard_status(snap->shards.size());
+
+    snap->fan_out([&](size_t k) {
+        Shard& shard = *snap->shards[k];
+        partial[k] = shard.engine.search_ids(query, &shard_status[k], cancel);
+        for (auto& id : partial[k]) id += shard.info.doc_base;
+    });
+    partial.resize(merge_status(*snap, shard_status.data(), shard_status.size(), status));
+
+    if (partial.size() == 1) return std::move(partial[0]);
+    std::vector<uint32_t> ids;
+    for (const auto& p : partial) ids.insert(ids.end(), p.begin(), p.end());
+    return ids;
+}
+
+void ShardBroker::search(const std::string& query, std::vector<SearchResult>& results, QueryStatus* status,
+                         const std::atomic<bool>* cancel) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    if (snap->shards.size() != 1) {
+        results = search(query, status, cancel);
+        return;
+    }
+    // Один шард: fan_out все равно выполнил бы запрос в этом потоке
+    Shard& shard = *snap->shards[0];
+    QueryStatus shard_status;
+    shard.engine.search(query, results, &shard_status, cancel);
+    for (auto& r : results) r.doc_id += shard.info.doc_base;
+    merge_status(*snap, &shard_status, 1, status);
+}
+
+void ShardBroker::search_ids(const std::string& query, std::vector<uint32_t>& doc_ids, QueryStatus* status,
+                             const std::atomic<bool>* cancel) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    if (snap->shards.size() != 1) {
+        doc_ids = search_ids(query, status, cancel);
+        return;
+    }
+    Shard& shard = *snap->shards[0];
+    QueryStatus shard_status;
+    shard.engine.search_ids(query, doc_ids, &shard_status, cancel);
+    for (auto& id : doc_ids) id += shard.info.doc_base;
+    merge_status(*snap, &shard_status, 1, status);
+}
+
+std::vector<RankedResult> ShardBroker::search_top_k(const std::string& query, size_t k,
+                                                    ImpactIndex::TopKStats* stats) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    std::vector<std::vector<RankedResult>> partial(snap->shards.size());
+    std::vector<ImpactIndex::TopKStats> shard_stats(snap->shards.size());
+
+    snap->fan_out([&](size_t s) {
+        Shard& shard = *snap->shards[s];
+        partial[s] = shard.engine.search_top_k(query, k, &shard_stats[s]);
+        for (auto& r : partial[s]) r.doc_id += shard.info.doc_base;
+    });
+
+    std::vector<RankedResult> results;
+    for (auto& p : partial) std::move(p.begin(), p.end(), std::back_inserter(results));
+    std::sort(results.begin(), results.end(), [](const RankedResult& a, const RankedResult& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.doc_id < b.doc_id;
+    });
+    if (results.size() > k) results.resize(k);
+
+    if (stats) {
+        *stats = ImpactIndex::TopKStats();
+        stats->early_terminated = true;
+        for (const auto& st : shard_stats) {
+            stats->postings_scored += st.postings_scored;
+            stats->postings_total += st.postings_total;
+            stats->early_terminated = stats->early_terminated && st.early_terminated;
+        }
+    }
+    return results;
+}
+
+std::vector<CompletionIndex::Suggestion> ShardBroker::complete(const std::string& prefix, size_t k) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    std::vector<std::vector<CompletionIndex::Suggestion>> partial(snap->shards.size());
+    snap->fan_out([&](size_t s) { partial[s] = snap->shards[s]->engine.complete(prefix, k); });
+    if (partial.size() == 1) return std::move(partial[0]);
+
+    std::map<std::string, uint32_t> merged;
+    for (const auto& p : partial) {
+        for (const auto& suggestion : p) merged[suggestion.word] += suggestion.doc_freq;
+    }
+    std::vector<CompletionIndex::Suggestion> results;
+    for (const auto& m : merged) results.push_back({m.first, m.second});
+    std::stable_sort(results.begin(), results.end(), [](const auto& a, const auto& b) { return a.doc_freq > b.doc_freq; });
+    if (results.size() > k) results.resize(k);
+    return results;
+}
+
+std::optional<std::string> ShardBroker::get_title(uint32_t doc_id) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    uint32_t local_id;
+    Shard* shard = snap->shard_of(doc_id, local_id);
+    if (!shard) return std::nullopt;
+    return shard->engine.get_title(local_id);
+}
+
+ShardBroker::Shard* ShardBroker::IndexSnapshot::shard_of(uint32_t doc_id, uint32_t& local_id) {
+    for (auto& shard : shards) {
+        if (doc_id >= shard->info.doc_base && doc_id - shard->info.doc_base < shard->info.doc_count) {
+            local_id = doc_id - shard->info.doc_base;
+            return shard.get();
+        }
+    }
+    return nullptr;
+}
+
+std::string ShardBroker::get_document(uint32_t doc_id) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    uint32_t local_id;
+    Shard* shard = snap->shard_of(doc_id, local_id);
+    return shard ? shard->engine.get_document(local_id) : "";
+}
+
+std::string ShardBroker::make_snippet(uint32_t doc_id, const std::vector<std::string>& terms) {
+    std::shared_ptr<IndexSnapshot> snap = snapshot();
+    uint32_t local_id;
+    Shard* shard = snap->shard_of(doc_id, local_id);
+    return shard ? shard->engine.make_snippet(local_id, terms) : "";
+}
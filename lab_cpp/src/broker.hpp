@@ -0,0 +1,121 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <optional>
+#include "search_engine.hpp"
+#include "shard_manifest.hpp"
+
+// Scatter-gather поверх шардов: каждый шард - отдельный SearchEngine со своим
+// рабочим потоком. Запрос рассылается всем шардам, результаты склеиваются
+// в порядке шардов с переводом локальных id в глобальные.
+// Нешардированный индекс обслуживается как один шард без рабочего потока.
+//
+// Загруженный индекс - неизменяемый снимок под shared_ptr. Запрос берет ссылку
+// на текущий снимок и работает с ней до конца; перезагрузка собирает новый
+// снимок в фоне и атомарно подменяет указатель. Поток, отпустивший последнюю
+// ссылку на старый снимок, только передает его в очередь retired, а освобождает
+// (останавливает рабочие потоки, снимает отображения) поток перезагрузки.
+class ShardBroker {
+public:
+    ShardBroker() = default;
+    ShardBroker(const ShardBroker&) = delete;
+    ShardBroker& operator=(const ShardBroker&) = delete;
+    ~ShardBroker();
+
+    void load_index(const std::string& index_dir);
+
+    // Фоновая перезагрузка (пустой путь - текущий каталог индекса).
+    // Возвращает false, если перезагрузка уже идет.
+    bool start_reload(const std::string& index_dir = "");
+    bool is_reloading() const { return reloading.load(); }
+    uint64_t generation() const { return generation_counter.load(); }
+    std::string last_reload_error() const;
+
+    size_t shard_count() const;
+    uint32_t get_total_docs() const;
+    void set_options(const SearchOptions& opt);
+    MemoryUsage memory_usage() const;
+
+    // Лимиты запроса действуют в каждом шарде отдельно. Если какой-то шард вернул
+    // частичный ответ, результаты обрезаются по нему: ответ полон для префикса
+    // глобальных doc_id длины status->docs_covered
+    std::vector<SearchResult> search(const std::string& query, QueryStatus* status = nullptr,
+                                     const std::atomic<bool>* cancel = nullptr);
+    std::vector<uint32_t> search_ids(const std::string& query, QueryStatus* status = nullptr,
+                                     const std::atomic<bool>* cancel = nullptr);
+    // То же в буферы вызывающего: с одним шардом без промежуточных копий и обращений к куче
+    void search(const std::string& query, std::vector<SearchResult>& results, QueryStatus* status = nullptr,
+                const std::atomic<bool>* cancel = nullptr);
+    void search_ids(const std::string& query, std::vector<uint32_t>& doc_ids, QueryStatus* status = nullptr,
+                    const std::atomic<bool>* cancel = nullptr);
+    // Лучшие k по всем шардам; BM25 считается по статистике каждого шарда.
+    // Заголовки берутся из того же снимка, по которому ранжировали
+    std::vector<RankedResult> search_top_k(const std::string& query, size_t k,
+                                           ImpactIndex::TopKStats* stats = nullptr);
+    // Подсказки всех шардов складываются по словоформе; у каждого шарда берутся его top-k,
+    // поэтому doc_freq редкой в отдельных шардах словоформы может быть занижен
+    std::vector<CompletionIndex::Suggestion> complete(const std::string& prefix, size_t k);
+    // Копия заголовка из текущего снимка; пусто, если документа нет
+    std::optional<std::string> get_title(uint32_t doc_id);
+    std::string get_document(uint32_t doc_id);
+    std::string make_snippet(uint32_t doc_id, const std::vector<std::string>& terms);
+
+private:
+    struct Shard {
+        ShardInfo info;
+        SearchEngine engine;
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> jobs;
+        bool stop = false;
+    };
+
+    struct IndexSnapshot {
+        std::string index_dir;
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        ~IndexSnapshot();
+        void fan_out(const std::function<void(size_t shard)>& fn);
+        Shard* shard_of(uint32_t doc_id, uint32_t& local_id);
+    };
+
+    // Сводит статусы шардов; возвращает число шардов, результаты которых входят в ответ
+    static size_t merge_status(const IndexSnapshot& snap, const QueryStatus* shard_status, size_t count,
+                               QueryStatus* status);
+
+    // Снимки без ссылок ждут освобождения; объявлены до current, чтобы пережить его
+    mutable std::mutex retire_mutex;
+    mutable std::condition_variable retire_cv;
+    mutable std::vector<IndexSnapshot*> retired;
+
+    // Доступ только через std::atomic_load / std::atomic_store
+    std::shared_ptr<IndexSnapshot> current;
+    SearchOptions options;
+
+    // Поток перезагрузки запускают и ждут разные потоки (SIGHUP, :reload, search_reload)
+    std::mutex reload_thread_mutex;
+    std::thread reload_thread;
+    std::atomic<bool> reloading{false};
+    std::atomic<uint64_t> generation_counter{0};
+    mutable std::mutex reload_mutex;
+    std::string reload_error;
+
+    std::shared_ptr<IndexSnapshot> snapshot() const { return std::atomic_load(&current); }
+    std::shared_ptr<IndexSnapshot> build_snapshot(const std::string& index_dir) const;
+    // shared_ptr, который при обнулении счетчика кладет снимок в retired вместо удаления
+    std::shared_ptr<IndexSnapshot> share(std::unique_ptr<IndexSnapshot> snap) const;
+    void run_reload(const std::string& index_dir);
+    // Освобождает снимки из retired; с wait_for - сначала дожидается, пока туда попадет этот
+    void free_retired(const IndexSnapshot* wait_for = nullptr);
+
+    static void worker_loop(Shard& shard);
+};
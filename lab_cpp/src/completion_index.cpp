@@ -0,0 +1,194 @@
+#include "completion_index.hpp"
+#include "binary_utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const size_t HEADER_BYTES = 6 * 4;
+
+    struct BuildNode {
+        uint32_t lo, hi;      // диапазон словоформ поддерева в отсортированном списке
+        uint32_t label_begin; // метка - байты [label_begin, depth) словоформы lo
+        uint32_t depth;
+        uint32_t first_child = 0;
+        uint32_t child_count = 0;
+        std::vector<uint32_t> top;
+
+        BuildNode(uint32_t range_lo, uint32_t range_hi, uint32_t label_from, uint32_t label_end)
+            : lo(range_lo), hi(range_hi), label_begin(label_from), depth(label_end) {}
+    };
+}
+
+void CompletionIndex::write(const std::string& filename, std::vector<std::pair<std::string, uint32_t>> word_dfs) {
+    std::sort(word_dfs.begin(), word_dfs.end());
+    // Повторы словоформы складываются
+    size_t unique = 0;
+    for (size_t i = 0; i < word_dfs.size(); ++i) {
+        if (word_dfs[i].first.empty()) continue;
+        if (unique > 0 && word_dfs[unique - 1].first == word_dfs[i].first) word_dfs[unique - 1].second += word_dfs[i].second;
+        else {
+            if (unique != i) word_dfs[unique] = std::move(word_dfs[i]);
+            unique++;
+        }
+    }
+    word_dfs.resize(unique);
+    auto better = [&word_dfs](uint32_t a, uint32_t b) {
+        if (word_dfs[a].second != word_dfs[b].second) return word_dfs[a].second > word_dfs[b].second;
+        return a < b;
+    };
+
+    // 1. Узлы в порядке обхода в ширину: дети узла добавляются подряд. Все словоформы
+    // узла делят префикс длины depth; словоформа, равная префиксу, идет первой
+    std::vector<BuildNode> nodes;
+    nodes.emplace_back(0, (uint32_t)word_dfs.size(), 0, 0);
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        uint32_t lo = nodes[n].lo, hi = nodes[n].hi, depth = nodes[n].depth;
+        uint32_t i = lo;
+        if (i < hi && word_dfs[i].first.size() == depth) i++;
+        nodes[n].first_child = (uint32_t)nodes.size();
+        while (i < hi) {
+            char byte = word_dfs[i].first[depth];
+            uint32_t j = i;
+            while (j < hi && word_dfs[j].first[depth] == byte) j++;
+            // Общий префикс диапазона - общий префикс его крайних словоформ
+            const std::string& first = word_dfs[i].first;
+            const std::string& last = word_dfs[j - 1].first;
+            uint32_t common = depth + 1;
+            while (common < first.size() && common < last.size() && first[common] == last[common]) common++;
+            nodes.emplace_back(i, j, depth, common);
+            nodes[n].child_count++;
+            i = j;
+        }
+    }
+
+    // 2. Списки лучших снизу вверх: у детей номера больше, чем у родителя
+    for (size_t n = nodes.size(); n-- > 0;) {
+        BuildNode& node = nodes[n];
+        std::vector<uint32_t> candidates;
+        if (node.lo < node.hi && word_dfs[node.lo].first.size() == node.depth) candidates.push_back(node.lo);
+        for (uint32_t c = node.first_child; c < node.first_child + node.child_count; ++c) {
+            candidates.insert(candidates.end(), nodes[c].top.begin(), nodes[c].top.end());
+        }
+        size_t keep = std::min<size_t>(TOP_K, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(), better);
+        candidates.resize(keep);
+        node.top = std::move(candidates);
+    }
+
+    std::ofstream out(filename, std::ios::binary);
+    uint32_t top_total = 0;
+    for (const auto& node : nodes) top_total += (uint32_t)node.top.size();
+    BinaryUtils::write_u32(out, SIGNATURE);
+    BinaryUtils::write_u32(out, VERSION);
+    BinaryUtils::write_u32(out, (uint32_t)nodes.size());
+    BinaryUtils::write_u32(out, (uint32_t)word_dfs.size());
+    BinaryUtils::write_u32(out, top_total);
+    BinaryUtils::write_u32(out, TOP_K);
+
+    for (const auto& node : nodes) BinaryUtils::write_u32(out, node.first_child);
+    BinaryUtils::write_u32(out, (uint32_t)nodes.size());
+    uint32_t offset = 0;
+    for (const auto& node : nodes) {
+        BinaryUtils::write_u32(out, offset);
+        offset += node.depth - node.label_begin;
+    }
+    BinaryUtils::write_u32(out, offset);
+    offset = 0;
+    for (const auto& node : nodes) {
+        BinaryUtils::write_u32(out, offset);
+        offset += (uint32_t)node.top.size();
+    }
+    BinaryUtils::write_u32(out, offset);
+    for (const auto& node : nodes) {
+        for (uint32_t w : node.top) BinaryUtils::write_u32(out, w);
+    }
+    offset = 0;
+    for (const auto& w : word_dfs) {
+        BinaryUtils::write_u32(out, offset);
+        offset += (uint32_t)w.first.size();
+    }
+    BinaryUtils::write_u32(out, offset);
+    for (const auto& w : word_dfs) BinaryUtils::write_u32(out, w.second);
+    for (const auto& node : nodes) {
+        out.write(word_dfs[node.lo].first.data() + node.label_begin, node.depth - node.label_begin);
+    }
+    for (const auto& w : word_dfs) out.write(w.first.data(), w.first.size());
+}
+
+void CompletionIndex::open(const std::string& filename) {
+    close();
+    file.open(filename);
+
+    const char* data = file.data();
+    auto u32_at = [data](size_t pos) { return reinterpret_cast<const uint32_t*>(data + pos); };
+    if (file.size() < HEADER_BYTES || *u32_at(0) != SIGNATURE || *u32_at(4) != VERSION) {
+        close();
+        throw std::runtime_error("Invalid completion index signature");
+    }
+    nodes = *u32_at(8);
+    words = *u32_at(12);
+    uint64_t top_total = *u32_at(16);
+
+    uint64_t pos = HEADER_BYTES;
+    child_begin = u32_at(pos);
+    pos += (nodes + 1) * 4ULL;
+    label_offset = u32_at(pos);
+    pos += (nodes + 1) * 4ULL;
+    top_begin = u32_at(pos);
+    pos += (nodes + 1) * 4ULL;
+    top = u32_at(pos);
+    pos += top_total * 4;
+    word_offset = u32_at(pos);
+    pos += (words + 1) * 4ULL;
+    word_df = u32_at(pos);
+    pos += words * 4ULL;
+
+    if (nodes == 0 || pos > file.size() || pos + label_offset[nodes] > file.size() || top_begin[nodes] != top_total) {
+        close();
+        throw std::runtime_error("Corrupted completion index");
+    }
+    labels = data + pos;
+    pos += label_offset[nodes];
+    pool = data + pos;
+    if (pos + word_offset[words] > file.size()) {
+        close();
+        throw std::runtime_error("Corrupted completion index");
+    }
+}
+
+void CompletionIndex::close() {
+    file.close();
+    nodes = words = 0;
+}
+
+std::vector<CompletionIndex::Suggestion> CompletionIndex::complete(const std::string& prefix, size_t k) const {
+    if (!is_open()) return {};
+
+    // Спуск по префиксу; префикс может закончиться посреди метки узла
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < prefix.size()) {
+        unsigned char byte = (unsigned char)prefix[pos];
+        uint32_t lo = child_begin[node], hi = child_begin[node + 1];
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if ((unsigned char)labels[label_offset[mid]] < byte) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == child_begin[node + 1] || (unsigned char)labels[label_offset[lo]] != byte) return {};
+
+        size_t label_len = label_offset[lo + 1] - label_offset[lo];
+        size_t len = std::min(label_len, prefix.size() - pos);
+        if (std::memcmp(labels + label_offset[lo], prefix.data() + pos, len) != 0) return {};
+        node = lo;
+        pos += len;
+    }
+
+    std::vector<Suggestion> result;
+    for (uint32_t i = top_begin[node]; i < top_begin[node + 1] && result.size() < k; ++i) {
+        uint32_t w = top[i];
+        result.push_back({std::string(pool + word_offset[w], word_offset[w + 1] - word_offset[w]), word_df[w]});
+    }
+    return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "mapped_file.hpp"
+
+// Автодополнение по словоформам корпуса (completion.bin).
+//
+// Сжатое префиксное дерево (radix trie) над байтами словоформ: у каждого узла
+// заранее посчитан список до TOP_K лучших словоформ поддерева по doc_freq.
+// Запрос - спуск по префиксу (двоичный поиск среди детей по первому байту метки)
+// и чтение готового списка узла, поддерево не просматривается.
+//
+// Формат (все массивы выровнены, читаются из отображения на месте):
+// заголовок из 6 x u32: сигнатура, версия, N узлов, W слов, E элементов списков, TOP_K;
+// узлы пронумерованы в ширину, поэтому дети узла - непрерывный диапазон:
+// u32 child_begin[N + 1]; u32 label_offset[N + 1]; u32 top_begin[N + 1];
+// u32 top[E] (id словоформ по убыванию doc_freq); u32 word_offset[W + 1];
+// u32 word_df[W]; байты меток; байты словоформ.
+class CompletionIndex {
+public:
+    static constexpr uint32_t SIGNATURE = 0x504D4F43;
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t TOP_K = 10;
+
+    struct Suggestion {
+        std::string word;
+        uint32_t doc_freq;
+    };
+
+    // words: словоформа и число документов, в которых она встречается
+    static void write(const std::string& filename, std::vector<std::pair<std::string, uint32_t>> words);
+
+    void open(const std::string& filename);
+    void close();
+    bool is_open() const { return file.is_open(); }
+
+    // До k (не больше TOP_K) словоформ с префиксом prefix по убыванию doc_freq
+    std::vector<Suggestion> complete(const std::string& prefix, size_t k) const;
+
+    uint32_t node_count() const { return nodes; }
+    uint32_t word_count() const { return words; }
+    size_t mapped_bytes() const { return file.size(); }
+
+private:
+    MappedFile file;
+    uint32_t nodes = 0;
+    uint32_t words = 0;
+    const uint32_t* child_begin = nullptr;
+    const uint32_t* label_offset = nullptr;
+    const uint32_t* top_begin = nullptr;
+    const uint32_t* top = nullptr;
+    const uint32_t* word_offset = nullptr;
+    const uint32_t* word_df = nullptr;
+    const char* labels = nullptr;
+    const char* pool = nullptr;
+};
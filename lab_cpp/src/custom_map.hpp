@@ -31,16 +31,20 @@ public:
     }
 
     void increment(const std::string& key) {
+        add(key, 1);
+    }
+
+    void add(const std::string& key, int count) {
         size_t index = get_hash(key) % table_size;
         
         for (auto& node : buckets[index]) {
             if (node.key == key) {
-                node.value++;
+                node.value += count;
                 return;
             }
         }
         
-        buckets[index].emplace_back(key, 1);
+        buckets[index].emplace_back(key, count);
         element_count++;
     }
 
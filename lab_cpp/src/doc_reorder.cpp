@@ -0,0 +1,223 @@
+#include "doc_reorder.hpp"
+#include "postings_codecs.hpp"
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+    uint64_t mix64(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Оценка числа бит на d-gaps терма со степенью d в части из n документов
+    double log_gap_cost(int32_t d, double n) {
+        return d > 0 ? d * std::log2(n / (d + 1)) : 0.0;
+    }
+
+    // Степени термов в левой/правой половине; переиспользуются между узлами рекурсии,
+    // обнуляются только затронутые термы
+    struct Workspace {
+        std::vector<int32_t> left_deg;
+        std::vector<int32_t> right_deg;
+        std::vector<double> gain_to_right;
+        std::vector<double> gain_to_left;
+        std::vector<uint32_t> touched;
+
+        explicit Workspace(uint32_t term_count)
+            : left_deg(term_count, 0), right_deg(term_count, 0),
+              gain_to_right(term_count, 0), gain_to_left(term_count, 0) {}
+    };
+
+    // Половины обрабатываются в отдельных потоках на верхних уровнях рекурсии
+    const int PARALLEL_DEPTH = 3;
+
+    void bisect(uint32_t* docs, size_t count, const std::vector<std::vector<uint32_t>>& doc_terms,
+                uint32_t term_count, Workspace& ws, int iterations, uint32_t min_partition, int depth) {
+        if (count <= min_partition) return;
+
+        size_t half = count / 2;
+        uint32_t* left = docs;
+        uint32_t* right = docs + half;
+        size_t right_count = count - half;
+        double n_left = (double)half, n_right = (double)right_count;
+
+        std::vector<std::pair<double, uint32_t>> left_gains(half), right_gains(right_count);
+
+        for (int iter = 0; iter < iterations; ++iter) {
+            for (size_t i = 0; i < half; ++i) {
+                for (uint32_t t : doc_terms[left[i]]) {
+                    if (ws.left_deg[t] == 0 && ws.right_deg[t] == 0) ws.touched.push_back(t);
+                    ws.left_deg[t]++;
+                }
+            }
+            for (size_t i = 0; i < right_count; ++i) {
+                for (uint32_t t : doc_terms[right[i]]) {
+                    if (ws.left_deg[t] == 0 && ws.right_deg[t] == 0) ws.touched.push_back(t);
+                    ws.right_deg[t]++;
+                }
+            }
+
+            for (uint32_t t : ws.touched) {
+                int32_t dl = ws.left_deg[t], dr = ws.right_deg[t];
+                double cost = log_gap_cost(dl, n_left) + log_gap_cost(dr, n_right);
+                ws.gain_to_right[t] = cost - log_gap_cost(dl - 1, n_left) - log_gap_cost(dr + 1, n_right);
+                ws.gain_to_left[t] = cost - log_gap_cost(dl + 1, n_left) - log_gap_cost(dr - 1, n_right);
+            }
+
+            for (size_t i = 0; i < half; ++i) {
+                double gain = 0;
+                for (uint32_t t : doc_terms[left[i]]) gain += ws.gain_to_right[t];
+                left_gains[i] = {gain, left[i]};
+            }
+            for (size_t i = 0; i < right_count; ++i) {
+                double gain = 0;
+                for (uint32_t t : doc_terms[right[i]]) gain += ws.gain_to_left[t];
+                right_gains[i] = {gain, right[i]};
+            }
+
+            for (uint32_t t : ws.touched) {
+                ws.left_deg[t] = 0;
+                ws.right_deg[t] = 0;
+            }
+            ws.touched.clear();
+
+            // Обмениваются пары с наибольшим суммарным выигрышем, пока он положителен
+            auto by_gain = [](const std::pair<double, uint32_t>& a, const std::pair<double, uint32_t>& b) {
+                return a.first > b.first || (a.first == b.first && a.second < b.second);
+            };
+            std::sort(left_gains.begin(), left_gains.end(), by_gain);
+            std::sort(right_gains.begin(), right_gains.end(), by_gain);
+
+            size_t swaps = 0;
+            while (swaps < half && swaps < right_count &&
+                   left_gains[swaps].first + right_gains[swaps].first > 0) {
+                swaps++;
+            }
+            if (swaps == 0) break;
+
+            for (size_t i = 0; i < half; ++i) left[i] = i < swaps ? right_gains[i].second : left_gains[i].second;
+            for (size_t i = 0; i < right_count; ++i) right[i] = i < swaps ? left_gains[i].second : right_gains[i].second;
+        }
+
+        if (depth < PARALLEL_DEPTH) {
+            std::thread left_thread([&] {
+                Workspace own(term_count);
+                bisect(left, half, doc_terms, term_count, own, iterations, min_partition, depth + 1);
+            });
+            bisect(right, right_count, doc_terms, term_count, ws, iterations, min_partition, depth + 1);
+            left_thread.join();
+        } else {
+            bisect(left, half, doc_terms, term_count, ws, iterations, min_partition, depth + 1);
+            bisect(right, right_count, doc_terms, term_count, ws, iterations, min_partition, depth + 1);
+        }
+    }
+
+    // Пересечение с экспоненциальным поиском в длинном списке
+    size_t galloping_intersect_count(const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+        if (na > nb) {
+            std::swap(a, b);
+            std::swap(na, nb);
+        }
+        size_t found = 0, pos = 0;
+        for (size_t i = 0; i < na && pos < nb; ++i) {
+            size_t step = 1, hi = pos;
+            while (hi < nb && b[hi] < a[i]) {
+                pos = hi;
+                hi += step;
+                step *= 2;
+            }
+            pos = std::lower_bound(b + pos, b + std::min(hi + 1, nb), a[i]) - b;
+            if (pos < nb && b[pos] == a[i]) found++;
+        }
+        return found;
+    }
+}
+
+namespace DocReorder {
+
+    std::vector<uint32_t> minhash_order(const std::vector<std::vector<uint32_t>>& doc_terms, int hashes) {
+        size_t doc_count = doc_terms.size();
+        std::vector<uint64_t> signatures(doc_count * hashes, UINT64_MAX);
+        for (size_t d = 0; d < doc_count; ++d) {
+            for (uint32_t t : doc_terms[d]) {
+                for (int h = 0; h < hashes; ++h) {
+                    uint64_t v = mix64(t * 0x9E3779B97F4A7C15ULL + (uint64_t)(h + 1) * 0xBF58476D1CE4E5B9ULL);
+                    signatures[d * hashes + h] = std::min(signatures[d * hashes + h], v);
+                }
+            }
+        }
+
+        std::vector<uint32_t> order(doc_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return std::lexicographical_compare(signatures.begin() + a * hashes, signatures.begin() + (a + 1) * hashes,
+                                                signatures.begin() + b * hashes, signatures.begin() + (b + 1) * hashes);
+        });
+        return order;
+    }
+
+    std::vector<uint32_t> bp_order(const std::vector<std::vector<uint32_t>>& doc_terms, uint32_t term_count,
+                                   int iterations, uint32_t min_partition) {
+        std::vector<uint32_t> order(doc_terms.size());
+        std::iota(order.begin(), order.end(), 0);
+        Workspace ws(term_count);
+        bisect(order.data(), order.size(), doc_terms, term_count, ws, iterations, std::max(2u, min_partition), 0);
+        return order;
+    }
+
+    OrderStats evaluate(const std::vector<std::vector<uint32_t>>& doc_terms, uint32_t term_count,
+                        const std::vector<uint32_t>& new_to_old) {
+        size_t doc_count = doc_terms.size();
+
+        // Постинги в виде CSR: документы обходятся в новом порядке, поэтому списки сразу отсортированы
+        std::vector<size_t> term_begin(term_count + 1, 0);
+        for (const auto& terms : doc_terms) {
+            for (uint32_t t : terms) term_begin[t + 1]++;
+        }
+        for (uint32_t t = 0; t < term_count; ++t) term_begin[t + 1] += term_begin[t];
+
+        std::vector<uint32_t> postings(term_begin[term_count]);
+        std::vector<size_t> fill(term_begin.begin(), term_begin.end() - 1);
+        for (uint32_t k = 0; k < doc_count; ++k) {
+            uint32_t d = new_to_old.empty() ? k : new_to_old[k];
+            for (uint32_t t : doc_terms[d]) postings[fill[t]++] = k;
+        }
+
+        OrderStats stats;
+        for (uint32_t t = 0; t < term_count; ++t) {
+            const uint32_t* list = postings.data() + term_begin[t];
+            size_t n = term_begin[t + 1] - term_begin[t];
+            stats.vbyte_bytes += PostingsCodecs::vbyte_bytes(list, n);
+            stats.bp128_bytes += PostingsCodecs::bitpacking128_first_apart_bytes(list, n);
+        }
+
+        // Попарные пересечения 32 самых частых термов
+        std::vector<uint32_t> frequent(term_count);
+        std::iota(frequent.begin(), frequent.end(), 0);
+        size_t top = std::min<size_t>(32, frequent.size());
+        std::partial_sort(frequent.begin(), frequent.begin() + top, frequent.end(), [&](uint32_t a, uint32_t b) {
+            return term_begin[a + 1] - term_begin[a] > term_begin[b + 1] - term_begin[b];
+        });
+
+        auto start = std::chrono::high_resolution_clock::now();
+        volatile size_t checksum = 0;
+        for (size_t i = 0; i < top; ++i) {
+            for (size_t j = i + 1; j < top; ++j) {
+                uint32_t a = frequent[i], b = frequent[j];
+                checksum += galloping_intersect_count(postings.data() + term_begin[a], term_begin[a + 1] - term_begin[a],
+                                                      postings.data() + term_begin[b], term_begin[b + 1] - term_begin[b]);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        stats.intersect_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        return stats;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+// Перенумерация документов перед записью постингов: похожие документы получают
+// близкие id, d-gaps в постингах уменьшаются и списки сжимаются лучше.
+
+enum class DocOrder { NONE, MINHASH, BP };
+
+namespace DocReorder {
+
+    // doc_terms[d] - id термов документа d (каждый терм один раз).
+    // Результат - перестановка new_to_old: new_to_old[новый id] = старый id.
+
+    // Сортировка документов по MinHash-сигнатуре множества термов
+    std::vector<uint32_t> minhash_order(const std::vector<std::vector<uint32_t>>& doc_terms, int hashes = 4);
+
+    // Рекурсивная бисекция графа документ-терм (BP): на каждом уровне документы
+    // переставляются между половинами, пока это уменьшает оценку log-gap стоимости
+    std::vector<uint32_t> bp_order(const std::vector<std::vector<uint32_t>>& doc_terms, uint32_t term_count,
+                                   int iterations = 20, uint32_t min_partition = 16);
+
+    struct OrderStats {
+        uint64_t vbyte_bytes = 0;
+        uint64_t bp128_bytes = 0;
+        double intersect_ms = 0;
+    };
+
+    // Размер постингов и время пересечения самых частых термов при нумерации
+    // new_to_old (пустой вектор - исходная нумерация)
+    OrderStats evaluate(const std::vector<std::vector<uint32_t>>& doc_terms, uint32_t term_count,
+                        const std::vector<uint32_t>& new_to_old);
+}
@@ -0,0 +1,212 @@
+#include "doc_store.hpp"
+#include "binary_utils.hpp"
+#include "lz_codec.hpp"
+#include <stdexcept>
+#include <filesystem>
+
+static const uint32_t DOC_STORE_SIGNATURE = 0x52545344;
+
+DocStoreWriter::DocStoreWriter(const std::string& filename, uint32_t block_size, bool resume)
+    : filename(filename), block_size(block_size) {
+    if (resume) {
+        out.open(filename, std::ios::binary | std::ios::in | std::ios::out);
+        if (!out.is_open()) throw std::runtime_error("Cannot reopen " + filename);
+        return;
+    }
+    out.open(filename, std::ios::binary);
+    if (!out.is_open()) throw std::runtime_error("Cannot create " + filename);
+    BinaryUtils::write_u32(out, DOC_STORE_SIGNATURE);
+    BinaryUtils::write_u8(out, 1);
+    BinaryUtils::write_u32(out, block_size);
+}
+
+void DocStoreWriter::add(const std::string& text) {
+    if (!buffer.empty() && buffer.size() + text.size() > block_size) {
+        flush_block();
+    }
+    docs.push_back({(uint32_t)blocks.size(), (uint32_t)buffer.size(), (uint32_t)text.size()});
+    buffer += text;
+    total_raw += text.size();
+}
+
+void DocStoreWriter::reorder(const std::vector<uint32_t>& new_to_old) {
+    std::vector<DocStoreEntry> permuted(new_to_old.size());
+    for (size_t k = 0; k < new_to_old.size(); ++k) permuted[k] = docs.at(new_to_old[k]);
+    docs.swap(permuted);
+}
+
+void DocStoreWriter::flush_block() {
+    if (buffer.empty()) return;
+    std::string packed = LzCodec::compress(buffer.data(), buffer.size());
+    blocks.push_back({(uint64_t)out.tellp(), (uint32_t)packed.size(), (uint32_t)buffer.size()});
+    out.write(packed.data(), packed.size());
+    total_compressed += packed.size();
+    buffer.clear();
+}
+
+void DocStoreWriter::finish() {
+    flush_block();
+
+    uint64_t tables_offset = out.tellp();
+    BinaryUtils::write_u32(out, (uint32_t)blocks.size());
+    for (const auto& b : blocks) {
+        BinaryUtils::write_u64(out, b.offset);
+        BinaryUtils::write_u32(out, b.compressed_size);
+        BinaryUtils::write_u32(out, b.raw_size);
+    }
+    BinaryUtils::write_u32(out, (uint32_t)docs.size());
+    for (const auto& d : docs) {
+        BinaryUtils::write_u32(out, d.block);
+        BinaryUtils::write_u32(out, d.offset);
+        BinaryUtils::write_u32(out, d.length);
+    }
+    BinaryUtils::write_u64(out, tables_offset);
+    out.close();
+}
+
+void DocStoreWriter::save_state(std::ofstream& state) {
+    out.flush();
+    BinaryUtils::write_u64(state, (uint64_t)out.tellp());
+    BinaryUtils::write_u64(state, total_raw);
+    BinaryUtils::write_u64(state, total_compressed);
+    BinaryUtils::write_u32(state, (uint32_t)blocks.size());
+    state.write(reinterpret_cast<const char*>(blocks.data()), blocks.size() * sizeof(DocStoreBlock));
+    BinaryUtils::write_u32(state, (uint32_t)docs.size());
+    state.write(reinterpret_cast<const char*>(docs.data()), docs.size() * sizeof(DocStoreEntry));
+    BinaryUtils::write_u32(state, (uint32_t)buffer.size());
+    BinaryUtils::write_string(state, buffer);
+}
+
+void DocStoreWriter::load_state(std::ifstream& state) {
+    uint64_t file_end = BinaryUtils::read_u64(state);
+    total_raw = BinaryUtils::read_u64(state);
+    total_compressed = BinaryUtils::read_u64(state);
+    blocks.resize(BinaryUtils::read_u32(state));
+    state.read(reinterpret_cast<char*>(blocks.data()), blocks.size() * sizeof(DocStoreBlock));
+    docs.resize(BinaryUtils::read_u32(state));
+    state.read(reinterpret_cast<char*>(docs.data()), docs.size() * sizeof(DocStoreEntry));
+    buffer.resize(BinaryUtils::read_u32(state));
+    state.read(&buffer[0], buffer.size());
+    if (!state) throw std::runtime_error("Corrupted doc store state");
+
+    // Блоки, сжатые после контрольной точки, отбрасываются
+    out.close();
+    if (std::filesystem::file_size(filename) < file_end) throw std::runtime_error("Doc store shorter than checkpoint");
+    std::filesystem::resize_file(filename, file_end);
+    out.open(filename, std::ios::binary | std::ios::in | std::ios::out);
+    out.seekp((std::streamoff)file_end);
+}
+
+void DocStore::open(const std::string& filename) {
+    file.open(filename, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Cannot open " + filename);
+
+    if (BinaryUtils::read_u32(file) != DOC_STORE_SIGNATURE) {
+        file.close();
+        throw std::runtime_error("Invalid doc store signature");
+    }
+
+    // Таблицы проверяются целиком: по ним потом читаются блоки и режутся тексты
+    auto corrupted = [this](const std::string& what) {
+        file.close();
+        blocks.clear();
+        docs.clear();
+        return std::runtime_error("Corrupted doc store: " + what);
+    };
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = (uint64_t)file.tellg();
+    const uint64_t header_bytes = 9;
+    if (file_size < header_bytes + 4 + 4 + 8) throw corrupted("file too short");
+    file.seekg(-8, std::ios::end);
+    uint64_t tables_offset = BinaryUtils::read_u64(file);
+    uint64_t tables_end = file_size - 8;
+    if (tables_offset < header_bytes || tables_offset + 4 > tables_end) throw corrupted("bad tables offset");
+    file.seekg((std::streamoff)tables_offset);
+
+    uint32_t block_count = BinaryUtils::read_u32(file);
+    if (tables_offset + 4 + block_count * 16ULL + 4 > tables_end) throw corrupted("block table out of bounds");
+    blocks.resize(block_count);
+    for (auto& b : blocks) {
+        b.offset = BinaryUtils::read_u64(file);
+        b.compressed_size = BinaryUtils::read_u32(file);
+        b.raw_size = BinaryUtils::read_u32(file);
+        // LZ-поток не разворачивается больше чем в 256 раз: иначе raw_size - мусор
+        if (b.offset < header_bytes || b.offset + b.compressed_size > tables_offset ||
+            b.raw_size > b.compressed_size * 256ULL) {
+            throw corrupted("block out of bounds");
+        }
+    }
+    uint32_t doc_count = BinaryUtils::read_u32(file);
+    if (tables_offset + 4 + block_count * 16ULL + 4 + doc_count * 12ULL > tables_end) {
+        throw corrupted("document table out of bounds");
+    }
+    docs.resize(doc_count);
+    for (auto& d : docs) {
+        d.block = BinaryUtils::read_u32(file);
+        d.offset = BinaryUtils::read_u32(file);
+        d.length = BinaryUtils::read_u32(file);
+        if (d.block >= blocks.size() || (uint64_t)d.offset + d.length > blocks[d.block].raw_size) {
+            throw corrupted("document out of block bounds");
+        }
+    }
+    if (!file) throw corrupted("truncated tables");
+}
+
+std::shared_ptr<const std::string> DocStore::load_block(uint32_t block_id) {
+    for (auto& entry : cache) {
+        if (entry.block == block_id) {
+            entry.last_used = ++tick;
+            return entry.data;
+        }
+    }
+
+    const DocStoreBlock& info = blocks.at(block_id);
+    std::string packed(info.compressed_size, '\0');
+    file.seekg((std::streamoff)info.offset);
+    file.read(&packed[0], packed.size());
+    if (!file) {
+        file.clear();
+        throw std::runtime_error("Corrupted doc store: block " + std::to_string(block_id) + " truncated");
+    }
+
+    // Распаковщик проверяет границы и точную длину результата
+    auto raw = std::make_shared<std::string>(info.raw_size, '\0');
+    try {
+        LzCodec::decompress(packed.data(), packed.size(), &(*raw)[0], raw->size());
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error("Corrupted doc store: block " + std::to_string(block_id) + ": " + e.what());
+    }
+
+    if (cache.size() < cache_capacity) {
+        cache.push_back({block_id, ++tick, raw});
+    } else if (cache_capacity > 0) {
+        size_t victim = 0;
+        for (size_t i = 1; i < cache.size(); ++i) {
+            if (cache[i].last_used < cache[victim].last_used) victim = i;
+        }
+        cache[victim] = {block_id, ++tick, raw};
+    }
+    return raw;
+}
+
+std::string DocStore::get_document(uint32_t doc_id) {
+    if (doc_id >= docs.size()) return "";
+    const DocStoreEntry& loc = docs[doc_id];
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto block = load_block(loc.block);
+    return block->substr(loc.offset, loc.length);
+}
+
+size_t DocStore::table_bytes() const {
+    return blocks.capacity() * sizeof(DocStoreBlock) + docs.capacity() * sizeof(DocStoreEntry);
+}
+
+size_t DocStore::cache_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = cache.capacity() * sizeof(CachedBlock);
+    for (const auto& entry : cache) {
+        if (entry.data) total += sizeof(std::string) + entry.data->capacity();
+    }
+    return total;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+// Хранилище текстов документов: тексты склеиваются в блоки ~64 КБ,
+// каждый блок сжимается LzCodec. В конце файла - таблица блоков и
+// таблица документов (блок, смещение внутри блока, длина).
+
+struct DocStoreBlock {
+    uint64_t offset;
+    uint32_t compressed_size;
+    uint32_t raw_size;
+};
+
+struct DocStoreEntry {
+    uint32_t block;
+    uint32_t offset;
+    uint32_t length;
+};
+
+class DocStoreWriter {
+public:
+    // resume: файл не пересоздается, состояние затем восстанавливается через load_state
+    explicit DocStoreWriter(const std::string& filename, uint32_t block_size = 64 * 1024, bool resume = false);
+
+    void add(const std::string& text);
+    // Перенумерация: документ k получает текст, добавленный под номером new_to_old[k].
+    // Тексты в блоках не переписываются, переставляется только таблица документов.
+    void reorder(const std::vector<uint32_t>& new_to_old);
+    void finish();
+
+    // Состояние для контрольной точки сборки: длина записанной части файла,
+    // таблицы и несжатый хвост. load_state обрезает файл до сохраненной длины
+    void save_state(std::ofstream& state);
+    void load_state(std::ifstream& state);
+
+    uint64_t raw_bytes() const { return total_raw; }
+    uint64_t compressed_bytes() const { return total_compressed; }
+
+private:
+    void flush_block();
+
+    std::string filename;
+    std::ofstream out;
+    uint32_t block_size;
+    std::string buffer;
+    std::vector<DocStoreBlock> blocks;
+    std::vector<DocStoreEntry> docs;
+    uint64_t total_raw = 0;
+    uint64_t total_compressed = 0;
+};
+
+class DocStore {
+public:
+    explicit DocStore(size_t cache_blocks = 8) : cache_capacity(cache_blocks) {}
+
+    void open(const std::string& filename);
+    bool is_open() const { return file.is_open(); }
+    uint32_t size() const { return (uint32_t)docs.size(); }
+
+    std::string get_document(uint32_t doc_id);
+
+    // Оценка занятой памяти: таблицы блоков/документов и кэш распакованных блоков
+    size_t table_bytes() const;
+    size_t cache_bytes() const;
+
+private:
+    struct CachedBlock {
+        uint32_t block;
+        uint64_t last_used;
+        std::shared_ptr<const std::string> data;
+    };
+
+    std::shared_ptr<const std::string> load_block(uint32_t block_id);
+
+    std::ifstream file;
+    std::vector<DocStoreBlock> blocks;
+    std::vector<DocStoreEntry> docs;
+
+    mutable std::mutex mutex;
+    size_t cache_capacity;
+    uint64_t tick = 0;
+    std::vector<CachedBlock> cache;
+};
@@ -0,0 +1,110 @@
+#include "fuzzy_matcher.hpp"
+#include <algorithm>
+
+std::vector<uint32_t> FuzzyMatcher::decode_utf8(const std::string& s, std::vector<size_t>* byte_ends) {
+    std::vector<uint32_t> cps;
+    cps.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ) {
+        unsigned char c = (unsigned char)s[i];
+        size_t len = 1;
+        uint32_t cp = c;
+        if ((c & 0xE0) == 0xC0) { len = 2; cp = c & 0x1F; }
+        else if ((c & 0xF0) == 0xE0) { len = 3; cp = c & 0x0F; }
+        else if ((c & 0xF8) == 0xF0) { len = 4; cp = c & 0x07; }
+        for (size_t k = 1; k < len && i + k < s.size(); ++k) {
+            cp = (cp << 6) | ((unsigned char)s[i + k] & 0x3F);
+        }
+        i = std::min(i + len, s.size());
+        cps.push_back(cp);
+        if (byte_ends) byte_ends->push_back(i);
+    }
+    return cps;
+}
+
+FuzzyMatcher::FuzzyMatcher(const std::string& term, int max_edits)
+    : query(decode_utf8(term)), max_edits(max_edits) {}
+
+FuzzyMatcher::Row FuzzyMatcher::start_row() const {
+    Row row(query.size() + 1);
+    for (size_t j = 0; j < row.size(); ++j) row[j] = (uint8_t)std::min<size_t>(j, 255);
+    return row;
+}
+
+void FuzzyMatcher::step(const Row& prev, uint32_t cp, Row& next) const {
+    next.resize(prev.size());
+    next[0] = (uint8_t)std::min(prev[0] + 1, 255);
+    for (size_t j = 1; j < prev.size(); ++j) {
+        int cost = query[j - 1] == cp ? 0 : 1;
+        int best = std::min({prev[j] + 1, next[j - 1] + 1, prev[j - 1] + cost});
+        next[j] = (uint8_t)std::min(best, 255);
+    }
+}
+
+bool FuzzyMatcher::can_match(const Row& row) const {
+    return *std::min_element(row.begin(), row.end()) <= max_edits;
+}
+
+std::vector<FuzzyMatcher::Match> FuzzyMatcher::find(const std::vector<std::string>& sorted_terms, Stats* stats) const {
+    std::vector<Match> matches;
+
+    // rows[j] - состояние автомата после j кодовых точек предыдущего терма;
+    // строки переиспользуются между термами, чтобы не выделять память на каждом шаге
+    std::vector<Row> rows(1, start_row());
+    size_t depth = 0;
+    std::vector<uint32_t> prev_cps;
+    std::vector<size_t> byte_ends;
+
+    size_t i = 0;
+    while (i < sorted_terms.size()) {
+        const std::string& term = sorted_terms[i];
+        byte_ends.clear();
+        std::vector<uint32_t> cps = decode_utf8(term, &byte_ends);
+        if (stats) stats->visited_terms++;
+
+        size_t common = 0;
+        size_t limit = std::min({cps.size(), prev_cps.size(), depth});
+        while (common < limit && cps[common] == prev_cps[common]) common++;
+        depth = common;
+
+        size_t dead_at = 0;
+        for (size_t j = common; j < cps.size(); ++j) {
+            if (rows.size() <= j + 1) rows.emplace_back();
+            step(rows[j], cps[j], rows[j + 1]);
+            depth = j + 1;
+            if (!can_match(rows[depth])) {
+                dead_at = depth;
+                break;
+            }
+        }
+        prev_cps = std::move(cps);
+
+        if (dead_at == 0) {
+            int d = distance(rows[depth]);
+            if (d <= max_edits) matches.push_back({(uint32_t)i, (uint8_t)d});
+            i++;
+            continue;
+        }
+
+        // Ни один терм с этим префиксом не подойдет: прыгаем к первому терму вне префикса.
+        // Последний байт UTF-8 символа меньше 0xFF, поэтому инкремент дает верхнюю границу.
+        std::string bound = term.substr(0, byte_ends[dead_at - 1]);
+        bound.back() = (char)((unsigned char)bound.back() + 1);
+        size_t next_i = std::lower_bound(sorted_terms.begin() + i + 1, sorted_terms.end(), bound) - sorted_terms.begin();
+        if (stats && next_i > i + 1) stats->skipped_ranges++;
+        i = next_i;
+    }
+    return matches;
+}
+
+std::vector<FuzzyMatcher::Match> FuzzyMatcher::find_brute_force(const std::vector<std::string>& sorted_terms) const {
+    std::vector<Match> matches;
+    for (size_t i = 0; i < sorted_terms.size(); ++i) {
+        Row row = start_row(), next;
+        for (uint32_t cp : decode_utf8(sorted_terms[i])) {
+            step(row, cp, next);
+            row.swap(next);
+        }
+        if (distance(row) <= max_edits) matches.push_back({(uint32_t)i, (uint8_t)distance(row)});
+    }
+    return matches;
+}
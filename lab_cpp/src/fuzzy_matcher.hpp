@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Поиск термов на расстоянии Левенштейна <= max_edits по отсортированному словарю.
+// Автомат Левенштейна моделируется строкой ДП над кодовыми точками запроса;
+// состояния для общего префикса соседних термов переиспользуются, а все термы
+// с префиксом, из которого автомат уже не может принять, пропускаются бинарным поиском.
+class FuzzyMatcher {
+public:
+    struct Match {
+        uint32_t term_index;
+        uint8_t distance;
+    };
+
+    struct Stats {
+        size_t visited_terms = 0;
+        size_t skipped_ranges = 0;
+    };
+
+    FuzzyMatcher(const std::string& term, int max_edits);
+
+    std::vector<Match> find(const std::vector<std::string>& sorted_terms, Stats* stats = nullptr) const;
+
+    // Полный перебор словаря - эталон для тестов и бенчмарков
+    std::vector<Match> find_brute_force(const std::vector<std::string>& sorted_terms) const;
+
+    static std::vector<uint32_t> decode_utf8(const std::string& s, std::vector<size_t>* byte_ends = nullptr);
+
+private:
+    using Row = std::vector<uint8_t>;
+
+    std::vector<uint32_t> query;
+    int max_edits;
+
+    Row start_row() const;
+    void step(const Row& prev, uint32_t cp, Row& next) const;
+    bool can_match(const Row& row) const;
+    int distance(const Row& row) const { return row.back(); }
+};
@@ -0,0 +1,147 @@
+#include "impact_index.hpp"
+#include <algorithm>
+#include <queue>
+
+namespace ImpactIndex {
+
+namespace {
+    bool better(const ScoredDoc& a, const ScoredDoc& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.doc_id < b.doc_id;
+    }
+
+    std::vector<ScoredDoc> best_k(std::vector<ScoredDoc>& docs, size_t k) {
+        size_t keep = std::min(k, docs.size());
+        std::partial_sort(docs.begin(), docs.begin() + keep, docs.end(), better);
+        docs.resize(keep);
+        return docs;
+    }
+}
+
+std::vector<ScoredDoc> top_k_exhaustive(const std::vector<Cursor>& terms, size_t k, TopKStats* stats) {
+    if (k == 0 || terms.empty()) return {};
+
+    // Слияние списков по doc_id; в куче k лучших, на вершине худший из них
+    std::priority_queue<ScoredDoc, std::vector<ScoredDoc>, decltype(&better)> heap(&better);
+    std::vector<uint32_t> pos(terms.size(), 0);
+    uint64_t scored = 0;
+
+    while (true) {
+        uint32_t doc = UINT32_MAX;
+        for (size_t t = 0; t < terms.size(); ++t) {
+            if (pos[t] < terms[t].doc_freq) doc = std::min(doc, terms[t].docs[pos[t]]);
+        }
+        if (doc == UINT32_MAX) break;
+
+        uint32_t score = 0;
+        for (size_t t = 0; t < terms.size(); ++t) {
+            if (pos[t] < terms[t].doc_freq && terms[t].docs[pos[t]] == doc) {
+                score += terms[t].impacts[pos[t]++];
+                scored++;
+            }
+        }
+
+        ScoredDoc candidate{doc, score};
+        if (heap.size() < k) heap.push(candidate);
+        else if (better(candidate, heap.top())) {
+            heap.pop();
+            heap.push(candidate);
+        }
+    }
+
+    std::vector<ScoredDoc> result;
+    while (!heap.empty()) {
+        result.push_back(heap.top());
+        heap.pop();
+    }
+    std::reverse(result.begin(), result.end());
+
+    if (stats) {
+        stats->postings_scored += scored;
+        for (const auto& t : terms) stats->postings_total += t.doc_freq;
+    }
+    return result;
+}
+
+std::vector<ScoredDoc> top_k(const std::vector<Cursor>& terms, size_t k, TopKStats* stats) {
+    if (k == 0 || terms.empty()) return {};
+    // Маска термов кандидата - 64 бита
+    if (terms.size() > 64) return top_k_exhaustive(terms, k, stats);
+
+    // 1. Головы всех термов, сгруппированные по документам. Сумма по головам -
+    // нижняя граница оценки документа
+    struct Hit {
+        uint32_t doc_id;
+        uint32_t term;
+        uint8_t impact;
+    };
+    std::vector<Hit> hits;
+    uint32_t outside_bound = 0;
+    for (uint32_t t = 0; t < terms.size(); ++t) {
+        for (uint32_t i = 0; i < terms[t].head_count; ++i) {
+            hits.push_back({terms[t].head_docs[i], t, terms[t].head_impacts[i]});
+        }
+        outside_bound += terms[t].tail_max;
+    }
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.doc_id < b.doc_id; });
+
+    struct Candidate {
+        uint32_t doc_id;
+        uint32_t lower;
+        uint64_t mask;
+    };
+    std::vector<Candidate> candidates;
+    for (const auto& h : hits) {
+        if (candidates.empty() || candidates.back().doc_id != h.doc_id) candidates.push_back({h.doc_id, 0, 0});
+        candidates.back().lower += h.impact;
+        candidates.back().mask |= 1ULL << h.term;
+    }
+
+    // 2. Порог - k-я нижняя граница. Документ вне голов набирает не больше
+    // outside_bound; если это меньше порога, хвосты можно не просматривать
+    uint32_t threshold = 0;
+    if (candidates.size() >= k) {
+        std::vector<uint32_t> lower;
+        lower.reserve(candidates.size());
+        for (const auto& c : candidates) lower.push_back(c.lower);
+        std::nth_element(lower.begin(), lower.begin() + (k - 1), lower.end(), std::greater<uint32_t>());
+        threshold = lower[k - 1];
+    }
+    if (outside_bound > 0 && (candidates.size() < k || outside_bound >= threshold)) {
+        if (stats) stats->postings_scored += hits.size();
+        return top_k_exhaustive(terms, k, stats);
+    }
+
+    // 3. Кандидаты, которые еще могут войти в top-k, досчитываются точечным
+    // поиском в хвостах тех термов, в чьих головах их нет
+    uint64_t scored = hits.size();
+    std::vector<ScoredDoc> finalists;
+    for (const auto& c : candidates) {
+        uint32_t upper = c.lower;
+        for (uint32_t t = 0; t < terms.size(); ++t) {
+            if (!(c.mask >> t & 1)) upper += terms[t].tail_max;
+        }
+        if (upper < threshold) continue;
+
+        uint32_t score = c.lower;
+        for (uint32_t t = 0; t < terms.size(); ++t) {
+            if ((c.mask >> t & 1) || terms[t].tail_max == 0) continue;
+            const uint32_t* end = terms[t].docs + terms[t].doc_freq;
+            const uint32_t* it = std::lower_bound(terms[t].docs, end, c.doc_id);
+            if (it != end && *it == c.doc_id) {
+                score += terms[t].impacts[it - terms[t].docs];
+                scored++;
+            }
+        }
+        finalists.push_back({c.doc_id, score});
+    }
+
+    if (stats) {
+        stats->postings_scored += scored;
+        for (const auto& t : terms) stats->postings_total += t.doc_freq;
+        stats->early_terminated = true;
+    }
+    return best_k(finalists, k);
+}
+
+}
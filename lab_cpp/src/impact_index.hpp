@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Двухуровневые постинги для ранжированного top-k (impact_index.bin).
+//
+// Вклад документа в ответ по терму (BM25) квантуется в impact 1..255. Для каждого
+// терма хранятся голова - самые весомые постинги, отсортированные по doc_id, - и
+// impacts всех постингов параллельно основному списку из inverted_index.bin (хвост).
+// top_k сначала считает только головы; если ни один документ вне голов и ни один
+// недосчитанный кандидат уже не может попасть в top-k, хвосты не читаются.
+// Булевы запросы по-прежнему идут по основному списку.
+//
+// Формат: u32 сигнатура, u8 версия, u32 число термов (в порядке словаря
+// inverted_index.bin), f32 вес единицы impact; затем по каждому терму
+// u32 head_count, u32 head_offset, u32 impacts_offset, u8 tail_max; затем данные:
+// голова - head_count x u32 doc_id и head_count x u8 impact, хвост - df x u8 impact.
+
+namespace ImpactIndex {
+
+    const uint32_t SIGNATURE = 0x58504D49;
+    const uint8_t VERSION = 1;
+    const size_t HEADER_BYTES = 4 + 1 + 4 + 4;
+    const size_t TERM_RECORD_BYTES = 4 + 4 + 4 + 1;
+
+    const double BM25_K1 = 1.2;
+    const double BM25_B = 0.75;
+
+    // Голова: не меньше MIN_HEAD постингов и не меньше 1/HEAD_FRACTION списка
+    const uint32_t MIN_HEAD = 128;
+    const uint32_t HEAD_FRACTION = 8;
+
+    inline uint32_t head_size(uint32_t doc_freq) {
+        uint32_t head = doc_freq / HEAD_FRACTION;
+        if (head < MIN_HEAD) head = MIN_HEAD;
+        return head < doc_freq ? head : doc_freq;
+    }
+
+    struct TermImpacts {
+        uint32_t head_count;
+        uint32_t head_offset;
+        uint32_t impacts_offset;
+        uint8_t tail_max;
+    };
+
+    // Постинги одного терма запроса в отображенных файлах
+    struct Cursor {
+        const uint32_t* docs;
+        const uint8_t* impacts;
+        uint32_t doc_freq;
+        const uint32_t* head_docs;
+        const uint8_t* head_impacts;
+        uint32_t head_count;
+        uint8_t tail_max;
+    };
+
+    struct ScoredDoc {
+        uint32_t doc_id;
+        uint32_t score;
+    };
+
+    struct TopKStats {
+        uint64_t postings_scored = 0;
+        uint64_t postings_total = 0;
+        bool early_terminated = false;
+    };
+
+    // Документы с наибольшей суммой impacts по убыванию (при равенстве - по doc_id)
+    std::vector<ScoredDoc> top_k(const std::vector<Cursor>& terms, size_t k, TopKStats* stats = nullptr);
+    // Полный проход по всем постингам; тот же результат, что у top_k
+    std::vector<ScoredDoc> top_k_exhaustive(const std::vector<Cursor>& terms, size_t k, TopKStats* stats = nullptr);
+}
@@ -0,0 +1,219 @@
+#include "index_checkpoint.hpp"
+#include "binary_utils.hpp"
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char* RUN_FILES[] = {"entries.bin", "tf.bin", "terms.bin", "docs.bin", "words.bin", "representatives.bin"};
+
+    void write_text(std::ofstream& out, const std::string& s) {
+        BinaryUtils::write_u32(out, (uint32_t)s.size());
+        BinaryUtils::write_string(out, s);
+    }
+
+    std::string read_text(std::ifstream& in) {
+        std::string s(BinaryUtils::read_u32(in), '\0');
+        in.read(&s[0], s.size());
+        return s;
+    }
+
+    // Файл прогона обрезается до длины из манифеста: хвост после точки не нужен
+    std::ifstream open_run(const std::string& filename, uint64_t bytes) {
+        if (!fs::exists(filename) || fs::file_size(filename) < bytes) {
+            throw std::runtime_error("Checkpoint run " + filename + " is shorter than its manifest");
+        }
+        fs::resize_file(filename, bytes);
+        return std::ifstream(filename, std::ios::binary);
+    }
+}
+
+bool IndexCheckpoint::exists() const {
+    return fs::exists(path("manifest.bin"));
+}
+
+IndexCheckpoint::Summary IndexCheckpoint::summary() const {
+    std::ifstream in(path("manifest.bin"), std::ios::binary);
+    uint32_t signature = BinaryUtils::read_u32(in);
+    uint32_t version = BinaryUtils::read_u32(in);
+    uint64_t saved_fingerprint = BinaryUtils::read_u64(in);
+    if (!in || signature != SIGNATURE || version != VERSION) {
+        throw std::runtime_error("Invalid checkpoint manifest in " + dir);
+    }
+    if (saved_fingerprint != fingerprint) {
+        throw std::runtime_error("Checkpoint in " + dir + " was made for a different corpus or options; "
+                                 "rebuild without --resume");
+    }
+    Summary summary;
+    summary.finished = BinaryUtils::read_u8(in) != 0;
+    summary.docs = BinaryUtils::read_u64(in);
+    summary.text_bytes = BinaryUtils::read_u64(in);
+    summary.duplicates = BinaryUtils::read_u64(in);
+    return summary;
+}
+
+void IndexCheckpoint::start() {
+    remove();
+    fs::create_directories(dir);
+    written = RunSizes();
+}
+
+void IndexCheckpoint::remove() {
+    fs::remove_all(dir);
+}
+
+void IndexCheckpoint::save(const ShardBuildState& state, DocStoreWriter& store) {
+    const auto app = std::ios::binary | std::ios::app;
+    {
+        std::ofstream out(path("entries.bin"), app);
+        out.write(reinterpret_cast<const char*>(state.entries.data() + written.entries),
+                  (state.entries.size() - written.entries) * sizeof(IndexEntry));
+    }
+    if (!state.entry_tf.empty()) {
+        std::ofstream out(path("tf.bin"), app);
+        out.write(reinterpret_cast<const char*>(state.entry_tf.data() + written.entries),
+                  (state.entry_tf.size() - written.entries) * sizeof(uint16_t));
+    }
+    {
+        std::ofstream out(path("terms.bin"), app);
+        for (uint64_t t = written.terms; t < state.vocabulary.size(); ++t) {
+            write_text(out, state.vocabulary.term((uint32_t)t));
+            written.terms_bytes += 4 + state.vocabulary.term((uint32_t)t).size();
+        }
+    }
+    {
+        std::ofstream out(path("docs.bin"), app);
+        for (uint64_t d = written.docs; d < state.docs.size(); ++d) {
+            BinaryUtils::write_u32(out, state.file_of_doc[d]);
+            BinaryUtils::write_u32(out, state.docs[d].length);
+            BinaryUtils::write_u32(out, state.doc_cluster.empty() ? UINT32_MAX : state.doc_cluster[d]);
+            write_text(out, state.docs[d].title);
+            written.docs_bytes += 16 + state.docs[d].title.size();
+        }
+    }
+    {
+        std::ofstream out(path("words.bin"), app);
+        for (uint64_t w = written.words; w < state.surface_words.size(); ++w) {
+            write_text(out, state.surface_words.term((uint32_t)w));
+            BinaryUtils::write_u32(out, state.word_term[w]);
+            written.words_bytes += 8 + state.surface_words.term((uint32_t)w).size();
+        }
+    }
+    {
+        std::ofstream out(path("representatives.bin"), app);
+        for (uint64_t r = written.representatives; r < state.representatives.size(); ++r) {
+            BinaryUtils::write_u64(out, state.representatives[r].first);
+            BinaryUtils::write_u32(out, state.representatives[r].second);
+        }
+    }
+    written.entries = state.entries.size();
+    written.terms = state.vocabulary.size();
+    written.docs = state.docs.size();
+    written.words = state.surface_words.size();
+    written.representatives = state.representatives.size();
+
+    Summary summary;
+    summary.docs = state.docs.size();
+    summary.text_bytes = state.text_bytes;
+    summary.duplicates = state.duplicates;
+    write_manifest(summary, &state, &store);
+}
+
+void IndexCheckpoint::finish(const Summary& summary) {
+    for (const char* name : RUN_FILES) fs::remove(path(name));
+    Summary done = summary;
+    done.finished = true;
+    write_manifest(done, nullptr, nullptr);
+}
+
+void IndexCheckpoint::write_manifest(const Summary& summary, const ShardBuildState* state, DocStoreWriter* store) {
+    {
+        std::ofstream out(path("manifest.bin.tmp"), std::ios::binary);
+        BinaryUtils::write_u32(out, SIGNATURE);
+        BinaryUtils::write_u32(out, VERSION);
+        BinaryUtils::write_u64(out, fingerprint);
+        BinaryUtils::write_u8(out, summary.finished ? 1 : 0);
+        BinaryUtils::write_u64(out, summary.docs);
+        BinaryUtils::write_u64(out, summary.text_bytes);
+        BinaryUtils::write_u64(out, summary.duplicates);
+        if (state) {
+            BinaryUtils::write_u64(out, state->next_file);
+            BinaryUtils::write_u32(out, state->next_doc_id);
+            for (uint64_t v : {written.entries, written.terms, written.docs, written.words, written.representatives,
+                               written.terms_bytes, written.docs_bytes, written.words_bytes}) {
+                BinaryUtils::write_u64(out, v);
+            }
+            BinaryUtils::write_u32(out, (uint32_t)state->word_df.size());
+            out.write(reinterpret_cast<const char*>(state->word_df.data()), state->word_df.size() * sizeof(uint32_t));
+            store->save_state(out);
+        }
+        if (!out) throw std::runtime_error("Cannot write checkpoint manifest in " + dir);
+    }
+    fs::rename(path("manifest.bin.tmp"), path("manifest.bin"));
+}
+
+void IndexCheckpoint::load(ShardBuildState& state, DocStoreWriter& store) {
+    Summary saved = summary();
+    if (saved.finished) throw std::runtime_error("Checkpoint in " + dir + " belongs to a finished shard");
+
+    std::ifstream in(path("manifest.bin"), std::ios::binary);
+    in.seekg(4 + 4 + 8 + 1 + 3 * 8);
+    state = ShardBuildState();
+    state.text_bytes = saved.text_bytes;
+    state.duplicates = saved.duplicates;
+    state.next_file = BinaryUtils::read_u64(in);
+    state.next_doc_id = BinaryUtils::read_u32(in);
+    uint64_t* sizes[] = {&written.entries, &written.terms, &written.docs, &written.words, &written.representatives,
+                         &written.terms_bytes, &written.docs_bytes, &written.words_bytes};
+    for (uint64_t* v : sizes) *v = BinaryUtils::read_u64(in);
+    state.word_df.resize(BinaryUtils::read_u32(in));
+    in.read(reinterpret_cast<char*>(state.word_df.data()), state.word_df.size() * sizeof(uint32_t));
+    store.load_state(in);
+    if (!in) throw std::runtime_error("Corrupted checkpoint manifest in " + dir);
+
+    {
+        std::ifstream run = open_run(path("entries.bin"), written.entries * sizeof(IndexEntry));
+        state.entries.resize(written.entries);
+        run.read(reinterpret_cast<char*>(state.entries.data()), written.entries * sizeof(IndexEntry));
+    }
+    if (fs::exists(path("tf.bin"))) {
+        std::ifstream run = open_run(path("tf.bin"), written.entries * sizeof(uint16_t));
+        state.entry_tf.resize(written.entries);
+        run.read(reinterpret_cast<char*>(state.entry_tf.data()), written.entries * sizeof(uint16_t));
+    }
+    {
+        std::ifstream run = open_run(path("terms.bin"), written.terms_bytes);
+        for (uint64_t t = 0; t < written.terms; ++t) state.vocabulary.intern(read_text(run));
+    }
+    {
+        std::ifstream run = open_run(path("docs.bin"), written.docs_bytes);
+        for (uint64_t d = 0; d < written.docs; ++d) {
+            state.file_of_doc.push_back(BinaryUtils::read_u32(run));
+            DocMeta meta;
+            meta.id = (uint32_t)d;
+            meta.length = BinaryUtils::read_u32(run);
+            uint32_t cluster = BinaryUtils::read_u32(run);
+            if (cluster != UINT32_MAX) state.doc_cluster.push_back(cluster);
+            meta.title = read_text(run);
+            state.docs.push_back(std::move(meta));
+        }
+    }
+    {
+        std::ifstream run = open_run(path("words.bin"), written.words_bytes);
+        for (uint64_t w = 0; w < written.words; ++w) {
+            state.surface_words.intern(read_text(run));
+            state.word_term.push_back(BinaryUtils::read_u32(run));
+        }
+    }
+    {
+        std::ifstream run = open_run(path("representatives.bin"), written.representatives * 12);
+        for (uint64_t r = 0; r < written.representatives; ++r) {
+            uint64_t signature = BinaryUtils::read_u64(run);
+            state.representatives.push_back({signature, BinaryUtils::read_u32(run)});
+        }
+    }
+    if (state.vocabulary.size() != written.terms || state.surface_words.size() != written.words) {
+        throw std::runtime_error("Corrupted checkpoint runs in " + dir);
+    }
+}
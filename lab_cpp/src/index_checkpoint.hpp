@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include "indexer.hpp"
+#include "doc_store.hpp"
+
+// Контрольные точки сборки шарда (каталог checkpoint/ рядом с индексом шарда).
+//
+// Растущие части состояния дописываются в файлы прогонов: записи постингов и их tf,
+// новые термы словаря, метаданные документов, словоформы, SimHash представителей.
+// Остальное (doc_freq словоформ, таблицы и хвост хранилища текстов, позиция в корпусе)
+// пишется в manifest.bin целиком. Манифест подменяется через rename последним и хранит
+// длины файлов прогонов: точка согласована, даже если процесс убит посреди записи.
+// Отпечаток списка файлов и опций не дает продолжить сборку другого корпуса.
+class IndexCheckpoint {
+public:
+    static constexpr uint32_t SIGNATURE = 0x54504B43;
+    static constexpr uint32_t VERSION = 1;
+
+    struct Summary {
+        bool finished = false;
+        uint64_t docs = 0;
+        uint64_t text_bytes = 0;
+        uint64_t duplicates = 0;
+    };
+
+    IndexCheckpoint(const std::string& dir, uint64_t fingerprint) : dir(dir), fingerprint(fingerprint) {}
+
+    bool exists() const;
+    // Сводка последней точки; исключение, если она от другой сборки
+    Summary summary() const;
+
+    // Начать заново: старые файлы удаляются
+    void start();
+    // Дописывает изменения с прошлой точки и атомарно заменяет манифест
+    void save(const ShardBuildState& state, DocStoreWriter& store);
+    // Восстанавливает состояние последней точки, хранилище текстов открыто для дозаписи
+    void load(ShardBuildState& state, DocStoreWriter& store);
+    // Шард опубликован: прогоны удаляются, остается сводка для пропуска при --resume
+    void finish(const Summary& summary);
+    void remove();
+
+private:
+    std::string dir;
+    uint64_t fingerprint;
+
+    // Сколько записей каждого прогона уже в файлах и их длины в байтах
+    struct RunSizes {
+        uint64_t entries = 0, terms = 0, docs = 0, words = 0, representatives = 0;
+        uint64_t terms_bytes = 0, docs_bytes = 0, words_bytes = 0;
+    };
+    RunSizes written;
+
+    std::string path(const char* name) const { return dir + "/" + name; }
+    void write_manifest(const Summary& summary, const ShardBuildState* state, DocStoreWriter* store);
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include "binary_utils.hpp"
+
+// Поколение индекса: index_dir/generation.bin перечисляет файлы одной сборки и их размеры.
+// Индексатор подменяет его после всех остальных файлов, поэтому загрузка посреди подмены
+// видит старый список рядом с новыми файлами и отказывается от смешанного набора.
+// build_id общий для всех шардов одной сборки.
+
+struct GenerationStamp {
+    uint64_t build_id = 0;
+    std::vector<std::pair<std::string, uint64_t>> files; // имя файла - размер
+
+    bool operator==(const GenerationStamp& other) const {
+        return build_id == other.build_id && files == other.files;
+    }
+    bool operator!=(const GenerationStamp& other) const { return !(*this == other); }
+};
+
+namespace IndexGeneration {
+
+    const uint32_t SIGNATURE = 0x4E454749;
+
+    // Все файлы, которые может опубликовать индексатор
+    inline const std::vector<std::string>& index_files() {
+        static const std::vector<std::string> files = {
+            "docs_store.bin", "docs_index.bin", "inverted_index.bin", "impact_index.bin", "trigram_index.bin",
+            "completion.bin", "title_index.bin", "doc_map.bin", "doc_clusters.bin"};
+        return files;
+    }
+
+    inline std::string stamp_path(const std::string& index_dir) {
+        return index_dir + "/generation.bin";
+    }
+
+    inline void write(const std::string& path, const GenerationStamp& stamp) {
+        std::ofstream out(path, std::ios::binary);
+        BinaryUtils::write_u32(out, SIGNATURE);
+        BinaryUtils::write_u64(out, stamp.build_id);
+        BinaryUtils::write_u32(out, (uint32_t)stamp.files.size());
+        for (const auto& [name, size] : stamp.files) {
+            BinaryUtils::write_u8(out, (uint8_t)name.size());
+            BinaryUtils::write_string(out, name);
+            BinaryUtils::write_u64(out, size);
+        }
+        if (!out) throw std::runtime_error("Cannot write " + path);
+    }
+
+    // Пустой результат - индекс собран до появления generation.bin, проверять нечего
+    inline std::optional<GenerationStamp> read(const std::string& index_dir) {
+        std::ifstream in(stamp_path(index_dir), std::ios::binary);
+        if (!in.is_open()) return std::nullopt;
+        if (BinaryUtils::read_u32(in) != SIGNATURE) throw std::runtime_error("Invalid generation.bin signature");
+
+        GenerationStamp stamp;
+        stamp.build_id = BinaryUtils::read_u64(in);
+        uint32_t count = BinaryUtils::read_u32(in);
+        if (!in || count > index_files().size()) throw std::runtime_error("Corrupted generation.bin");
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string name(BinaryUtils::read_u8(in), '\0');
+            in.read(&name[0], name.size());
+            uint64_t size = BinaryUtils::read_u64(in);
+            stamp.files.emplace_back(name, size);
+        }
+        if (!in) throw std::runtime_error("Corrupted generation.bin");
+        return stamp;
+    }
+
+    // Файлы каталога должны быть ровно теми, что перечислены в штампе, и тех же размеров
+    inline void verify(const std::string& index_dir, const GenerationStamp& stamp) {
+        auto mixed = [&](const std::string& name, const std::string& what) {
+            return std::runtime_error("Mixed index generation in " + index_dir + ": " + name + " " + what +
+                                      " (index is being rebuilt?)");
+        };
+        for (const std::string& name : index_files()) {
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(index_dir + "/" + name, ec);
+            bool present = !ec;
+            const std::pair<std::string, uint64_t>* listed = nullptr;
+            for (const auto& f : stamp.files) {
+                if (f.first == name) listed = &f;
+            }
+            if (!listed && present) throw mixed(name, "is not part of generation.bin");
+            if (listed && !present) throw mixed(name, "is missing");
+            if (listed && size != listed->second) throw mixed(name, "does not match generation.bin");
+        }
+    }
+}
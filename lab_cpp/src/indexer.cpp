@@ -1,86 +1,544 @@
 #include "indexer.hpp"
 #include "binary_utils.hpp"
 #include "stemmer.hpp"
+#include "doc_store.hpp"
+#include "term_interner.hpp"
+#include "radix_sort.hpp"
+#include "shard_manifest.hpp"
+#include "impact_index.hpp"
+#include "trigram_index.hpp"
+#include "completion_index.hpp"
+#include "title_index.hpp"
+#include "packed_corpus.hpp"
+#include "index_checkpoint.hpp"
+#include "index_generation.hpp"
 #include <filesystem>
 #include <iostream>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 
 namespace fs = std::filesystem;
 
-std::string Indexer::read_title(const std::string& filepath) {
-    std::ifstream file(filepath);
-    std::string title;
-    if (std::getline(file, title)) {
-        if (!title.empty() && title.back() == '\r') title.pop_back();
-        return title;
-    }
-    return "No Title";
+// Заголовок - первая строка текста документа
+std::string Indexer::title_of(const std::string& content) {
+    if (content.empty()) return "No Title";
+    std::string title = content.substr(0, content.find('\n'));
+    if (!title.empty() && title.back() == '\r') title.pop_back();
+    return title;
+}
+
+// Отпечаток входа шарда: контрольная точка годится, только если совпали файлы и опции
+uint64_t Indexer::fingerprint(const std::vector<std::string>& files, size_t begin, size_t end) const {
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    };
+    uint64_t header[] = {begin, end, options.shards, (uint64_t)options.order, (uint64_t)options.duplicates,
+                         (uint64_t)options.duplicate_distance, options.impacts, options.trigrams, options.completions,
+                         packed.is_open()};
+    mix(header, sizeof(header));
+    for (size_t f = begin; f < end; ++f) mix(files[f].data(), files[f].size() + 1);
+    return hash;
+}
+
+// Те же файлы и опции с тем же содержимым дают тот же id: --resume не меняет поколение
+// уже собранных шардов, а правка корпуса меняет. Содержимое оценивается по размеру и времени
+uint64_t Indexer::corpus_build_id(const std::string& corpus_path, const std::vector<std::string>& files) const {
+    uint64_t hash = fingerprint(files, 0, files.size());
+    auto mix = [&hash](uint64_t value) {
+        for (int i = 0; i < 8; ++i) hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ULL;
+    };
+    auto mix_file = [&](const std::string& path) {
+        std::error_code ec;
+        mix(fs::file_size(path, ec));
+        mix((uint64_t)fs::last_write_time(path, ec).time_since_epoch().count());
+    };
+    if (packed.is_open()) mix_file(corpus_path);
+    else for (const auto& f : files) mix_file(f);
+    return hash;
+}
+
+std::string Indexer::read_file(const std::string& filepath) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) return "";
+    file.seekg(0, std::ios::end);
+    std::string content((size_t)file.tellg(), '\0');
+    file.seekg(0);
+    file.read(&content[0], content.size());
+    return content;
 }
 
 void Indexer::build_index(const std::string& corpus_path, const std::string& output_dir) {
     auto start_time = std::chrono::high_resolution_clock::now();
+
+    // Упакованный корпус - один файл; иначе каталог с файлом .txt на документ.
+    // В упакованном режиме files - URL документов, тексты читаются из отображения
+    std::vector<std::string> files;
+    packed.close();
+    if (fs::is_regular_file(corpus_path)) {
+        packed.open(corpus_path);
+        files.reserve(packed.size());
+        for (uint32_t i = 0; i < packed.size(); ++i) {
+            std::string_view url = packed.document(i).url;
+            files.push_back(url.empty() ? "#" + std::to_string(i) : std::string(url));
+        }
+        std::cout << "Packed corpus: " << packed.size() << " documents" << std::endl;
+    } else {
+        for (const auto& entry : fs::directory_iterator(corpus_path)) {
+            if (entry.path().extension() == ".txt") {
+                files.push_back(entry.path().string());
+            }
+        }
+        // Порядок directory_iterator не определен; сортировка делает doc_id воспроизводимыми
+        std::sort(files.begin(), files.end());
+    }
+
+    fs::create_directories(output_dir);
+    build_id = corpus_build_id(corpus_path, files);
+    uint32_t shard_count = std::max<uint32_t>(1, std::min<uint32_t>(options.shards, (uint32_t)files.size()));
+
+    BuildStats total;
+    if (shard_count == 1) {
+        fs::remove(ShardManifest::manifest_path(output_dir));
+        total = build_shard(files, 0, files.size(), output_dir);
+    } else {
+        // Документы делятся на непрерывные диапазоны: глобальный id = doc_base шарда + локальный id
+        std::vector<ShardInfo> shards;
+        for (uint32_t k = 0; k < shard_count; ++k) {
+            size_t begin = files.size() * k / shard_count;
+            size_t end = files.size() * (k + 1) / shard_count;
+            std::cout << "=== Shard " << k + 1 << "/" << shard_count << " ===" << std::endl;
+
+            BuildStats stats = build_shard(files, begin, end, ShardManifest::shard_dir(output_dir, k));
+            // После удаления дубликатов в шарде может остаться меньше документов, чем файлов
+            shards.push_back({(uint32_t)total.docs, (uint32_t)stats.docs});
+
+            total.docs += stats.docs;
+            total.text_bytes += stats.text_bytes;
+            total.tokenize_sec += stats.tokenize_sec;
+            total.sort_sec += stats.sort_sec;
+            total.write_sec += stats.write_sec;
+            total.store_raw += stats.store_raw;
+            total.store_compressed += stats.store_compressed;
+            total.reorder_sec += stats.reorder_sec;
+            total.duplicates += stats.duplicates;
+            total.before.vbyte_bytes += stats.before.vbyte_bytes;
+            total.before.bp128_bytes += stats.before.bp128_bytes;
+            total.before.intersect_ms += stats.before.intersect_ms;
+            total.after.vbyte_bytes += stats.after.vbyte_bytes;
+            total.after.bp128_bytes += stats.after.bp128_bytes;
+            total.after.intersect_ms += stats.after.intersect_ms;
+        }
+        ShardManifest::write(output_dir, shards);
+    }
+    // Индекс опубликован целиком: точки возобновления больше не нужны
+    if (shard_count == 1) {
+        fs::remove_all(output_dir + "/checkpoint");
+    } else {
+        for (uint32_t k = 0; k < shard_count; ++k) fs::remove_all(ShardManifest::shard_dir(output_dir, k) + "/checkpoint");
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end_time - start_time;
+
+    double total_mb = total.text_bytes / 1024.0 / 1024.0;
     
-    std::vector<DocMeta> docs;
-    std::vector<IndexEntry> all_entries; 
-    
-    all_entries.reserve(10000000); 
+    std::cout << "\n=== INDEXING REPORT ===" << std::endl;
+    if (shard_count > 1) std::cout << "Shards: " << shard_count << std::endl;
+    std::cout << "Total time: " << elapsed.count() << " sec" << std::endl;
+    std::cout << "  tokenize: " << total.tokenize_sec << " sec" << std::endl;
+    if (options.order != DocOrder::NONE) std::cout << "  reorder:  " << total.reorder_sec << " sec" << std::endl;
+    std::cout << "  sort:     " << total.sort_sec << " sec" << std::endl;
+    std::cout << "  write:    " << total.write_sec << " sec" << std::endl;
+    std::cout << "Indexing Speed: " << (total_mb / elapsed.count()) << " MB/s" << std::endl;
+    std::cout << "Speed per doc: " << (elapsed.count() / total.docs * 1000) << " ms/doc" << std::endl;
+    if (total.store_raw > 0) {
+        std::cout << "Doc store: " << total.store_compressed / 1024.0 / 1024.0 << " MB ("
+                  << (double)total.store_compressed / total.store_raw * 100 << "% of raw text)" << std::endl;
+    }
+    if (options.duplicates != DuplicatePolicy::KEEP) {
+        std::cout << "Near-duplicates (SimHash, distance <= " << options.duplicate_distance << "): "
+                  << total.duplicates << (options.duplicates == DuplicatePolicy::DROP ? " dropped" : " collapsed")
+                  << std::endl;
+    }
+    if (options.order != DocOrder::NONE && total.before.vbyte_bytes > 0) {
+        auto change = [](double before, double after) { return (after / before - 1) * 100; };
+        std::cout << "\n=== DOC REORDERING ===" << std::endl;
+        std::cout << "Postings VByte:  " << total.before.vbyte_bytes / 1024.0 << " KB -> "
+                  << total.after.vbyte_bytes / 1024.0 << " KB ("
+                  << change(total.before.vbyte_bytes, total.after.vbyte_bytes) << "%)" << std::endl;
+        std::cout << "Postings BP128:  " << total.before.bp128_bytes / 1024.0 << " KB -> "
+                  << total.after.bp128_bytes / 1024.0 << " KB ("
+                  << change(total.before.bp128_bytes, total.after.bp128_bytes) << "%)" << std::endl;
+        std::cout << "Intersections of top-32 terms (galloping): " << total.before.intersect_ms << " ms -> "
+                  << total.after.intersect_ms << " ms" << std::endl;
+    }
+}
 
-    std::cout << "1. Scanning corpus and tokenizing..." << std::endl;
+Indexer::BuildStats Indexer::build_shard(const std::vector<std::string>& files, size_t begin, size_t end,
+                                         const std::string& output_dir) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto start_time = Clock::now();
+    BuildStats stats;
     
+    // Растущее состояние сканирования живет в state, чтобы его можно было сохранить в контрольной точке
+    ShardBuildState state;
+    std::vector<DocMeta>& docs = state.docs;
+    std::vector<IndexEntry>& all_entries = state.entries;
+    TermInterner& vocabulary = state.vocabulary;
+    std::vector<uint32_t> last_doc_of_term;
+
+    fs::create_directories(output_dir);
+    IndexCheckpoint checkpoint(output_dir + "/checkpoint", fingerprint(files, begin, end));
+    // Файлы пишутся во временные и подменяются через rename в конце: запущенный
+    // lab4_search продолжает читать старые версии, пока не перезагрузит индекс
+    const std::string tmp = ".tmp";
+    bool resumed = false;
+    if (options.resume && checkpoint.exists()) {
+        IndexCheckpoint::Summary saved = checkpoint.summary();
+        if (saved.finished && fs::exists(output_dir + "/inverted_index.bin")) {
+            std::cout << "Shard is already built (" << saved.docs << " docs), skipping" << std::endl;
+            stats.docs = saved.docs;
+            stats.text_bytes = saved.text_bytes;
+            stats.duplicates = saved.duplicates;
+            return stats;
+        }
+        resumed = !saved.finished && fs::exists(output_dir + "/docs_store.bin" + tmp);
+    }
+
     Tokenizer tokenizer;
-    uint32_t current_doc_id = 0;
-    long long total_text_size = 0;
-
-    for (const auto& entry : fs::directory_iterator(corpus_path)) {
-        if (entry.path().extension() == ".txt") {
-            std::string path = entry.path().string();
-            total_text_size += fs::file_size(entry.path());
-            
-            // 1. Метаданные
-            DocMeta meta;
-            meta.id = current_doc_id;
-            meta.path = path;
-            meta.title = read_title(path);
-            docs.push_back(meta);
-
-            // 2. Токенизация 
-            CustomMap doc_tokens;
-            tokenizer.tokenize_file(path, doc_tokens);
-            
-            auto items = doc_tokens.get_all_items();
-            for (const auto& item : items) {
-                all_entries.push_back({item.key, current_doc_id});
+    uint32_t& current_doc_id = state.next_doc_id;
+    DocStoreWriter store(output_dir + "/docs_store.bin" + tmp, 64 * 1024, resumed);
+
+    bool dedup = options.duplicates != DuplicatePolicy::KEEP;
+    NearDuplicateIndex near_duplicates(options.duplicate_distance);
+    SimHashBuilder simhash;
+    std::vector<uint32_t>& doc_cluster = state.doc_cluster;
+    std::vector<uint32_t>& file_of_doc = state.file_of_doc;
+
+    // Для impacts: частота терма в документе параллельно all_entries и позиция записи терма текущего документа
+    std::vector<uint16_t>& entry_tf = state.entry_tf;
+    std::vector<size_t> term_entry;
+
+    // Для триграмм и автодополнения: словоформы до стемминга и терм каждой из них;
+    // для автодополнения еще число документов со словоформой
+    TermInterner& surface_words = state.surface_words;
+    std::vector<uint32_t>& word_term = state.word_term;
+    std::vector<uint32_t>& word_df = state.word_df;
+    std::vector<uint32_t> last_doc_of_word;
+    std::vector<uint32_t> doc_words;
+
+    if (resumed) {
+        checkpoint.load(state, store);
+        // Отметки "терм уже был в текущем документе" относятся к прошлым документам и не нужны
+        last_doc_of_term.assign(vocabulary.size(), UINT32_MAX);
+        if (options.impacts) term_entry.assign(vocabulary.size(), 0);
+        if (options.completions) last_doc_of_word.assign(surface_words.size(), UINT32_MAX);
+        for (const auto& rep : state.representatives) near_duplicates.add(rep.first, rep.second);
+        for (size_t k = 0; k < docs.size(); ++k) docs[k].path = files[file_of_doc[k]];
+        std::cout << "Resuming from checkpoint: " << docs.size() << " docs, "
+                  << state.next_file - begin << "/" << end - begin << " files done" << std::endl;
+    } else {
+        state.next_file = begin;
+        if (options.checkpoint_every > 0) checkpoint.start();
+        else checkpoint.remove();
+    }
+    all_entries.reserve(std::max<size_t>(10000000, all_entries.size()));
+
+    std::cout << "1. Scanning corpus and tokenizing..." << std::endl;
+
+    size_t last_checkpoint = state.next_file;
+    for (size_t f = state.next_file; f < end; ++f) {
+        const std::string& path = files[f];
+        if (options.checkpoint_every > 0 && f - last_checkpoint >= options.checkpoint_every) {
+            state.next_file = f;
+            checkpoint.save(state, store);
+            last_checkpoint = f;
+        }
+
+        // 1. Токенизация
+        // Термы сразу переводятся в id; повтор терма в документе отсекается по last_doc_of_term
+        size_t entries_begin = all_entries.size();
+        uint32_t doc_length = 0;
+        std::string content = packed.is_open() ? packed.text((uint32_t)f) : read_file(path);
+        state.text_bytes += content.size();
+        auto on_term = [&](uint32_t term_id) {
+            if (dedup) simhash.add_token(term_id);
+            if (term_id == last_doc_of_term.size()) {
+                last_doc_of_term.push_back(UINT32_MAX);
+                if (options.impacts) term_entry.push_back(0);
+            }
+            if (last_doc_of_term[term_id] != current_doc_id) {
+                last_doc_of_term[term_id] = current_doc_id;
+                if (options.impacts) {
+                    term_entry[term_id] = all_entries.size();
+                    entry_tf.push_back(0);
+                }
+                all_entries.push_back({term_id, current_doc_id});
+            }
+            if (options.impacts) {
+                doc_length++;
+                uint16_t& tf = entry_tf[term_entry[term_id]];
+                if (tf < UINT16_MAX) tf++;
             }
+        };
+        doc_words.clear();
+        if (options.trigrams || options.completions) {
+            tokenizer.tokenize_words(content, [&](const std::string& word, const std::string& stem) {
+                uint32_t term_id = vocabulary.intern(stem);
+                uint32_t word_id = surface_words.intern(word);
+                if (word_id == word_term.size()) {
+                    word_term.push_back(term_id);
+                    if (options.completions) {
+                        word_df.push_back(0);
+                        last_doc_of_word.push_back(UINT32_MAX);
+                    }
+                }
+                if (options.completions && last_doc_of_word[word_id] != current_doc_id) {
+                    last_doc_of_word[word_id] = current_doc_id;
+                    word_df[word_id]++;
+                    doc_words.push_back(word_id);
+                }
+                on_term(term_id);
+            });
+        } else {
+            tokenizer.tokenize_text(content, [&](const std::string& token) { on_term(vocabulary.intern(token)); });
+        }
 
-            current_doc_id++;
-            if (current_doc_id % 1000 == 0) {
-                std::cout << "\rProcessed " << current_doc_id << " docs..." << std::flush;
+        // 2. Почти-дубликаты: сигнатура сравнивается только с представителями кластеров
+        if (dedup) {
+            bool empty = simhash.empty();
+            uint64_t signature = simhash.finish();
+            int64_t original = empty ? -1 : near_duplicates.find(signature);
+            if (original >= 0) {
+                state.duplicates++;
+                if (options.duplicates == DuplicatePolicy::DROP) {
+                    // id документа достанется следующему файлу, поэтому его отметки в last_doc_of_term снимаются
+                    for (size_t i = entries_begin; i < all_entries.size(); ++i) {
+                        last_doc_of_term[all_entries[i].term_id] = UINT32_MAX;
+                    }
+                    all_entries.resize(entries_begin);
+                    if (options.impacts) entry_tf.resize(entries_begin);
+                    for (uint32_t word_id : doc_words) {
+                        last_doc_of_word[word_id] = UINT32_MAX;
+                        word_df[word_id]--;
+                    }
+                    continue;
+                }
+                doc_cluster.push_back((uint32_t)original);
+            } else {
+                if (!empty) {
+                    near_duplicates.add(signature, current_doc_id);
+                    state.representatives.push_back({signature, current_doc_id});
+                }
+                doc_cluster.push_back(current_doc_id);
             }
         }
+
+        // 3. Метаданные и текст в хранилище
+        DocMeta meta;
+        meta.id = current_doc_id;
+        meta.path = path;
+        meta.title = title_of(content);
+        meta.length = doc_length;
+        docs.push_back(meta);
+        file_of_doc.push_back((uint32_t)f);
+        store.add(content);
+
+        current_doc_id++;
+        if (current_doc_id % 1000 == 0) {
+            std::cout << "\rProcessed " << current_doc_id << " docs..." << std::flush;
+        }
     }
+    stats.text_bytes = state.text_bytes;
+    stats.duplicates = state.duplicates;
     std::cout << "\nTotal documents: " << docs.size() << std::endl;
+    if (dedup) {
+        std::cout << "Near-duplicates: " << stats.duplicates << std::endl;
+    }
+    auto tokenize_end = Clock::now();
 
-    // 3. Сортировка 
+    // doc_map.bin нужен, когда doc_id перестают совпадать с номерами файлов корпуса
+    bool renumbered = options.duplicates == DuplicatePolicy::DROP && stats.duplicates > 0;
+    if (options.order != DocOrder::NONE && docs.size() > 1) {
+        std::vector<uint32_t> new_to_old = reorder_documents(all_entries, entry_tf, docs, vocabulary.size(), stats);
+        store.reorder(new_to_old);
+
+        std::vector<uint32_t> old_to_new(new_to_old.size());
+        for (uint32_t k = 0; k < new_to_old.size(); ++k) old_to_new[new_to_old[k]] = k;
+        std::vector<uint32_t> files_reordered(new_to_old.size());
+        std::vector<uint32_t> clusters_reordered(doc_cluster.empty() ? 0 : new_to_old.size());
+        for (uint32_t k = 0; k < new_to_old.size(); ++k) {
+            files_reordered[k] = file_of_doc[new_to_old[k]];
+            if (!doc_cluster.empty()) clusters_reordered[k] = old_to_new[doc_cluster[new_to_old[k]]];
+        }
+        file_of_doc.swap(files_reordered);
+        doc_cluster.swap(clusters_reordered);
+        renumbered = true;
+    }
+    store.finish();
+    auto reorder_end = Clock::now();
+
+    // 3. Сортировка: записи идут в порядке doc_id, поэтому устойчивой
+    // поразрядной сортировки только по term_id достаточно для порядка (term, doc)
     std::cout << "2. Sorting " << all_entries.size() << " entries..." << std::endl;
-    std::sort(all_entries.begin(), all_entries.end());
+    std::vector<uint16_t> sorted_tf;
+    if (options.impacts) {
+        // Частоты переставляются тем же устойчивым распределением по term_id, что и записи
+        std::vector<size_t> cursor = term_bounds(all_entries, vocabulary.size());
+        sorted_tf.resize(entry_tf.size());
+        for (size_t i = 0; i < all_entries.size(); ++i) sorted_tf[cursor[all_entries[i].term_id]++] = entry_tf[i];
+        std::vector<uint16_t>().swap(entry_tf);
+    }
+    if (!all_entries.empty()) {
+        RadixSort::sort_by_key(all_entries, vocabulary.size() - 1,
+                               [](const IndexEntry& e) { return e.term_id; });
+    }
+    auto sort_end = Clock::now();
 
     // 4. Сохранение
     std::cout << "3. Writing indexes to disk..." << std::endl;
-    fs::create_directories(output_dir);
     
-    save_forward_index(docs, output_dir + "/docs_index.bin");
-    save_inverted_index(all_entries, output_dir + "/inverted_index.bin");
+    save_forward_index(docs, output_dir + "/docs_index.bin" + tmp);
+    save_inverted_index(all_entries, vocabulary.all_terms(), output_dir + "/inverted_index.bin" + tmp);
+    // Сначала пишутся все временные файлы, затем они подменяются разом; inverted_index.bin
+    // после остальных: по нему --resume судит, что шард собран целиком. Последним подменяется
+    // generation.bin - по нему загрузка отличает целый набор от смеси старых и новых файлов
+    std::vector<const char*> published = {"/docs_store.bin", "/docs_index.bin"};
+    std::vector<const char*> stale;
+    if (options.impacts) {
+        save_impact_index(all_entries, sorted_tf, docs, vocabulary.all_terms(), output_dir + "/impact_index.bin" + tmp);
+        published.push_back("/impact_index.bin");
+    } else {
+        stale.push_back("/impact_index.bin");
+    }
+    if (options.trigrams) {
+        save_trigram_index(surface_words.all_terms(), word_term, all_entries, vocabulary.all_terms(),
+                           output_dir + "/trigram_index.bin" + tmp);
+        published.push_back("/trigram_index.bin");
+    } else {
+        stale.push_back("/trigram_index.bin");
+    }
+    if (options.completions) {
+        save_completion_index(surface_words.all_terms(), word_df, output_dir + "/completion.bin" + tmp);
+        published.push_back("/completion.bin");
+    } else {
+        stale.push_back("/completion.bin");
+    }
+    if (options.titles) {
+        save_title_index(docs, output_dir + "/title_index.bin" + tmp);
+        published.push_back("/title_index.bin");
+    } else {
+        stale.push_back("/title_index.bin");
+    }
+    if (renumbered) {
+        save_doc_map(docs, file_of_doc, output_dir + "/doc_map.bin" + tmp);
+        published.push_back("/doc_map.bin");
+    } else {
+        stale.push_back("/doc_map.bin");
+    }
+    if (options.duplicates == DuplicatePolicy::COLLAPSE) {
+        save_clusters(doc_cluster, output_dir + "/doc_clusters.bin" + tmp);
+        published.push_back("/doc_clusters.bin");
+    } else {
+        stale.push_back("/doc_clusters.bin");
+    }
+    published.push_back("/inverted_index.bin");
+    GenerationStamp stamp;
+    stamp.build_id = build_id;
+    for (const char* name : published) stamp.files.emplace_back(name + 1, fs::file_size(output_dir + name + tmp));
+    IndexGeneration::write(IndexGeneration::stamp_path(output_dir) + tmp, stamp);
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = end_time - start_time;
+    for (const char* name : published) fs::rename(output_dir + name + tmp, output_dir + name);
+    for (const char* name : stale) fs::remove(output_dir + name);
+    fs::rename(IndexGeneration::stamp_path(output_dir) + tmp, IndexGeneration::stamp_path(output_dir));
 
-    double total_mb = total_text_size / 1024.0 / 1024.0;
-    
-    std::cout << "\n=== INDEXING REPORT ===" << std::endl;
-    std::cout << "Total time: " << elapsed.count() << " sec" << std::endl;
-    std::cout << "Indexing Speed: " << (total_mb / elapsed.count()) << " MB/s" << std::endl;
-    std::cout << "Speed per doc: " << (elapsed.count() / docs.size() * 1000) << " ms/doc" << std::endl;
+    if (options.checkpoint_every > 0) {
+        IndexCheckpoint::Summary summary;
+        summary.docs = docs.size();
+        summary.text_bytes = state.text_bytes;
+        summary.duplicates = state.duplicates;
+        checkpoint.finish(summary);
+    }
+
+    auto end_time = Clock::now();
+
+    stats.docs = docs.size();
+    stats.tokenize_sec = std::chrono::duration<double>(tokenize_end - start_time).count();
+    stats.reorder_sec = std::chrono::duration<double>(reorder_end - tokenize_end).count();
+    stats.sort_sec = std::chrono::duration<double>(sort_end - reorder_end).count();
+    stats.write_sec = std::chrono::duration<double>(end_time - sort_end).count();
+    stats.store_raw = store.raw_bytes();
+    stats.store_compressed = store.compressed_bytes();
+    return stats;
+}
+
+std::vector<uint32_t> Indexer::reorder_documents(std::vector<IndexEntry>& entries, std::vector<uint16_t>& entry_tf,
+                                                 std::vector<DocMeta>& docs, uint32_t term_count, BuildStats& stats) {
+    std::cout << "Reordering " << docs.size() << " documents ("
+              << (options.order == DocOrder::BP ? "graph bisection" : "MinHash") << ")..." << std::endl;
+
+    // Записи идут в порядке doc_id: из них сразу получается прямой индекс документ -> термы
+    std::vector<std::vector<uint32_t>> doc_terms(docs.size());
+    std::vector<size_t> doc_begin(docs.size() + 1, 0);
+    for (const auto& e : entries) {
+        doc_terms[e.doc_id].push_back(e.term_id);
+        doc_begin[e.doc_id + 1]++;
+    }
+    for (size_t d = 0; d < docs.size(); ++d) doc_begin[d + 1] += doc_begin[d];
+
+    std::vector<uint32_t> new_to_old = options.order == DocOrder::BP
+        ? DocReorder::bp_order(doc_terms, term_count)
+        : DocReorder::minhash_order(doc_terms);
+
+    stats.before = DocReorder::evaluate(doc_terms, term_count, {});
+    stats.after = DocReorder::evaluate(doc_terms, term_count, new_to_old);
+
+    // Записи перестраиваются в новом порядке документов, поэтому остаются отсортированы по doc_id
+    entries.clear();
+    std::vector<uint16_t> reordered_tf;
+    std::vector<DocMeta> reordered(docs.size());
+    for (uint32_t k = 0; k < new_to_old.size(); ++k) {
+        for (uint32_t t : doc_terms[new_to_old[k]]) entries.push_back({t, k});
+        if (!entry_tf.empty()) {
+            reordered_tf.insert(reordered_tf.end(), entry_tf.begin() + doc_begin[new_to_old[k]],
+                                entry_tf.begin() + doc_begin[new_to_old[k] + 1]);
+        }
+        reordered[k] = std::move(docs[new_to_old[k]]);
+        reordered[k].id = k;
+    }
+    docs.swap(reordered);
+    entry_tf.swap(reordered_tf);
+    return new_to_old;
+}
+
+// doc_map.bin: новый doc_id -> номер файла в отсортированном списке корпуса и его имя
+// (для упакованного корпуса - номер записи и URL)
+void Indexer::save_doc_map(const std::vector<DocMeta>& docs, const std::vector<uint32_t>& original_ids,
+                           const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary);
+
+    BinaryUtils::write_u32(out, 0x50414D44);
+    BinaryUtils::write_u32(out, (uint32_t)docs.size());
+
+    for (size_t k = 0; k < docs.size(); ++k) {
+        BinaryUtils::write_u32(out, original_ids[k]);
+        std::string name = packed.is_open() ? docs[k].path : fs::path(docs[k].path).filename().string();
+        uint16_t name_len = (uint16_t)std::min(name.size(), (size_t)65535);
+        BinaryUtils::write_u16(out, name_len);
+        out.write(name.data(), name_len);
+    }
+}
+
+// doc_clusters.bin: для каждого doc_id - id представителя его кластера почти-дубликатов
+void Indexer::save_clusters(const std::vector<uint32_t>& clusters, const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary);
+
+    BinaryUtils::write_u32(out, 0x53554C43);
+    BinaryUtils::write_u32(out, (uint32_t)clusters.size());
+    for (uint32_t cluster : clusters) BinaryUtils::write_u32(out, cluster);
 }
 
 void Indexer::save_forward_index(const std::vector<DocMeta>& docs, const std::string& filename) {
@@ -98,22 +556,36 @@ void Indexer::save_forward_index(const std::vector<DocMeta>& docs, const std::st
     }
 }
 
-void Indexer::save_inverted_index(std::vector<IndexEntry>& entries, const std::string& filename) {
-    std::ofstream out(filename, std::ios::binary);
-    
-    uint32_t unique_terms = 0;
-    long long total_term_len = 0;
+// Границы постингов каждого терма в отсортированном по term_id массиве
+std::vector<size_t> Indexer::term_bounds(const std::vector<IndexEntry>& entries, size_t term_count) {
+    std::vector<size_t> term_begin(term_count + 1, 0);
+    for (const auto& e : entries) term_begin[e.term_id + 1]++;
+    for (size_t t = 0; t < term_count; ++t) term_begin[t + 1] += term_begin[t];
+    return term_begin;
+}
 
-    if (!entries.empty()) {
-        unique_terms = 1;
-        total_term_len += entries[0].term.size();
-        for (size_t i = 1; i < entries.size(); ++i) {
-            if (entries[i].term != entries[i-1].term) {
-                unique_terms++;
-                total_term_len += entries[i].term.size();
-            }
-        }
+// Непустые термы в лексикографическом порядке - порядок словаря во всех файлах индекса
+std::vector<uint32_t> Indexer::dictionary_order(const std::vector<std::string>& terms,
+                                                const std::vector<size_t>& term_begin) {
+    std::vector<uint32_t> order;
+    order.reserve(terms.size());
+    for (uint32_t t = 0; t < terms.size(); ++t) {
+        if (term_begin[t + 1] != term_begin[t]) order.push_back(t);
     }
+    std::sort(order.begin(), order.end(), [&terms](uint32_t a, uint32_t b) { return terms[a] < terms[b]; });
+    return order;
+}
+
+void Indexer::save_inverted_index(const std::vector<IndexEntry>& entries, const std::vector<std::string>& terms,
+                                  const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary);
+
+    std::vector<size_t> term_begin = term_bounds(entries, terms.size());
+    std::vector<uint32_t> order = dictionary_order(terms, term_begin);
+
+    long long total_term_len = 0;
+    for (uint32_t t : order) total_term_len += terms[t].size();
+    uint32_t unique_terms = (uint32_t)order.size();
 
     std::cout << "Total unique terms: " << unique_terms << std::endl;
     if (unique_terms > 0)
@@ -123,54 +595,166 @@ void Indexer::save_inverted_index(std::vector<IndexEntry>& entries, const std::s
     BinaryUtils::write_u8(out, 1);           
     BinaryUtils::write_u32(out, unique_terms);
     
-    long long dictionary_start = out.tellp();
-    
-    struct DictFixup {
-        long long offset_pos_in_file; 
-        uint32_t doc_freq;
-        std::vector<uint32_t> postings; 
-    };
-    std::vector<DictFixup> fixups;
-    fixups.reserve(unique_terms);
+    // Размер словаря известен заранее, поэтому смещения постингов считаются без дозаписи.
+    // Начало постингов выравнивается на 4 байта: их можно читать из отображения как u32
+    uint64_t postings_pos = 4 + 1 + 4;
+    for (uint32_t t : order) {
+        postings_pos += 1 + std::min(terms[t].size(), (size_t)255) + 4 + 4;
+    }
+    uint64_t padding = (4 - postings_pos % 4) % 4;
+    postings_pos += padding;
     
-    if (entries.empty()) return;
+    for (uint32_t t : order) {
+        const std::string& term = terms[t];
+        uint32_t doc_freq = (uint32_t)(term_begin[t + 1] - term_begin[t]);
 
-    size_t i = 0;
-    while (i < entries.size()) {
-        std::string current_term = entries[i].term;
-        std::vector<uint32_t> current_postings;
-        
-        while (i < entries.size() && entries[i].term == current_term) {
-            if (current_postings.empty() || current_postings.back() != entries[i].doc_id) {
-                current_postings.push_back(entries[i].doc_id);
-            }
-            i++;
-        }
-        
-        uint8_t len = (uint8_t)std::min(current_term.size(), (size_t)255);
+        uint8_t len = (uint8_t)std::min(term.size(), (size_t)255);
         BinaryUtils::write_u8(out, len);
-        out.write(current_term.data(), len);
-        
-        BinaryUtils::write_u32(out, (uint32_t)current_postings.size()); 
-        
-        long long offset_pos = out.tellp();
-        BinaryUtils::write_u32(out, 0); 
+        out.write(term.data(), len);
         
-        fixups.push_back({offset_pos, (uint32_t)current_postings.size(), std::move(current_postings)});
+        BinaryUtils::write_u32(out, doc_freq); 
+        BinaryUtils::write_u32(out, (uint32_t)postings_pos);
+        postings_pos += (uint64_t)doc_freq * sizeof(uint32_t);
     }
     
-    long long postings_start = out.tellp();
-    
-    for (auto& fix : fixups) {
-        long long current_pos = out.tellp();
-        
-        out.seekp(fix.offset_pos_in_file);
-        BinaryUtils::write_u32(out, (uint32_t)current_pos);
-        
-        out.seekp(current_pos);
-        
-        for (uint32_t doc_id : fix.postings) {
-            BinaryUtils::write_u32(out, doc_id);
+    for (uint64_t i = 0; i < padding; ++i) BinaryUtils::write_u8(out, 0);
+    for (uint32_t t : order) {
+        for (size_t i = term_begin[t]; i < term_begin[t + 1]; ++i) {
+            BinaryUtils::write_u32(out, entries[i].doc_id);
+        }
+    }
+}
+
+void Indexer::save_impact_index(const std::vector<IndexEntry>& entries, const std::vector<uint16_t>& term_freqs,
+                                const std::vector<DocMeta>& docs, const std::vector<std::string>& terms,
+                                const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary);
+
+    std::vector<size_t> term_begin = term_bounds(entries, terms.size());
+    std::vector<uint32_t> order = dictionary_order(terms, term_begin);
+
+    double avg_length = 0;
+    for (const auto& doc : docs) avg_length += doc.length;
+    avg_length = docs.empty() ? 1 : std::max(1.0, avg_length / docs.size());
+
+    // 1. BM25 каждого постинга; шкала квантования - максимум по шарду
+    const double k1 = ImpactIndex::BM25_K1, b = ImpactIndex::BM25_B;
+    std::vector<float> scores(entries.size());
+    double max_score = 0;
+    for (uint32_t t : order) {
+        double df = (double)(term_begin[t + 1] - term_begin[t]);
+        double idf = std::log(1 + (docs.size() - df + 0.5) / (df + 0.5));
+        for (size_t i = term_begin[t]; i < term_begin[t + 1]; ++i) {
+            double tf = term_freqs[i];
+            double norm = k1 * (1 - b + b * docs[entries[i].doc_id].length / avg_length);
+            scores[i] = (float)(idf * tf * (k1 + 1) / (tf + norm));
+            max_score = std::max(max_score, (double)scores[i]);
         }
     }
-}
\ No newline at end of file
+    double unit = max_score > 0 ? max_score / 255 : 1;
+    std::vector<uint8_t> impacts(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        impacts[i] = (uint8_t)std::max(1.0, std::min(255.0, std::round(scores[i] / unit)));
+    }
+    std::vector<float>().swap(scores);
+
+    // 2. Голова терма - head_size(df) постингов с наибольшим impact
+    std::vector<ImpactIndex::TermImpacts> table;
+    std::vector<std::vector<uint32_t>> heads;
+    uint64_t data_pos = ImpactIndex::HEADER_BYTES + (uint64_t)order.size() * ImpactIndex::TERM_RECORD_BYTES;
+    for (uint32_t t : order) {
+        uint32_t df = (uint32_t)(term_begin[t + 1] - term_begin[t]);
+        uint32_t head_count = ImpactIndex::head_size(df);
+
+        std::vector<uint32_t> by_impact(df);
+        for (uint32_t i = 0; i < df; ++i) by_impact[i] = i;
+        const uint8_t* term_impacts = impacts.data() + term_begin[t];
+        std::stable_sort(by_impact.begin(), by_impact.end(),
+                         [term_impacts](uint32_t x, uint32_t y) { return term_impacts[x] > term_impacts[y]; });
+        uint8_t tail_max = head_count < df ? term_impacts[by_impact[head_count]] : 0;
+        by_impact.resize(head_count);
+        std::sort(by_impact.begin(), by_impact.end());
+
+        data_pos = (data_pos + 3) & ~3ULL;
+        ImpactIndex::TermImpacts info;
+        info.head_count = head_count;
+        info.head_offset = (uint32_t)data_pos;
+        info.impacts_offset = (uint32_t)(data_pos + head_count * 5ULL);
+        info.tail_max = tail_max;
+        data_pos += head_count * 5ULL + df;
+
+        table.push_back(info);
+        heads.push_back(std::move(by_impact));
+    }
+
+    BinaryUtils::write_u32(out, ImpactIndex::SIGNATURE);
+    BinaryUtils::write_u8(out, ImpactIndex::VERSION);
+    BinaryUtils::write_u32(out, (uint32_t)order.size());
+    float unit_f = (float)unit;
+    out.write((const char*)&unit_f, sizeof(unit_f));
+
+    for (const auto& info : table) {
+        BinaryUtils::write_u32(out, info.head_count);
+        BinaryUtils::write_u32(out, info.head_offset);
+        BinaryUtils::write_u32(out, info.impacts_offset);
+        BinaryUtils::write_u8(out, info.tail_max);
+    }
+
+    uint64_t head_postings = 0;
+    uint64_t pos = ImpactIndex::HEADER_BYTES + (uint64_t)order.size() * ImpactIndex::TERM_RECORD_BYTES;
+    for (size_t k = 0; k < order.size(); ++k) {
+        for (; pos < table[k].head_offset; ++pos) BinaryUtils::write_u8(out, 0);
+        pos += heads[k].size() * 5ULL + (term_begin[order[k] + 1] - term_begin[order[k]]);
+
+        size_t base = term_begin[order[k]];
+        for (uint32_t i : heads[k]) BinaryUtils::write_u32(out, entries[base + i].doc_id);
+        for (uint32_t i : heads[k]) BinaryUtils::write_u8(out, impacts[base + i]);
+        out.write((const char*)impacts.data() + base, (std::streamsize)(term_begin[order[k] + 1] - base));
+        head_postings += heads[k].size();
+    }
+
+    std::cout << "Impact index: " << head_postings << " of " << entries.size()
+              << " postings in heads" << std::endl;
+}
+
+void Indexer::save_trigram_index(const std::vector<std::string>& words, const std::vector<uint32_t>& word_term,
+                                 const std::vector<IndexEntry>& entries, const std::vector<std::string>& terms,
+                                 const std::string& filename) {
+    // Словоформа ссылается на терм по его номеру в словаре; термы без постингов
+    // (остались только от удаленных дубликатов) в словарь не попадают
+    std::vector<uint32_t> order = dictionary_order(terms, term_bounds(entries, terms.size()));
+    std::vector<uint32_t> ordinal(terms.size(), UINT32_MAX);
+    for (uint32_t k = 0; k < order.size(); ++k) ordinal[order[k]] = k;
+
+    std::vector<std::pair<std::string, uint32_t>> word_terms;
+    word_terms.reserve(words.size());
+    for (size_t w = 0; w < words.size(); ++w) {
+        if (ordinal[word_term[w]] != UINT32_MAX) word_terms.push_back({words[w], ordinal[word_term[w]]});
+    }
+    std::cout << "Trigram index: " << word_terms.size() << " word forms" << std::endl;
+    TrigramIndex::write(filename, std::move(word_terms));
+}
+
+void Indexer::save_completion_index(const std::vector<std::string>& words, const std::vector<uint32_t>& word_df,
+                                    const std::string& filename) {
+    // Словоформы только из удаленных дубликатов (doc_freq 0) не предлагаются
+    std::vector<std::pair<std::string, uint32_t>> word_dfs;
+    word_dfs.reserve(words.size());
+    for (size_t w = 0; w < words.size(); ++w) {
+        if (word_df[w] > 0) word_dfs.push_back({words[w], word_df[w]});
+    }
+    std::cout << "Completion index: " << word_dfs.size() << " word forms" << std::endl;
+    CompletionIndex::write(filename, std::move(word_dfs));
+}
+
+void Indexer::save_title_index(const std::vector<DocMeta>& docs, const std::string& filename) {
+    // Заголовки берутся после переупорядочивания и удаления дубликатов: docs[k] - документ k
+    std::vector<std::string> titles;
+    titles.reserve(docs.size());
+    for (const auto& doc : docs) titles.push_back(doc.title);
+    TitleIndex::write(filename, titles);
+
+    TitleIndex index;
+    index.open(filename);
+    std::cout << "Title index: " << index.term_count() << " terms, " << index.posting_count() << " postings" << std::endl;
+}
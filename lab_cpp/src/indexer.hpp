@@ -2,33 +2,122 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <utility>
 #include "tokenizer.hpp"
+#include "doc_reorder.hpp"
+#include "near_duplicates.hpp"
+#include "packed_corpus.hpp"
+#include "term_interner.hpp"
 
 struct IndexEntry {
-    std::string term;
+    uint32_t term_id;
     uint32_t doc_id;
-
-    bool operator<(const IndexEntry& other) const {
-        if (term != other.term) {
-            return term < other.term;
-        }
-        return doc_id < other.doc_id;
-    }
 };
 
 struct DocMeta {
     uint32_t id;
     std::string title;
     std::string path;
+    uint32_t length = 0; // число токенов, считается только для impact_index.bin
+};
+
+struct IndexerOptions {
+    uint32_t shards = 1;
+    DocOrder order = DocOrder::NONE;
+    // Почти-дубликаты: удалять из индекса или хранить кластер для схлопывания при поиске
+    DuplicatePolicy duplicates = DuplicatePolicy::KEEP;
+    int duplicate_distance = 3;
+    // Двухуровневые постинги с квантованным BM25 для ранжированного top-k
+    bool impacts = false;
+    // Триграммный индекс словоформ для запросов *подстрока*
+    bool trigrams = false;
+    // Префиксное дерево словоформ с готовыми top-k для автодополнения
+    bool completions = false;
+    // Отдельные постинги термов заголовка для запросов title:терм и буста в top-k
+    bool titles = false;
+    // Контрольная точка каждые checkpoint_every файлов корпуса (0 - без них);
+    // resume - продолжить с последней точки вместо сборки заново
+    uint32_t checkpoint_every = 10000;
+    bool resume = false;
+};
+
+// Состояние сканирования шарда - все, что нужно, чтобы продолжить сборку с контрольной точки
+struct ShardBuildState {
+    size_t next_file = 0;
+    uint32_t next_doc_id = 0;
+    uint64_t text_bytes = 0;
+    uint64_t duplicates = 0;
+
+    std::vector<DocMeta> docs;
+    std::vector<uint32_t> file_of_doc;
+    std::vector<uint32_t> doc_cluster;
+    std::vector<IndexEntry> entries;
+    std::vector<uint16_t> entry_tf;
+    TermInterner vocabulary;
+
+    // Словоформы до стемминга, терм каждой и число документов с ней
+    TermInterner surface_words;
+    std::vector<uint32_t> word_term;
+    std::vector<uint32_t> word_df;
+
+    // SimHash представителей кластеров почти-дубликатов и их doc_id
+    std::vector<std::pair<uint64_t, uint32_t>> representatives;
 };
 
 class Indexer {
 public:
+    explicit Indexer(const IndexerOptions& opt = IndexerOptions()) : options(opt) {}
+
+    // corpus_path - каталог с .txt на документ или файл упакованного корпуса
     void build_index(const std::string& corpus_path, const std::string& output_dir);
 
 private:
+    struct BuildStats {
+        size_t docs = 0;
+        long long text_bytes = 0;
+        double tokenize_sec = 0;
+        double sort_sec = 0;
+        double write_sec = 0;
+        uint64_t store_raw = 0;
+        uint64_t store_compressed = 0;
+        double reorder_sec = 0;
+        DocReorder::OrderStats before;
+        DocReorder::OrderStats after;
+        size_t duplicates = 0;
+    };
+
+    IndexerOptions options;
+    PackedCorpus packed;
+    // Общий для всех шардов сборки, пишется в generation.bin
+    uint64_t build_id = 0;
+
+    BuildStats build_shard(const std::vector<std::string>& files, size_t begin, size_t end,
+                           const std::string& output_dir);
+    std::vector<uint32_t> reorder_documents(std::vector<IndexEntry>& entries, std::vector<uint16_t>& entry_tf,
+                                            std::vector<DocMeta>& docs, uint32_t term_count, BuildStats& stats);
+    void save_doc_map(const std::vector<DocMeta>& docs, const std::vector<uint32_t>& original_ids,
+                      const std::string& filename);
+    void save_clusters(const std::vector<uint32_t>& clusters, const std::string& filename);
     void save_forward_index(const std::vector<DocMeta>& docs, const std::string& filename);
-    void save_inverted_index(std::vector<IndexEntry>& entries, const std::string& filename);
+    void save_inverted_index(const std::vector<IndexEntry>& entries, const std::vector<std::string>& terms,
+                             const std::string& filename);
+    void save_impact_index(const std::vector<IndexEntry>& entries, const std::vector<uint16_t>& term_freqs,
+                           const std::vector<DocMeta>& docs, const std::vector<std::string>& terms,
+                           const std::string& filename);
+
+    void save_trigram_index(const std::vector<std::string>& words, const std::vector<uint32_t>& word_term,
+                            const std::vector<IndexEntry>& entries, const std::vector<std::string>& terms,
+                            const std::string& filename);
+    void save_completion_index(const std::vector<std::string>& words, const std::vector<uint32_t>& word_df,
+                               const std::string& filename);
+    void save_title_index(const std::vector<DocMeta>& docs, const std::string& filename);
+
+    static std::vector<size_t> term_bounds(const std::vector<IndexEntry>& entries, size_t term_count);
+    static std::vector<uint32_t> dictionary_order(const std::vector<std::string>& terms,
+                                                  const std::vector<size_t>& term_begin);
     
-    std::string read_title(const std::string& filepath);
+    uint64_t fingerprint(const std::vector<std::string>& files, size_t begin, size_t end) const;
+    uint64_t corpus_build_id(const std::string& corpus_path, const std::vector<std::string>& files) const;
+    static std::string title_of(const std::string& content);
+    std::string read_file(const std::string& filepath);
 };
\ No newline at end of file
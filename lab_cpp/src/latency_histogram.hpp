@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Гистограмма задержек в духе HdrHistogram: значения до 2048 хранятся точно,
+// дальше каждая степень двойки делится на 1024 поддиапазона (~0.1% точности).
+// Память фиксирована и не зависит от числа замеров.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 11;
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1ull << SUB_BUCKET_BITS;
+    static constexpr uint64_t HALF_COUNT = SUB_BUCKET_COUNT / 2;
+    static constexpr int MAX_BITS = 48;
+
+    LatencyHistogram() : counts(index_of(MAX_VALUE) + 1, 0) {}
+
+    void record(uint64_t value, uint64_t count = 1) {
+        value = std::min(value, MAX_VALUE);
+        counts[index_of(value)] += count;
+        total += count;
+        max_value = std::max(max_value, value);
+        sum += (double)value * count;
+    }
+
+    // Поправка на coordinated omission: если замер длился дольше ожидаемого
+    // интервала между запросами, добавляются замеры запросов, которые клиент
+    // не успел отправить (value - interval, value - 2*interval, ...)
+    void record_corrected(uint64_t value, uint64_t expected_interval, uint64_t count = 1) {
+        record(value, count);
+        if (expected_interval == 0) return;
+        for (uint64_t missed = value; missed > expected_interval; ) {
+            missed -= expected_interval;
+            record(missed, count);
+        }
+    }
+
+    // Копия с поправкой, примененной ко всем уже записанным значениям
+    LatencyHistogram corrected(uint64_t expected_interval) const {
+        LatencyHistogram result;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            if (counts[i] > 0) result.record_corrected(value_at(i), expected_interval, counts[i]);
+        }
+        return result;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+        total += other.total;
+        max_value = std::max(max_value, other.max_value);
+        sum += other.sum;
+    }
+
+    // Верхняя граница поддиапазона, в который попадает перцентиль q (0..100)
+    uint64_t percentile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q / 100.0 * total + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(highest_equivalent(i), max_value);
+        }
+        return max_value;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+    double mean() const { return total ? sum / total : 0; }
+
+private:
+    static constexpr uint64_t MAX_VALUE = (1ull << MAX_BITS) - 1;
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+    double sum = 0;
+
+    static int bit_width(uint64_t v) {
+        int bits = 0;
+        while (v) {
+            bits++;
+            v >>= 1;
+        }
+        return bits;
+    }
+
+    // [0, 2048) - по одному значению; для v в [2^k, 2^(k+1)), k >= 11 - 1024 поддиапазона
+    static size_t index_of(uint64_t v) {
+        if (v < SUB_BUCKET_COUNT) return (size_t)v;
+        int shift = bit_width(v) - SUB_BUCKET_BITS;
+        return (size_t)(SUB_BUCKET_COUNT + (uint64_t)(shift - 1) * HALF_COUNT + ((v >> shift) - HALF_COUNT));
+    }
+
+    static uint64_t value_at(size_t index) {
+        if (index < SUB_BUCKET_COUNT) return index;
+        uint64_t rel = index - SUB_BUCKET_COUNT;
+        int shift = (int)(rel / HALF_COUNT) + 1;
+        return (HALF_COUNT + rel % HALF_COUNT) << shift;
+    }
+
+    static uint64_t highest_equivalent(size_t index) {
+        if (index < SUB_BUCKET_COUNT) return index;
+        int shift = (int)((index - SUB_BUCKET_COUNT) / HALF_COUNT) + 1;
+        return value_at(index) + (1ull << shift) - 1;
+    }
+};
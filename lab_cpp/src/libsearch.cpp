@@ -0,0 +1,130 @@
+#include "libsearch.h"
+#include "broker.hpp"
+#include <string>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <algorithm>
+
+struct search_index {
+    ShardBroker engine;
+};
+
+namespace {
+
+    thread_local std::string last_error;
+    // Полный результат запроса; переиспользуется вызовами search_query в этом потоке
+    thread_local std::vector<uint32_t> result_ids;
+
+    int fail(int code, const std::string& message) {
+        last_error = message;
+        return code;
+    }
+
+    int copy_out(const std::string& text, char* buf, size_t capacity, size_t* out_len) {
+        if (out_len) *out_len = text.size();
+        if (!buf || capacity < text.size() + 1) {
+            return fail(SEARCH_ERROR_BUFFER_TOO_SMALL, "Buffer too small: need " + std::to_string(text.size() + 1) + " bytes");
+        }
+        std::memcpy(buf, text.data(), text.size());
+        buf[text.size()] = '\0';
+        return SEARCH_OK;
+    }
+}
+
+extern "C" {
+
+int search_api_version(void) {
+    return SEARCH_API_VERSION;
+}
+
+const char* search_last_error(void) {
+    return last_error.c_str();
+}
+
+int search_open(const char* index_dir, search_index** out_index) {
+    if (!index_dir || !out_index) return fail(SEARCH_ERROR_INVALID_ARGUMENT, "index_dir and out_index are required");
+    *out_index = nullptr;
+    try {
+        auto index = std::make_unique<search_index>();
+        index->engine.load_index(index_dir);
+        *out_index = index.release();
+        return SEARCH_OK;
+    } catch (const std::exception& e) {
+        return fail(SEARCH_ERROR_IO, e.what());
+    }
+}
+
+void search_close(search_index* index) {
+    delete index;
+}
+
+int search_reload(search_index* index, const char* index_dir) {
+    if (!index) return fail(SEARCH_ERROR_INVALID_ARGUMENT, "index is required");
+    try {
+        if (!index->engine.start_reload(index_dir ? index_dir : "")) {
+            return fail(SEARCH_ERROR_BUSY, "Reload already in progress");
+        }
+        return SEARCH_OK;
+    } catch (const std::exception& e) {
+        return fail(SEARCH_ERROR_IO, e.what());
+    }
+}
+
+uint32_t search_doc_count(const search_index* index) {
+    return index ? index->engine.get_total_docs() : 0;
+}
+
+int search_query(search_index* index, const char* query, uint32_t offset, uint32_t limit,
+                 uint32_t* doc_ids, uint32_t capacity, uint32_t* out_count, uint32_t* out_total) {
+    if (out_count) *out_count = 0;
+    if (out_total) *out_total = 0;
+    if (!index || !query || (!doc_ids && capacity > 0)) {
+        return fail(SEARCH_ERROR_INVALID_ARGUMENT, "index, query and doc_ids are required");
+    }
+    try {
+        std::vector<uint32_t>& ids = result_ids;
+        index->engine.search_ids(query, ids);
+        size_t begin = std::min<size_t>(offset, ids.size());
+        size_t count = std::min<size_t>({(size_t)limit, (size_t)capacity, ids.size() - begin});
+        if (count > 0) std::memcpy(doc_ids, ids.data() + begin, count * sizeof(uint32_t));
+        if (out_count) *out_count = (uint32_t)count;
+        if (out_total) *out_total = (uint32_t)ids.size();
+        return SEARCH_OK;
+    } catch (const std::exception& e) {
+        return fail(SEARCH_ERROR_QUERY, e.what());
+    }
+}
+
+int search_title(search_index* index, uint32_t doc_id, char* buf, size_t capacity, size_t* out_len) {
+    if (!index) return fail(SEARCH_ERROR_INVALID_ARGUMENT, "index is required");
+    std::optional<std::string> title = index->engine.get_title(doc_id);
+    if (!title) return fail(SEARCH_ERROR_NOT_FOUND, "No document " + std::to_string(doc_id));
+    return copy_out(*title, buf, capacity, out_len);
+}
+
+int search_document(search_index* index, uint32_t doc_id, char* buf, size_t capacity, size_t* out_len) {
+    if (!index) return fail(SEARCH_ERROR_INVALID_ARGUMENT, "index is required");
+    if (doc_id >= index->engine.get_total_docs()) return fail(SEARCH_ERROR_NOT_FOUND, "No document " + std::to_string(doc_id));
+    try {
+        return copy_out(index->engine.get_document(doc_id), buf, capacity, out_len);
+    } catch (const std::exception& e) {
+        return fail(SEARCH_ERROR_IO, e.what());
+    }
+}
+
+int search_snippet(search_index* index, const char* query, uint32_t doc_id,
+                   char* buf, size_t capacity, size_t* out_len) {
+    if (!index || !query) return fail(SEARCH_ERROR_INVALID_ARGUMENT, "index and query are required");
+    if (doc_id >= index->engine.get_total_docs()) return fail(SEARCH_ERROR_NOT_FOUND, "No document " + std::to_string(doc_id));
+    try {
+        auto terms = SearchEngine::query_terms(query);
+        return copy_out(index->engine.make_snippet(doc_id, terms), buf, capacity, out_len);
+    } catch (const std::exception& e) {
+        return fail(SEARCH_ERROR_IO, e.what());
+    }
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef LIBSEARCH_H
+#define LIBSEARCH_H
+
+/*
+ * C API поискового движка для встраивания в другой процесс (Python ctypes/cffi и т.п.).
+ *
+ * Все функции возвращают код SEARCH_OK или код ошибки; текст последней ошибки
+ * потока - search_last_error(). Исключения C++ наружу не выходят.
+ * Результаты пишутся в буферы вызывающей стороны: наружу библиотека память не отдает.
+ * Один дескриптор можно использовать из нескольких потоков одновременно.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#  ifdef LIBSEARCH_BUILD
+#    define SEARCH_API __declspec(dllexport)
+#  else
+#    define SEARCH_API __declspec(dllimport)
+#  endif
+#else
+#  define SEARCH_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SEARCH_API_VERSION 2
+
+enum {
+    SEARCH_OK = 0,
+    SEARCH_ERROR_INVALID_ARGUMENT = 1,
+    SEARCH_ERROR_IO = 2,              /* индекс не найден или поврежден */
+    SEARCH_ERROR_QUERY = 3,           /* ошибка разбора/выполнения запроса */
+    SEARCH_ERROR_NOT_FOUND = 4,       /* нет документа с таким id */
+    SEARCH_ERROR_BUFFER_TOO_SMALL = 5, /* *out_len содержит нужный размер */
+    SEARCH_ERROR_BUSY = 6              /* перезагрузка индекса уже идет */
+};
+
+typedef struct search_index search_index;
+
+SEARCH_API int search_api_version(void);
+SEARCH_API const char* search_last_error(void);
+
+/* Открывает индекс (в том числе шардированный) из каталога lab4_indexer */
+SEARCH_API int search_open(const char* index_dir, search_index** out_index);
+SEARCH_API void search_close(search_index* index);
+
+/*
+ * Перезагружает индекс в фоне (index_dir == NULL - из того же каталога). Запросы
+ * продолжают обслуживаться старым индексом до подмены; ошибка загрузки оставляет его.
+ * SEARCH_ERROR_BUSY - предыдущая перезагрузка еще не закончилась.
+ */
+SEARCH_API int search_reload(search_index* index, const char* index_dir);
+
+SEARCH_API uint32_t search_doc_count(const search_index* index);
+
+/*
+ * Выполняет запрос и пишет в doc_ids до min(limit, capacity) id документов,
+ * начиная с позиции offset в отсортированном по id результате.
+ * out_count - сколько id записано, out_total - сколько документов найдено всего
+ * (любой из указателей может быть NULL). Полный результат собирается во внутреннем
+ * буфере потока, который переиспользуется между вызовами; в doc_ids копируется только страница.
+ */
+SEARCH_API int search_query(search_index* index, const char* query, uint32_t offset, uint32_t limit,
+                            uint32_t* doc_ids, uint32_t capacity, uint32_t* out_count, uint32_t* out_total);
+
+/*
+ * Заголовок, текст документа и HTML-сниппет по запросу копируются в buf (с завершающим нулем).
+ * Если buf мал, возвращается SEARCH_ERROR_BUFFER_TOO_SMALL и нужный размер без нуля в *out_len.
+ */
+SEARCH_API int search_title(search_index* index, uint32_t doc_id, char* buf, size_t capacity, size_t* out_len);
+SEARCH_API int search_document(search_index* index, uint32_t doc_id, char* buf, size_t capacity, size_t* out_len);
+SEARCH_API int search_snippet(search_index* index, const char* query, uint32_t doc_id,
+                              char* buf, size_t capacity, size_t* out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
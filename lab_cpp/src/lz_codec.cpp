@@ -0,0 +1,122 @@
+#include "lz_codec.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 14;
+
+uint32_t read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+uint32_t hash_seq(uint32_t v) {
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void write_length(std::string& out, size_t len) {
+    while (len >= 255) {
+        out += (char)255;
+        len -= 255;
+    }
+    out += (char)len;
+}
+
+void emit_sequence(std::string& out, const char* literals, size_t lit_len, size_t offset, size_t match_len) {
+    size_t ml = match_len >= MIN_MATCH ? match_len - MIN_MATCH : 0;
+    uint8_t token = (uint8_t)((std::min(lit_len, (size_t)15) << 4) | std::min(ml, (size_t)15));
+    out += (char)token;
+    if (lit_len >= 15) write_length(out, lit_len - 15);
+    out.append(literals, lit_len);
+    if (match_len == 0) return;
+    out += (char)(offset & 0xFF);
+    out += (char)(offset >> 8);
+    if (ml >= 15) write_length(out, ml - 15);
+}
+
+}
+
+std::string LzCodec::compress(const char* src, size_t size) {
+    std::string out;
+    out.reserve(size / 2 + 16);
+
+    std::vector<int64_t> table((size_t)1 << HASH_BITS, -1);
+    size_t anchor = 0;
+    size_t i = 0;
+
+    // Последние байты всегда уходят литералами, чтобы чтение по 4 байта не выходило за буфер
+    size_t limit = size > MIN_MATCH + 8 ? size - MIN_MATCH - 8 : 0;
+
+    while (i < limit) {
+        uint32_t seq = read32(src + i);
+        uint32_t h = hash_seq(seq);
+        int64_t candidate = table[h];
+        table[h] = (int64_t)i;
+
+        if (candidate < 0 || i - candidate > MAX_OFFSET || read32(src + candidate) != seq) {
+            i++;
+            continue;
+        }
+
+        size_t match_len = MIN_MATCH;
+        while (i + match_len < size && src[candidate + match_len] == src[i + match_len]) {
+            match_len++;
+        }
+
+        emit_sequence(out, src + anchor, i - anchor, i - (size_t)candidate, match_len);
+        i += match_len;
+        anchor = i;
+    }
+
+    emit_sequence(out, src + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+void LzCodec::decompress(const char* src, size_t size, char* dst, size_t raw_size) {
+    size_t ip = 0, op = 0;
+
+    auto read_length = [&](size_t base) {
+        size_t len = base;
+        if (base == 15) {
+            uint8_t b;
+            do {
+                if (ip >= size) throw std::runtime_error("LZ stream truncated");
+                b = (uint8_t)src[ip++];
+                len += b;
+            } while (b == 255);
+        }
+        return len;
+    };
+
+    while (ip < size) {
+        uint8_t token = (uint8_t)src[ip++];
+
+        size_t lit_len = read_length(token >> 4);
+        if (ip + lit_len > size || op + lit_len > raw_size) throw std::runtime_error("LZ literal overflow");
+        std::memcpy(dst + op, src + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip == size) break;
+
+        if (ip + 2 > size) throw std::runtime_error("LZ offset truncated");
+        size_t offset = (uint8_t)src[ip] | ((size_t)(uint8_t)src[ip + 1] << 8);
+        ip += 2;
+        size_t match_len = read_length(token & 0x0F) + MIN_MATCH;
+
+        if (offset == 0 || offset > op || op + match_len > raw_size) throw std::runtime_error("LZ match out of range");
+        // Совпадение может перекрываться с выходом, поэтому копируем побайтно
+        for (size_t k = 0; k < match_len; ++k) {
+            dst[op + k] = dst[op - offset + k];
+        }
+        op += match_len;
+    }
+
+    if (op != raw_size) throw std::runtime_error("LZ size mismatch");
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Самодостаточный LZ77-кодек в духе LZ4: последовательности
+// [токен][литералы][смещение u16][доп. длина совпадения].
+namespace LzCodec {
+    std::string compress(const char* src, size_t size);
+    void decompress(const char* src, size_t size, char* dst, size_t raw_size);
+}
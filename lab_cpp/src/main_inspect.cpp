@@ -0,0 +1,227 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include "binary_utils.hpp"
+#include "postings_codecs.hpp"
+#include "shard_manifest.hpp"
+#include "impact_index.hpp"
+
+namespace fs = std::filesystem;
+
+struct TermStat {
+    std::string term;
+    uint32_t doc_freq;
+    uint32_t offset;
+};
+
+std::string format_bytes(uint64_t bytes) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(2);
+    if (bytes >= 1024 * 1024) os << bytes / 1024.0 / 1024.0 << " MB";
+    else if (bytes >= 1024) os << bytes / 1024.0 << " KB";
+    else os << bytes << " B";
+    return os.str();
+}
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) throw std::runtime_error("Cannot open " + path);
+    in.seekg(0, std::ios::end);
+    std::string data((size_t)in.tellg(), '\0');
+    in.seekg(0);
+    in.read(&data[0], data.size());
+    return data;
+}
+
+uint32_t load_u32(const std::string& data, size_t pos) {
+    uint32_t v = 0;
+    if (pos + 4 <= data.size()) std::memcpy(&v, data.data() + pos, 4);
+    return v;
+}
+
+void inspect_docs(const std::string& dir) {
+    std::string docs = read_all(dir + "/docs_index.bin");
+    uint32_t count = load_u32(docs, 4);
+    uint64_t title_bytes = 0, url_bytes = 0;
+    size_t pos = 8;
+    // Каждое поле - длина u16 и байты; запись не должна выходить за конец файла
+    auto field = [&]() -> uint16_t {
+        uint16_t len = 0;
+        if (pos + 2 > docs.size()) throw std::runtime_error("Corrupted docs index: record truncated");
+        std::memcpy(&len, docs.data() + pos, 2);
+        if (pos + 2 + len > docs.size()) throw std::runtime_error("Corrupted docs index: record truncated");
+        pos += 2 + len;
+        return len;
+    };
+    for (uint32_t i = 0; i < count; ++i) {
+        title_bytes += field();
+        url_bytes += field();
+    }
+    std::cout << "docs_index.bin:     " << format_bytes(docs.size()) << " (" << count << " docs, titles "
+              << format_bytes(title_bytes) << ", urls " << format_bytes(url_bytes) << ")" << std::endl;
+
+    std::ifstream store(dir + "/docs_store.bin", std::ios::binary);
+    if (!store.is_open()) return;
+    store.seekg(0, std::ios::end);
+    uint64_t store_size = store.tellg();
+    if (store_size < 9 + 4 + 4 + 8) throw std::runtime_error("Corrupted doc store: file too short");
+    store.seekg(-8, std::ios::end);
+    uint64_t tables_offset = BinaryUtils::read_u64(store);
+    if (tables_offset < 9 || tables_offset + 4 > store_size - 8) throw std::runtime_error("Corrupted doc store: bad tables offset");
+    store.seekg(tables_offset);
+    uint32_t blocks = BinaryUtils::read_u32(store);
+    if (tables_offset + 4 + (uint64_t)blocks * 16 > store_size - 8) throw std::runtime_error("Corrupted doc store: block table out of bounds");
+    uint64_t raw = 0;
+    for (uint32_t b = 0; b < blocks; ++b) {
+        BinaryUtils::read_u64(store);
+        BinaryUtils::read_u32(store);
+        raw += BinaryUtils::read_u32(store);
+    }
+    std::cout << "docs_store.bin:     " << format_bytes(store_size) << " (" << blocks << " blocks, tables "
+              << format_bytes(store_size - tables_offset) << ", raw text " << format_bytes(raw) << ", ratio "
+              << std::setprecision(3) << (raw ? (double)tables_offset / raw : 0) << ")" << std::endl;
+}
+
+void inspect_index(const std::string& dir) {
+    std::cout << "\n=== INDEX: " << dir << " ===" << std::endl;
+
+    std::string inv = read_all(dir + "/inverted_index.bin");
+    if (load_u32(inv, 0) != 0x5A584449) throw std::runtime_error("Invalid inverted index signature");
+    uint32_t term_count = load_u32(inv, 5);
+
+    std::vector<TermStat> terms;
+    terms.reserve(term_count);
+    size_t pos = 9;
+    for (uint32_t i = 0; i < term_count; ++i) {
+        if (pos >= inv.size()) throw std::runtime_error("Corrupted inverted index: dictionary truncated");
+        uint8_t len = (uint8_t)inv[pos];
+        if (pos + 9 + len > inv.size()) throw std::runtime_error("Corrupted inverted index: dictionary truncated");
+        TermStat t;
+        t.term = inv.substr(pos + 1, len);
+        t.doc_freq = load_u32(inv, pos + 1 + len);
+        t.offset = load_u32(inv, pos + 5 + len);
+        terms.push_back(t);
+        pos += 9 + len;
+    }
+    uint64_t dictionary_bytes = pos - 9;
+    // Постинги начинаются со смещения первого терма: между словарем и ними выравнивание
+    uint64_t postings_begin = terms.empty() ? pos : terms.front().offset;
+    if (postings_begin < pos || postings_begin > inv.size()) throw std::runtime_error("Corrupted inverted index: bad postings offset");
+    uint64_t postings_bytes = inv.size() - postings_begin;
+
+    // 1. Размеры секций
+    std::cout << "\n--- Sections ---" << std::endl;
+    std::cout << "inverted_index.bin: " << format_bytes(inv.size()) << std::endl;
+    std::cout << "  header:     " << format_bytes(9) << std::endl;
+    std::cout << "  dictionary: " << format_bytes(dictionary_bytes) << " ("
+              << (term_count ? (double)dictionary_bytes / term_count : 0) << " B/term)" << std::endl;
+    std::cout << "  postings:   " << format_bytes(postings_bytes) << std::endl;
+    inspect_docs(dir);
+    if (fs::exists(dir + "/impact_index.bin")) {
+        std::string impacts = read_all(dir + "/impact_index.bin");
+        uint32_t impact_terms = load_u32(impacts, 5);
+        uint64_t head_postings = 0;
+        for (uint32_t i = 0; i < impact_terms; ++i) head_postings += load_u32(impacts, ImpactIndex::HEADER_BYTES + (size_t)i * ImpactIndex::TERM_RECORD_BYTES);
+        std::cout << "impact_index.bin:   " << format_bytes(impacts.size()) << " (" << head_postings
+                  << " postings in heads)" << std::endl;
+    }
+
+    // 2. Распределение длин постингов по степеням двойки
+    uint64_t total_postings = 0;
+    for (const auto& t : terms) total_postings += t.doc_freq;
+
+    std::cout << "\n--- Postings ---" << std::endl;
+    std::cout << "Terms: " << term_count << ", postings: " << total_postings << std::endl;
+    if (term_count == 0) return;
+
+    std::vector<uint32_t> lengths;
+    for (const auto& t : terms) lengths.push_back(t.doc_freq);
+    std::sort(lengths.begin(), lengths.end());
+    std::cout << "Length avg " << (double)total_postings / term_count << ", median " << lengths[lengths.size() / 2]
+              << ", p99 " << lengths[lengths.size() * 99 / 100] << ", max " << lengths.back() << std::endl;
+    std::cout << "Bytes per posting: " << (double)postings_bytes / total_postings << " (postings), "
+              << (double)inv.size() / total_postings << " (whole file)" << std::endl;
+
+    std::cout << "\n" << std::left << std::setw(16) << "doc_freq" << std::right << std::setw(10) << "terms"
+              << std::setw(10) << "%terms" << std::setw(12) << "postings" << std::setw(11) << "%postings" << std::endl;
+    for (uint64_t lo = 1; lo <= lengths.back(); lo *= 2) {
+        uint64_t hi = lo * 2 - 1;
+        uint64_t n_terms = 0, n_postings = 0;
+        for (uint32_t len : lengths) {
+            if (len >= lo && len <= hi) {
+                n_terms++;
+                n_postings += len;
+            }
+        }
+        std::string range = lo == hi ? std::to_string(lo) : std::to_string(lo) + "-" + std::to_string(hi);
+        std::cout << std::left << std::setw(16) << range << std::right << std::setw(10) << n_terms
+                  << std::setw(9) << std::fixed << std::setprecision(1) << 100.0 * n_terms / term_count << "%"
+                  << std::setw(12) << n_postings << std::setw(10) << 100.0 * n_postings / total_postings << "%"
+                  << std::endl;
+    }
+
+    // 3. Самые длинные списки
+    std::vector<TermStat> largest = terms;
+    size_t top = std::min<size_t>(20, largest.size());
+    std::partial_sort(largest.begin(), largest.begin() + top, largest.end(),
+                      [](const TermStat& a, const TermStat& b) { return a.doc_freq > b.doc_freq; });
+    std::cout << "\n--- Largest terms ---" << std::endl;
+    for (size_t i = 0; i < top; ++i) {
+        std::cout << std::setw(3) << i + 1 << ". " << largest[i].term << "  df=" << largest[i].doc_freq
+                  << "  (" << format_bytes((uint64_t)largest[i].doc_freq * 4) << ")" << std::endl;
+    }
+
+    // 4. Оценка сжатия постингов альтернативными кодеками
+    uint64_t vbyte = 0, gamma = 0, delta = 0, bp128 = 0;
+    for (const auto& t : terms) {
+        std::vector<uint32_t> docs(t.doc_freq);
+        if (t.offset + (uint64_t)t.doc_freq * 4 > inv.size()) throw std::runtime_error("Postings out of file bounds: " + t.term);
+        std::memcpy(docs.data(), inv.data() + t.offset, docs.size() * 4);
+        vbyte += PostingsCodecs::vbyte_bytes(docs.data(), docs.size());
+        gamma += (PostingsCodecs::gamma_bits(docs.data(), docs.size()) + 7) / 8;
+        delta += (PostingsCodecs::delta_bits(docs.data(), docs.size()) + 7) / 8;
+        bp128 += PostingsCodecs::bitpacking128_bytes(docs.data(), docs.size());
+    }
+
+    std::cout << "\n--- Compression estimates (postings, d-gaps) ---" << std::endl;
+    auto row = [&](const std::string& name, uint64_t bytes) {
+        std::cout << std::left << std::setw(16) << name << std::right << std::setw(12) << format_bytes(bytes)
+                  << std::setw(8) << std::setprecision(2) << 8.0 * bytes / total_postings << " bits/posting"
+                  << std::setw(8) << (double)postings_bytes / bytes << "x" << std::endl;
+    };
+    row("raw uint32", postings_bytes);
+    row("VByte", vbyte);
+    row("Elias-gamma", gamma);
+    row("Elias-delta", delta);
+    row("BitPacking-128", bp128);
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    system("chcp 65001 > nul");
+#endif
+
+    std::string index_dir = argc > 1 ? argv[1] : "../../index_data";
+
+    try {
+        auto shards = ShardManifest::read(index_dir);
+        if (shards.empty()) {
+            inspect_index(index_dir);
+        } else {
+            std::cout << "Sharded index: " << shards.size() << " shards" << std::endl;
+            for (uint32_t k = 0; k < shards.size(); ++k) {
+                inspect_index(ShardManifest::shard_dir(index_dir, k));
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
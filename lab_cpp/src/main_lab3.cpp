@@ -3,48 +3,180 @@
 #include <chrono>
 #include <vector>
 #include <iomanip>
+#include <thread>
+#include <atomic>
+#include <memory>
 #include "custom_map.hpp"
+#include "sketches.hpp"
 #include "tokenizer.hpp"
+#include "packed_corpus.hpp"
 
 namespace fs = std::filesystem;
 
-int main() {
+struct StatsOptions {
+    unsigned threads = 1;
+    bool approx = false;
+    size_t top_k = 1000;
+    size_t cms_width = 1 << 16;
+    size_t cms_depth = 4;
+    int hll_precision = 14;
+    // Упакованный корпус, если он выгружен; иначе каталог с файлами
+    std::string corpus_path = fs::exists("../../corpus.pack") ? "../../corpus.pack" : "../../corpus_txt";
+};
+
+// Состояние одного потока: точный словарь либо скетчи фиксированного размера.
+struct StatsWorker {
+    std::unique_ptr<CustomMap> freq;
+    std::unique_ptr<CountMinSketch> cms;
+    std::unique_ptr<HyperLogLog> hll;
+    std::unique_ptr<TopK> top;
+    long long tokens = 0;
+    long long token_bytes = 0;
+
+    explicit StatsWorker(const StatsOptions& opt) {
+        if (opt.approx) {
+            cms = std::make_unique<CountMinSketch>(opt.cms_width, opt.cms_depth);
+            hll = std::make_unique<HyperLogLog>(opt.hll_precision);
+            top = std::make_unique<TopK>(opt.top_k);
+        } else {
+            freq = std::make_unique<CustomMap>(100000);
+        }
+    }
+
+    void add(const std::string& token) {
+        tokens++;
+        token_bytes += token.size();
+        if (freq) {
+            freq->increment(token);
+            return;
+        }
+        uint64_t h = hash64(token);
+        uint32_t est = cms->add(h);
+        hll->add(h);
+        top->offer(token, h, est);
+    }
+};
+
+bool parse_options(int argc, char* argv[], StatsOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--approx") opt.approx = true;
+        else if (arg == "--corpus" && has_value) opt.corpus_path = argv[++i];
+        else if (arg == "--threads" && has_value) opt.threads = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--topk" && has_value) opt.top_k = std::stoul(argv[++i]);
+        else if (arg == "--cms-width" && has_value) opt.cms_width = std::stoul(argv[++i]);
+        else if (arg == "--cms-depth" && has_value) opt.cms_depth = std::stoul(argv[++i]);
+        else if (arg == "--hll-precision" && has_value) opt.hll_precision = std::min(18, std::max(4, std::stoi(argv[++i])));
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            std::cerr << "Usage: lab3 [--corpus DIR|FILE.pack] [--threads N] [--approx] [--topk K] [--cms-width W] [--cms-depth D] [--hll-precision P]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
 #ifdef _WIN32
     system("chcp 65001 > nul");
 #endif
 
+    StatsOptions opt;
+    if (!parse_options(argc, argv, opt)) return 1;
+
     std::cout << "=== Lab 3: Tokenization & Zipf Law ===" << std::endl;
-    std::string corpus_path = "../../corpus_txt";
+    const std::string& corpus_path = opt.corpus_path;
 
     if (!fs::exists(corpus_path)) {
-        std::cerr << "Error: Directory " << corpus_path << " not found!" << std::endl;
+        std::cerr << "Error: Corpus " << corpus_path << " not found!" << std::endl;
         std::cerr << "Please run export_corpus.py first." << std::endl;
         return 1;
     }
 
-    CustomMap freq_dict(100000); 
-    Tokenizer tokenizer;
-
-    long long total_files = 0;
     long long total_bytes = 0;
-    
+    std::vector<std::string> files;
+
     auto start_time = std::chrono::high_resolution_clock::now();
 
     std::cout << "Reading files from: " << corpus_path << std::endl;
-    for (const auto& entry : fs::directory_iterator(corpus_path)) {
-        if (entry.path().extension() == ".txt") {
-            std::string filepath = entry.path().string();
-            
-            total_bytes += fs::file_size(entry.path());
-            total_files++;
-
-            tokenizer.tokenize_file(filepath, freq_dict);
-            
-            if (total_files % 1000 == 0) {
-                std::cout << "Processed " << total_files << " files..." << std::endl;
+    PackedCorpus packed;
+    if (fs::is_regular_file(corpus_path)) {
+        packed.open(corpus_path);
+    } else {
+        for (const auto& entry : fs::directory_iterator(corpus_path)) {
+            if (entry.path().extension() == ".txt") {
+                total_bytes += fs::file_size(entry.path());
+                files.push_back(entry.path().string());
             }
         }
     }
+    size_t doc_count = packed.is_open() ? packed.size() : files.size();
+    long long total_files = (long long)doc_count;
+    std::atomic<long long> packed_bytes{0};
+
+    std::cout << "Mode: " << (opt.approx ? "approximate" : "exact")
+              << ", threads: " << opt.threads << std::endl;
+
+    // 1. Подсчет: каждый поток берет следующий файл и считает в свою структуру
+    std::vector<std::unique_ptr<StatsWorker>> workers;
+    for (unsigned t = 0; t < opt.threads; ++t) {
+        workers.push_back(std::make_unique<StatsWorker>(opt));
+    }
+
+    std::atomic<size_t> next_file{0};
+    std::atomic<size_t> processed{0};
+    auto run_worker = [&](StatsWorker& worker) {
+        Tokenizer tokenizer;
+        auto on_token = [&worker](const std::string& token) { worker.add(token); };
+        size_t i;
+        while ((i = next_file.fetch_add(1)) < doc_count) {
+            if (packed.is_open()) {
+                std::string text = packed.text((uint32_t)i);
+                packed_bytes += (long long)text.size();
+                tokenizer.tokenize_text(text, on_token);
+            } else {
+                tokenizer.tokenize_file(files[i], on_token);
+            }
+            size_t done = processed.fetch_add(1) + 1;
+            if (done % 1000 == 0) {
+                std::cout << "Processed " << done << " files..." << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < opt.threads; ++t) {
+        threads.emplace_back(run_worker, std::ref(*workers[t]));
+    }
+    run_worker(*workers[0]);
+    for (auto& th : threads) th.join();
+    total_bytes += packed_bytes;
+
+    // 2. Слияние результатов потоков в первый
+    StatsWorker& merged = *workers[0];
+    for (unsigned t = 1; t < opt.threads; ++t) {
+        StatsWorker& w = *workers[t];
+        merged.tokens += w.tokens;
+        merged.token_bytes += w.token_bytes;
+        if (opt.approx) {
+            merged.cms->merge(*w.cms);
+            merged.hll->merge(*w.hll);
+        } else {
+            for (const auto& item : w.freq->get_all_items()) {
+                merged.freq->add(item.key, item.value);
+            }
+        }
+    }
+    if (opt.approx && opt.threads > 1) {
+        auto top = std::make_unique<TopK>(opt.top_k);
+        for (const auto& w : workers) {
+            for (const auto& item : w->top->get_sorted_items()) {
+                top->offer(item.key, item.hash, merged.cms->estimate(item.hash));
+            }
+        }
+        merged.top = std::move(top);
+    }
 
     auto end_time = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end_time - start_time;
@@ -52,20 +184,35 @@ int main() {
     std::cout << "\n=== STATISTICS ===" << std::endl;
     std::cout << "Total files: " << total_files << std::endl;
     std::cout << "Total size:  " << total_bytes / 1024.0 / 1024.0 << " MB" << std::endl;
-    std::cout << "Unique tokens: " << freq_dict.size() << std::endl;
-    
-    long long total_tokens_count = 0;
-    long long total_token_length = 0;
-    auto all_items = freq_dict.get_all_items();
-    
-    for (const auto& item : all_items) {
-        total_tokens_count += item.value;
-        total_token_length += (item.key.length() * item.value);
+
+    std::vector<Node> zipf_items;
+    if (opt.approx) {
+        double unique = merged.hll->estimate();
+        double err = merged.hll->relative_error();
+        std::cout << "Unique tokens: ~" << (long long)unique
+                  << " (HLL, +-" << err * 100 << "% = +-" << (long long)(unique * err) << ")" << std::endl;
+        for (const auto& item : merged.top->get_sorted_items()) {
+            zipf_items.emplace_back(item.key, (int)item.count);
+        }
+    } else {
+        std::cout << "Unique tokens: " << merged.freq->size() << std::endl;
+        zipf_items = merged.freq->get_all_items();
+    }
+
+    std::cout << "Total tokens: " << merged.tokens << std::endl;
+    if (merged.tokens > 0) {
+        std::cout << "Avg token length: " << (double)merged.token_bytes / merged.tokens << std::endl;
     }
-    
-    std::cout << "Total tokens: " << total_tokens_count << std::endl;
-    if (total_tokens_count > 0) {
-        std::cout << "Avg token length: " << (double)total_token_length / total_tokens_count << std::endl;
+
+    if (opt.approx) {
+        const CountMinSketch& cms = *merged.cms;
+        std::cout << "\n=== SKETCHES ===" << std::endl;
+        std::cout << "Count-Min: " << opt.cms_width << " x " << opt.cms_depth
+                  << ", overestimate <= " << (long long)(cms.epsilon() * merged.tokens)
+                  << " with probability " << cms.confidence() << std::endl;
+        std::cout << "Heavy hitters: top " << merged.top->size() << std::endl;
+        std::cout << "Sketch memory per thread: "
+                  << (cms.memory_bytes() + merged.hll->memory_bytes()) / 1024.0 << " KB" << std::endl;
     }
 
     std::cout << "\n=== PERFORMANCE ===" << std::endl;
@@ -75,11 +222,11 @@ int main() {
 
     std::ofstream csv_file("zipf_data.csv");
     csv_file << "word,frequency\n";
-    for (const auto& item : all_items) {
+    for (const auto& item : zipf_items) {
         csv_file << item.key << "," << item.value << "\n";
     }
     csv_file.close();
     std::cout << "\nData for Zipf plot saved to 'zipf_data.csv'" << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,18 +1,68 @@
 #include <iostream>
 #include <filesystem>
 #include <chrono>
+#include <algorithm>
 #include "indexer.hpp"
 
 namespace fs = std::filesystem;
 
-int main() {
+int main(int argc, char* argv[]) {
 #ifdef _WIN32
     system("chcp 65001 > nul");
 #endif
 
+    IndexerOptions options;
+    // Упакованный корпус, если он выгружен; иначе каталог с файлами
+    std::string corpus_path = fs::exists("../../corpus.pack") ? "../../corpus.pack" : "../../corpus_txt";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--corpus" && i + 1 < argc) {
+            corpus_path = argv[++i];
+        } else if (arg == "--shards" && i + 1 < argc) {
+            options.shards = (uint32_t)std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            std::string order = argv[++i];
+            if (order == "none") options.order = DocOrder::NONE;
+            else if (order == "minhash") options.order = DocOrder::MINHASH;
+            else if (order == "bp") options.order = DocOrder::BP;
+            else {
+                std::cerr << "Unknown reorder method: " << order << " (expected none, minhash or bp)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--dedup" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "none") options.duplicates = DuplicatePolicy::KEEP;
+            else if (policy == "drop") options.duplicates = DuplicatePolicy::DROP;
+            else if (policy == "collapse") options.duplicates = DuplicatePolicy::COLLAPSE;
+            else {
+                std::cerr << "Unknown dedup policy: " << policy << " (expected none, drop or collapse)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--dedup-distance" && i + 1 < argc) {
+            options.duplicate_distance = std::max(0, std::min(15, std::stoi(argv[++i])));
+        } else if (arg == "--impacts") {
+            options.impacts = true;
+        } else if (arg == "--trigrams") {
+            options.trigrams = true;
+        } else if (arg == "--completions") {
+            options.completions = true;
+        } else if (arg == "--titles") {
+            options.titles = true;
+        } else if (arg == "--checkpoint-every" && i + 1 < argc) {
+            options.checkpoint_every = (uint32_t)std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--resume") {
+            options.resume = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            std::cerr << "Usage: lab4_indexer [--corpus DIR|FILE.pack] [--shards N] [--reorder none|minhash|bp] "
+                      << "[--dedup none|drop|collapse] [--dedup-distance K] [--impacts] [--trigrams] [--completions] [--titles] "
+                      << "[--checkpoint-every N] [--resume]" << std::endl;
+            return 1;
+        }
+    }
+
     std::cout << "=== Lab 4: Inverted Index Builder ===" << std::endl;
 
-    std::string corpus_path = "../../corpus_txt";
     std::string index_output = "../../index_data"; 
 
     if (!fs::exists(corpus_path)) {
@@ -22,7 +72,7 @@ int main() {
     }
 
     try {
-        Indexer indexer;
+        Indexer indexer(options);
         std::cout << "Starting indexing process..." << std::endl;
         
         indexer.build_index(corpus_path, index_output);
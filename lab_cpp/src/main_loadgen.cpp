@@ -0,0 +1,380 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include "broker.hpp"
+#include "latency_histogram.hpp"
+#include "alloc_counter.hpp"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <cstdio>
+#include <csignal>
+#endif
+
+// Нагрузочный генератор: проигрывает журнал запросов против SearchEngine
+// в этом процессе или против процессов lab4_search (протокол --json по pipe).
+//   closed - N клиентов шлют запросы без пауз, следующий после ответа;
+//   open   - запросы запланированы с частотой --qps, задержка считается от
+//            запланированного времени старта (не страдает от coordinated omission).
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions {
+    std::string queries_file;
+    std::string index_dir = "../../index_data";
+    std::string server_path;
+    std::string mode = "closed";
+    std::vector<unsigned> clients = {1};
+    std::vector<double> qps;
+    double duration_sec = 10;
+    double warmup_sec = 1;
+    std::string output_file;
+};
+
+// Один клиент нагрузки. Возвращает false, если запрос завершился ошибкой.
+class QueryTarget {
+public:
+    virtual ~QueryTarget() = default;
+    virtual bool run(const std::string& query) = 0;
+};
+
+class InProcessTarget : public QueryTarget {
+public:
+    explicit InProcessTarget(ShardBroker& e) : engine(e) {}
+
+    bool run(const std::string& query) override {
+        try {
+            // Буфер результатов общий для всех запросов клиента, как в lab4_search
+            engine.search(query, results);
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+private:
+    ShardBroker& engine;
+    std::vector<SearchResult> results;
+};
+
+#ifndef _WIN32
+// Отдельный процесс lab4_search --json на каждого клиента: сервер обрабатывает
+// строки stdin последовательно, поэтому параллелизм дают только процессы.
+class PipeTarget : public QueryTarget {
+public:
+    explicit PipeTarget(const std::string& server_path) {
+        int to_child[2], from_child[2];
+        if (pipe(to_child) != 0 || pipe(from_child) != 0) throw std::runtime_error("pipe() failed");
+
+        pid = fork();
+        if (pid < 0) throw std::runtime_error("fork() failed");
+        if (pid == 0) {
+            dup2(to_child[0], STDIN_FILENO);
+            dup2(from_child[1], STDOUT_FILENO);
+            int devnull = ::open("/dev/null", O_WRONLY);
+            if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+            close(to_child[1]);
+            close(from_child[0]);
+            execl(server_path.c_str(), server_path.c_str(), "--json", (char*)nullptr);
+            _exit(127);
+        }
+        close(to_child[0]);
+        close(from_child[1]);
+        // Следующие дочерние процессы не должны наследовать концы pipe этого клиента
+        fcntl(to_child[1], F_SETFD, FD_CLOEXEC);
+        fcntl(from_child[0], F_SETFD, FD_CLOEXEC);
+        in = fdopen(to_child[1], "w");
+        out = fdopen(from_child[0], "r");
+
+        // Первый ответ приходит только после загрузки индекса
+        if (!run(":stats")) throw std::runtime_error("Search server did not start: " + server_path);
+    }
+
+    ~PipeTarget() override {
+        if (in) {
+            fputs("exit\n", in);
+            fclose(in);
+        }
+        if (out) fclose(out);
+        if (pid > 0) waitpid(pid, nullptr, 0);
+    }
+
+    bool run(const std::string& query) override {
+        fputs(query.c_str(), in);
+        fputc('\n', in);
+        fflush(in);
+
+        std::string line;
+        int c;
+        while ((c = fgetc(out)) != EOF && c != '\n') line += (char)c;
+        if (c == EOF) return false;
+        return line.rfind("{ \"error\"", 0) != 0;
+    }
+
+private:
+    pid_t pid = -1;
+    FILE* in = nullptr;
+    FILE* out = nullptr;
+};
+#endif
+
+struct RunResult {
+    std::string mode;
+    unsigned clients;
+    double target_qps;
+    double duration_sec;
+    uint64_t errors;
+    LatencyHistogram latency;       // мкс, с поправкой на coordinated omission
+    LatencyHistogram uncorrected;   // мкс, время обслуживания как есть
+    // Выделения памяти в куче потоками клиентов за время запросов; имеет смысл только
+    // для поиска в этом процессе (с --server считаются выделения самого клиента)
+    uint64_t allocations = 0;
+    bool in_process = true;
+};
+
+struct ClientState {
+    LatencyHistogram latency;
+    LatencyHistogram uncorrected;
+    uint64_t errors = 0;
+    uint64_t allocations = 0;
+};
+
+RunResult run_load(const std::vector<std::string>& queries,
+                   const std::vector<std::unique_ptr<QueryTarget>>& targets,
+                   const std::string& mode, unsigned clients, double qps,
+                   double warmup_sec, double duration_sec) {
+    std::vector<ClientState> states(clients);
+    std::atomic<size_t> next_query{0};
+    std::atomic<uint64_t> next_slot{0};
+
+    auto start = Clock::now() + std::chrono::milliseconds(10);
+    auto measure_from = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(warmup_sec));
+    auto deadline = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration_sec));
+
+    auto client = [&](unsigned c) {
+        ClientState& state = states[c];
+        QueryTarget& target = *targets[c];
+        std::this_thread::sleep_until(start);
+
+        while (true) {
+            Clock::time_point intended;
+            if (mode == "open") {
+                uint64_t slot = next_slot.fetch_add(1);
+                intended = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(slot / qps));
+                if (intended >= deadline) break;
+                std::this_thread::sleep_until(intended);
+            } else {
+                intended = Clock::now();
+                if (intended >= deadline) break;
+            }
+
+            const std::string& query = queries[next_query.fetch_add(1) % queries.size()];
+            uint64_t allocations_before = AllocationCounter::thread_total();
+            auto begin = Clock::now();
+            bool ok = target.run(query);
+            auto end = Clock::now();
+            uint64_t allocations = AllocationCounter::thread_total() - allocations_before;
+
+            if (intended < measure_from) continue;
+            if (!ok) state.errors++;
+            state.allocations += allocations;
+            state.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(end - intended).count());
+            state.uncorrected.record(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned c = 0; c < clients; ++c) threads.emplace_back(client, c);
+    for (auto& t : threads) t.join();
+
+    RunResult result{mode, clients, qps, duration_sec, 0, {}, {}};
+    for (const auto& s : states) {
+        result.errors += s.errors;
+        result.allocations += s.allocations;
+        result.latency.merge(s.latency);
+        result.uncorrected.merge(s.uncorrected);
+    }
+
+    // В закрытом цикле клиент сам ждет ответа и не отправляет запросы, которые
+    // отправил бы при стабильной работе сервера. Ожидаемый интервал между
+    // запросами клиента - среднее время обслуживания.
+    if (mode == "closed") {
+        result.latency = result.uncorrected.corrected((uint64_t)result.uncorrected.mean());
+    }
+    return result;
+}
+
+std::string histogram_json(const LatencyHistogram& h) {
+    std::ostringstream os;
+    os << "{ \"p50\": " << h.percentile(50) << ", \"p90\": " << h.percentile(90)
+       << ", \"p99\": " << h.percentile(99) << ", \"p999\": " << h.percentile(99.9)
+       << ", \"max\": " << h.max() << ", \"mean\": " << (uint64_t)h.mean() << " }";
+    return os.str();
+}
+
+std::string run_json(const RunResult& r) {
+    uint64_t requests = r.uncorrected.count();
+    std::ostringstream os;
+    os << "{ \"mode\": \"" << r.mode << "\", \"clients\": " << r.clients;
+    if (r.mode == "open") os << ", \"target_qps\": " << r.target_qps;
+    os << ", \"duration_sec\": " << r.duration_sec << ", \"requests\": " << requests
+       << ", \"errors\": " << r.errors << ", \"achieved_qps\": " << requests / r.duration_sec
+       << ", \"latency_us\": " << histogram_json(r.latency)
+       << ", \"service_time_us\": " << histogram_json(r.uncorrected);
+    if (r.in_process) os << ", \"allocations_per_query\": " << (requests ? (double)r.allocations / requests : 0.0);
+    os << " }";
+    return os.str();
+}
+
+template <class T>
+std::vector<T> parse_list(const std::string& s, std::function<T(const std::string&)> parse) {
+    std::vector<T> values;
+    std::istringstream in(s);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) values.push_back(parse(item));
+    }
+    return values;
+}
+
+void print_usage() {
+    std::cerr << "Usage: loadgen --queries FILE [--mode closed|open] [--clients N[,N...]] [--qps R[,R...]]\n"
+              << "               [--duration SEC] [--warmup SEC] [--index DIR | --server PATH] [--output FILE]" << std::endl;
+}
+
+bool parse_options(int argc, char* argv[], LoadOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--queries" && has_value) opt.queries_file = argv[++i];
+        else if (arg == "--index" && has_value) opt.index_dir = argv[++i];
+        else if (arg == "--server" && has_value) opt.server_path = argv[++i];
+        else if (arg == "--mode" && has_value) opt.mode = argv[++i];
+        else if (arg == "--clients" && has_value) {
+            opt.clients = parse_list<unsigned>(argv[++i], [](const std::string& s) { return (unsigned)std::max(1, std::stoi(s)); });
+        }
+        else if (arg == "--qps" && has_value) {
+            opt.qps = parse_list<double>(argv[++i], [](const std::string& s) { return std::stod(s); });
+        }
+        else if (arg == "--duration" && has_value) opt.duration_sec = std::stod(argv[++i]);
+        else if (arg == "--warmup" && has_value) opt.warmup_sec = std::stod(argv[++i]);
+        else if (arg == "--output" && has_value) opt.output_file = argv[++i];
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (opt.queries_file.empty() || (opt.mode != "closed" && opt.mode != "open") || opt.clients.empty()) return false;
+    if (opt.mode == "open" && opt.qps.empty()) {
+        std::cerr << "Open-loop mode requires --qps" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    system("chcp 65001 > nul");
+#endif
+
+    LoadOptions opt;
+    if (!parse_options(argc, argv, opt)) {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<std::string> queries;
+    std::ifstream log(opt.queries_file);
+    std::string line;
+    while (std::getline(log, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty() && line[0] != ':') queries.push_back(line);
+    }
+    if (queries.empty()) {
+        std::cerr << "Error: no queries in " << opt.queries_file << std::endl;
+        return 1;
+    }
+    std::cerr << "Loaded " << queries.size() << " queries." << std::endl;
+
+    ShardBroker engine;
+    try {
+        if (opt.server_path.empty()) engine.load_index(opt.index_dir);
+#ifdef _WIN32
+        else throw std::runtime_error("--server is not supported on Windows");
+#else
+        else signal(SIGPIPE, SIG_IGN);
+#endif
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Прогоны: для closed - по каждому числу клиентов, для open - по каждой частоте
+    // (число клиентов-исполнителей - максимум из --clients)
+    std::vector<std::pair<unsigned, double>> runs;
+    if (opt.mode == "closed") {
+        for (unsigned c : opt.clients) runs.push_back({c, 0});
+    } else {
+        unsigned c = *std::max_element(opt.clients.begin(), opt.clients.end());
+        for (double q : opt.qps) runs.push_back({c, q});
+    }
+
+    std::vector<std::string> results;
+    try {
+        for (const auto& run : runs) {
+            std::vector<std::unique_ptr<QueryTarget>> targets;
+            for (unsigned c = 0; c < run.first; ++c) {
+#ifndef _WIN32
+                if (!opt.server_path.empty()) {
+                    targets.push_back(std::make_unique<PipeTarget>(opt.server_path));
+                    continue;
+                }
+#endif
+                targets.push_back(std::make_unique<InProcessTarget>(engine));
+            }
+
+            std::cerr << "Run: " << opt.mode << ", clients " << run.first;
+            if (opt.mode == "open") std::cerr << ", target " << run.second << " qps";
+            std::cerr << "..." << std::endl;
+
+            RunResult result = run_load(queries, targets, opt.mode, run.first, run.second,
+                                        opt.warmup_sec, opt.duration_sec);
+            result.in_process = opt.server_path.empty();
+            std::cerr << "  " << result.uncorrected.count() / opt.duration_sec << " qps, p50 "
+                      << result.latency.percentile(50) << " us, p99 " << result.latency.percentile(99)
+                      << " us, p999 " << result.latency.percentile(99.9) << " us";
+            if (result.in_process && result.uncorrected.count()) {
+                std::cerr << ", " << (double)result.allocations / result.uncorrected.count() << " allocs/query";
+            }
+            std::cerr << std::endl;
+            results.push_back(run_json(result));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::ostringstream json;
+    json << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        json << "  " << results[i] << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "]\n";
+
+    std::cout << json.str();
+    if (!opt.output_file.empty()) {
+        std::ofstream out(opt.output_file);
+        out << json.str();
+    }
+    return 0;
+}
@@ -1,6 +1,16 @@
 #include <iostream>
 #include <string>
-#include "search_engine.hpp"
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include "broker.hpp"
+#include "alloc_counter.hpp"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <pthread.h>
+#endif
 
 std::string escape_json(const std::string& s) {
     std::string res;
@@ -23,34 +33,257 @@ int main(int argc, char* argv[]) {
 #endif
 
     bool json_mode = false;
-    if (argc > 1 && std::string(argv[1]) == "--json") {
-        json_mode = true;
+    SearchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json") json_mode = true;
+        else if (arg == "--fuzzy-cap" && i + 1 < argc) options.fuzzy_max_expansions = std::stoul(argv[++i]);
+        else if (arg == "--substring-cap" && i + 1 < argc) options.substring_max_expansions = std::stoul(argv[++i]);
+        else if (arg == "--parallel") options.parallel = true;
+        else if (arg == "--parallel-min-cost" && i + 1 < argc) options.parallel_min_cost = std::stoull(argv[++i]);
+        else if (arg == "--no-collapse") options.collapse_duplicates = false;
+        else if (arg == "--no-early-termination") options.early_termination = false;
+        else if (arg == "--title-boost" && i + 1 < argc) options.title_boost = std::stof(argv[++i]);
+        else if (arg == "--max-time-ms" && i + 1 < argc) options.limits.max_time_ms = std::stoul(argv[++i]);
+        else if (arg == "--max-postings" && i + 1 < argc) options.limits.max_postings = std::stoull(argv[++i]);
+        else if (arg == "--max-memory-mb" && i + 1 < argc) options.limits.max_memory_bytes = std::stoull(argv[++i]) << 20;
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            std::cerr << "Usage: lab4_search [--json] [--fuzzy-cap N] [--substring-cap N] [--parallel] [--parallel-min-cost N] [--no-collapse] [--no-early-termination] [--title-boost X] [--max-time-ms N] [--max-postings N] [--max-memory-mb N]" << std::endl;
+            return 1;
+        }
     }
 
+#ifndef _WIN32
+    // SIGHUP и SIGINT блокируются до запуска любых потоков и принимаются выделенным потоком через sigwait
+    sigset_t hup_set;
+    sigemptyset(&hup_set);
+    sigaddset(&hup_set, SIGHUP);
+    sigaddset(&hup_set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &hup_set, nullptr);
+#endif
+
     std::string index_dir = "../../index_data";
-    SearchEngine engine;
+    ShardBroker engine;
     
     try {
         engine.load_index(index_dir);
+        engine.set_options(options);
     } catch (const std::exception& e) {
         std::cerr << "Error loading index: " << e.what() << std::endl;
         return 1;
     }
 
+    // SIGINT во время запроса отменяет его (ответ будет частичным), в простое - завершает процесс
+    std::atomic<bool> cancel_query{false};
+    std::atomic<bool> query_running{false};
+
+#ifndef _WIN32
+    std::atomic<bool> shutting_down{false};
+    std::thread hup_listener([&] {
+        int sig;
+        while (sigwait(&hup_set, &sig) == 0 && !shutting_down) {
+            if (sig == SIGINT) {
+                if (!query_running) std::_Exit(130);
+                cancel_query = true;
+            }
+            else if (!engine.start_reload()) std::cerr << "SIGHUP ignored: reload already in progress." << std::endl;
+        }
+    });
+#endif
+
     if (!json_mode) {
         std::cout << "Interactive Search Ready. Type 'exit' to quit." << std::endl;
     }
 
     std::string line;
+    std::string last_query;
+    std::vector<SearchResult> last_results;
+    // Буфер ответа переиспользуется между запросами
+    std::vector<SearchResult> results;
+    // Выделения памяти в куче за время поиска (все потоки процесса)
+    uint64_t last_query_allocations = 0;
+    uint64_t query_allocations = 0;
+    uint64_t queries_served = 0;
+
     while (std::getline(std::cin, line)) {
         if (line == "exit") break;
         if (line.empty()) continue;
 
         try {
-            auto results = engine.search(line);
+            // Служебные команды начинаются с ':' и работают с последним запросом
+            if (line.rfind(":snippets", 0) == 0) {
+                std::istringstream args(line.substr(9));
+                size_t offset = 0, limit = 10;
+                args >> offset >> limit;
+                auto terms = SearchEngine::query_terms(last_query);
+                size_t end = std::min(last_results.size(), offset + limit);
+
+                if (json_mode) std::cout << "{ \"snippets\": [";
+                for (size_t i = offset; i < end; ++i) {
+                    const auto& r = last_results[i];
+                    std::string snippet = engine.make_snippet(r.doc_id, terms);
+                    if (json_mode) {
+                        std::cout << "{ \"id\": " << r.doc_id
+                                  << ", \"title\": \"" << escape_json(r.title)
+                                  << "\", \"snippet\": \"" << escape_json(snippet) << "\" }";
+                        if (i + 1 < end) std::cout << ",";
+                    } else {
+                        std::cout << "[" << r.doc_id << "] " << r.title << "\n    " << snippet << std::endl;
+                    }
+                }
+                if (json_mode) std::cout << "] }" << std::endl;
+                continue;
+            }
+            if (line.rfind(":doc", 0) == 0) {
+                uint32_t doc_id = (uint32_t)std::stoul(line.substr(4));
+                std::string text = engine.get_document(doc_id);
+                if (json_mode) {
+                    std::cout << "{ \"id\": " << doc_id << ", \"text\": \"" << escape_json(text) << "\" }" << std::endl;
+                } else {
+                    std::cout << text << std::endl;
+                }
+                continue;
+            }
+
+            // :top K запрос - ранжированный top-k по impact_index.bin; :snippets работает и после него
+            if (line.rfind(":top", 0) == 0) {
+                std::istringstream args(line.substr(4));
+                size_t k = 10;
+                args >> k;
+                std::string query;
+                std::getline(args, query);
+
+                ImpactIndex::TopKStats stats;
+                auto ranked = engine.search_top_k(query, k, &stats);
+                last_query = query;
+                last_results.clear();
+                for (const auto& r : ranked) last_results.push_back({r.doc_id, r.title, ""});
+
+                if (json_mode) {
+                    std::cout << "{ \"count\": " << ranked.size()
+                              << ", \"early_terminated\": " << (stats.early_terminated ? "true" : "false")
+                              << ", \"postings_scored\": " << stats.postings_scored
+                              << ", \"postings_total\": " << stats.postings_total << ", \"results\": [";
+                    for (size_t i = 0; i < ranked.size(); ++i) {
+                        std::cout << "{ \"id\": " << ranked[i].doc_id
+                                  << ", \"title\": \"" << escape_json(last_results[i].title)
+                                  << "\", \"score\": " << ranked[i].score << " }";
+                        if (i + 1 < ranked.size()) std::cout << ",";
+                    }
+                    std::cout << "] }" << std::endl;
+                } else {
+                    std::cout << "Top " << ranked.size() << " (scored " << stats.postings_scored << " of "
+                              << stats.postings_total << " postings"
+                              << (stats.early_terminated ? ", early termination" : "") << ")" << std::endl;
+                    for (size_t i = 0; i < ranked.size(); ++i) {
+                        std::cout << "[" << ranked[i].doc_id << "] " << ranked[i].score << "  "
+                                  << last_results[i].title << std::endl;
+                    }
+                }
+                continue;
+            }
+
+            // :complete префикс - подсказки словоформ для ввода по мере набора
+            if (line.rfind(":complete", 0) == 0) {
+                std::istringstream args(line.substr(9));
+                std::string prefix;
+                args >> prefix;
+                auto suggestions = engine.complete(prefix, CompletionIndex::TOP_K);
+                if (json_mode) {
+                    std::cout << "{ \"suggestions\": [";
+                    for (size_t i = 0; i < suggestions.size(); ++i) {
+                        std::cout << "{ \"word\": \"" << escape_json(suggestions[i].word)
+                                  << "\", \"doc_freq\": " << suggestions[i].doc_freq << " }";
+                        if (i + 1 < suggestions.size()) std::cout << ",";
+                    }
+                    std::cout << "] }" << std::endl;
+                } else {
+                    for (const auto& s : suggestions) std::cout << s.word << " (" << s.doc_freq << ")" << std::endl;
+                }
+                continue;
+            }
+
+            if (line.rfind(":reload", 0) == 0) {
+                std::istringstream args(line.substr(7));
+                std::string dir;
+                args >> dir;
+                bool started = engine.start_reload(dir);
+                if (json_mode) {
+                    std::cout << "{ \"reload\": \"" << (started ? "started" : "in_progress") << "\" }" << std::endl;
+                } else {
+                    std::cout << (started ? "Reload started." : "Reload already in progress.") << std::endl;
+                }
+                continue;
+            }
+            if (line == ":stats") {
+                MemoryUsage mem = engine.memory_usage();
+                std::string reload_error = engine.last_reload_error();
+                if (json_mode) {
+                    std::cout << "{ \"docs\": " << engine.get_total_docs()
+                              << ", \"shards\": " << engine.shard_count()
+                              << ", \"generation\": " << engine.generation()
+                              << ", \"reloading\": " << (engine.is_reloading() ? "true" : "false")
+                              << ", \"reload_error\": \"" << escape_json(reload_error) << "\""
+                              << ", \"memory\": { \"dictionary\": " << mem.dictionary
+                              << ", \"completion\": " << mem.completion
+                              << ", \"title_index\": " << mem.title_index
+                              << ", \"sorted_terms\": " << mem.sorted_terms
+                              << ", \"titles\": " << mem.titles
+                              << ", \"doc_store_tables\": " << mem.doc_store_tables
+                              << ", \"doc_store_cache\": " << mem.doc_store_cache
+                              << ", \"clusters\": " << mem.clusters
+                              << ", \"impact_table\": " << mem.impact_table
+                              << ", \"total\": " << mem.total() << " }"
+                              << ", \"allocations\": { \"last_query\": " << last_query_allocations
+                              << ", \"per_query\": " << (queries_served ? (double)query_allocations / queries_served : 0.0)
+                              << " } }" << std::endl;
+                } else {
+                    std::cout << "Docs: " << engine.get_total_docs() << ", shards: " << engine.shard_count()
+                              << ", generation: " << engine.generation()
+                              << (engine.is_reloading() ? " (reloading)" : "") << std::endl;
+                    if (!reload_error.empty()) std::cout << "Last reload failed: " << reload_error << std::endl;
+                    std::cout << "Memory: " << mem.total() / 1024.0 / 1024.0 << " MB" << std::endl;
+                    std::cout << "  dictionary:       " << mem.dictionary / 1024.0 << " KB" << std::endl;
+                    std::cout << "  completion trie:  " << mem.completion / 1024.0 << " KB (mapped)" << std::endl;
+                    std::cout << "  title index:      " << mem.title_index / 1024.0 << " KB (mapped)" << std::endl;
+                    std::cout << "  sorted terms:     " << mem.sorted_terms / 1024.0 << " KB" << std::endl;
+                    std::cout << "  titles:           " << mem.titles / 1024.0 << " KB" << std::endl;
+                    std::cout << "  doc store tables: " << mem.doc_store_tables / 1024.0 << " KB" << std::endl;
+                    std::cout << "  doc store cache:  " << mem.doc_store_cache / 1024.0 << " KB" << std::endl;
+                    std::cout << "  dup clusters:     " << mem.clusters / 1024.0 << " KB" << std::endl;
+                    std::cout << "  impact table:     " << mem.impact_table / 1024.0 << " KB" << std::endl;
+                    std::cout << "Heap allocations: " << last_query_allocations << " in last query, "
+                              << (queries_served ? (double)query_allocations / queries_served : 0.0)
+                              << " per query on average" << std::endl;
+                }
+                continue;
+            }
+
+            QueryStatus status;
+            cancel_query = false;
+            query_running = true;
+            uint64_t allocations_before = AllocationCounter::total();
+            try {
+                engine.search(line, results, &status, &cancel_query);
+            } catch (...) {
+                query_running = false;
+                throw;
+            }
+            query_running = false;
+            last_query_allocations = AllocationCounter::total() - allocations_before;
+            query_allocations += last_query_allocations;
+            queries_served++;
+            last_query = line;
+            last_results = results;
             
             if (json_mode) {
-                std::cout << "{ \"count\": " << results.size() << ", \"results\": [";
+                std::cout << "{ \"count\": " << results.size();
+                if (status.partial) {
+                    std::cout << ", \"partial\": true, \"reason\": \"" << status.reason
+                              << "\", \"docs_covered\": " << status.docs_covered;
+                }
+                std::cout << ", \"results\": [";
                 for (size_t i = 0; i < results.size(); ++i) {
                     std::cout << "{ \"id\": " << results[i].doc_id 
                               << ", \"title\": \"" << escape_json(results[i].title) << "\" }";
@@ -59,15 +292,28 @@ int main(int argc, char* argv[]) {
                 std::cout << "] }" << std::endl; 
             } else {
                 std::cout << "Found " << results.size() << " docs." << std::endl;
+                if (status.partial) {
+                    std::cout << "Partial result (" << status.reason << "): only docs [0, " << status.docs_covered
+                              << ") of " << engine.get_total_docs() << " were searched." << std::endl;
+                }
                 for (size_t i = 0; i < std::min((size_t)10, results.size()); ++i) {
                      std::cout << "[" << results[i].doc_id << "] " << results[i].title << std::endl;
                 }
             }
+        } catch (const QueryLimitError& e) {
+            if (json_mode) std::cout << "{ \"error\": \"" << escape_json(e.what()) << "\", \"rejected\": true }" << std::endl;
+            else std::cerr << "Error: " << e.what() << std::endl;
         } catch (const std::exception& e) {
             if (json_mode) std::cout << "{ \"error\": \"" << escape_json(e.what()) << "\" }" << std::endl;
             else std::cerr << "Error: " << e.what() << std::endl;
         }
     }
 
+#ifndef _WIN32
+    shutting_down = true;
+    pthread_kill(hup_listener.native_handle(), SIGHUP);
+    hup_listener.join();
+#endif
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "mapped_file.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+void MappedFile::open(const std::string& filename) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open " + filename);
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    length = (size_t)file_size.QuadPart;
+    file_handle = file;
+
+    if (length > 0) {
+        mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle) ptr = (const char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+        if (!ptr) {
+            close();
+            throw std::runtime_error("Cannot map " + filename);
+        }
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open " + filename);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat " + filename);
+    }
+    length = (size_t)st.st_size;
+
+    if (length > 0) {
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            throw std::runtime_error("Cannot map " + filename);
+        }
+        ptr = (const char*)mapped;
+    }
+    // Отображение не зависит от дескриптора
+    ::close(fd);
+#endif
+
+    opened = true;
+}
+
+void MappedFile::advise_sequential() const {
+#ifndef _WIN32
+    if (ptr) posix_madvise((void*)ptr, length, POSIX_MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (ptr) UnmapViewOfFile(ptr);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    if (ptr) munmap((void*)ptr, length);
+#endif
+    ptr = nullptr;
+    length = 0;
+    opened = false;
+}
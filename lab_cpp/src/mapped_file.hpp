@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Файл, отображенный в память только для чтения. Отображение живет, пока жив
+// объект: файл, замененный на диске через rename, продолжает читаться в старой версии.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void open(const std::string& filename);
+    void close();
+
+    // Подсказка ядру: файл читается подряд (агрессивное упреждающее чтение)
+    void advise_sequential() const;
+
+    bool is_open() const { return opened; }
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+    const char* ptr = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
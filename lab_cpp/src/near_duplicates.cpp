@@ -0,0 +1,87 @@
+#include "near_duplicates.hpp"
+#include <algorithm>
+
+namespace {
+    uint64_t mix64(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+}
+
+void SimHashBuilder::add_feature(uint64_t hash) {
+    for (int bit = 0; bit < 64; ++bit) {
+        weights[bit] += ((hash >> bit) & 1) ? 1 : -1;
+    }
+    feature_count++;
+}
+
+void SimHashBuilder::add_token(uint32_t term_id) {
+    if (tokens >= 2) {
+        uint64_t shingle = ((uint64_t)prev[0] * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)prev[1] * 0xC2B2AE3D27D4EB4FULL) ^ term_id;
+        add_feature(mix64(shingle));
+    }
+    prev[0] = prev[1];
+    prev[1] = term_id;
+    tokens++;
+}
+
+uint64_t SimHashBuilder::finish() {
+    // Документ короче шингла описывается своими термами
+    if (feature_count == 0) {
+        for (size_t i = 2 - std::min<size_t>(tokens, 2); i < 2; ++i) add_feature(mix64(prev[i] + 1));
+    }
+
+    uint64_t signature = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+        if (weights[bit] > 0) signature |= 1ULL << bit;
+    }
+    *this = SimHashBuilder();
+    return signature;
+}
+
+NearDuplicateIndex::NearDuplicateIndex(int distance)
+    : max_distance(std::max(0, std::min(distance, 15))),
+      band_bits(64 / (max_distance + 1)),
+      bands(max_distance + 1) {}
+
+int NearDuplicateIndex::hamming_distance(uint64_t a, uint64_t b) {
+    uint64_t x = a ^ b;
+    int bits = 0;
+    while (x) {
+        x &= x - 1;
+        bits++;
+    }
+    return bits;
+}
+
+uint64_t NearDuplicateIndex::band_key(uint64_t signature, int band) const {
+    // Последняя полоса забирает оставшиеся биты
+    int shift = band * band_bits;
+    int width = band + 1 == (int)bands.size() ? 64 - shift : band_bits;
+    return width >= 64 ? signature : (signature >> shift) & ((1ULL << width) - 1);
+}
+
+int64_t NearDuplicateIndex::find(uint64_t signature) const {
+    for (int band = 0; band < (int)bands.size(); ++band) {
+        auto it = bands[band].find(band_key(signature, band));
+        if (it == bands[band].end()) continue;
+
+        const auto& docs = it->second;
+        size_t from = docs.size() > MAX_BUCKET_SCAN ? docs.size() - MAX_BUCKET_SCAN : 0;
+        for (size_t i = from; i < docs.size(); ++i) {
+            if (hamming_distance(signatures.at(docs[i]), signature) <= max_distance) return docs[i];
+        }
+    }
+    return -1;
+}
+
+void NearDuplicateIndex::add(uint64_t signature, uint32_t doc_id) {
+    signatures[doc_id] = signature;
+    for (int band = 0; band < (int)bands.size(); ++band) {
+        bands[band][band_key(signature, band)].push_back(doc_id);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// Поиск почти-дубликатов: SimHash по шинглам из трех подряд идущих термов
+// и LSH-разбиение сигнатуры на max_distance + 1 полос. Если сигнатуры отличаются
+// не более чем в max_distance битах, хотя бы одна полоса совпадает целиком,
+// поэтому сравнивать нужно только документы из общих корзин.
+
+enum class DuplicatePolicy { KEEP, DROP, COLLAPSE };
+
+class SimHashBuilder {
+public:
+    void add_token(uint32_t term_id);
+    // Сигнатура документа; builder сбрасывается для следующего
+    uint64_t finish();
+    bool empty() const { return tokens == 0; }
+
+private:
+    int32_t weights[64] = {};
+    uint32_t prev[2] = {0, 0};
+    size_t tokens = 0;
+    size_t feature_count = 0;
+
+    void add_feature(uint64_t hash);
+};
+
+class NearDuplicateIndex {
+public:
+    explicit NearDuplicateIndex(int max_distance = 3);
+
+    // Ранее добавленный документ на расстоянии <= max_distance или -1
+    int64_t find(uint64_t signature) const;
+    void add(uint64_t signature, uint32_t doc_id);
+
+    static int hamming_distance(uint64_t a, uint64_t b);
+
+private:
+    // Сравнения с одной корзиной ограничены последними документами: вырожденные
+    // корзины (например, шаблонные страницы) не делают поиск квадратичным
+    static const size_t MAX_BUCKET_SCAN = 256;
+
+    int max_distance;
+    int band_bits;
+    std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> bands;
+    std::unordered_map<uint32_t, uint64_t> signatures;
+
+    uint64_t band_key(uint64_t signature, int band) const;
+};
@@ -0,0 +1,104 @@
+#include "packed_corpus.hpp"
+#include "binary_utils.hpp"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const size_t HEADER_BYTES = 4 * 4 + 8;
+
+    void write_field(std::ofstream& out, const std::string& value) {
+        BinaryUtils::write_u32(out, (uint32_t)value.size());
+        BinaryUtils::write_string(out, value);
+    }
+}
+
+void PackedCorpus::write(const std::string& filename, const std::vector<Record>& records) {
+    std::ofstream out(filename, std::ios::binary);
+    BinaryUtils::write_u32(out, SIGNATURE);
+    BinaryUtils::write_u32(out, VERSION);
+    BinaryUtils::write_u32(out, (uint32_t)records.size());
+    BinaryUtils::write_u32(out, 0);
+    BinaryUtils::write_u64(out, 0);
+
+    std::vector<uint64_t> record_offsets;
+    for (const auto& r : records) {
+        record_offsets.push_back((uint64_t)out.tellp());
+        write_field(out, r.title);
+        write_field(out, r.url);
+        write_field(out, r.body);
+    }
+    // Таблица выравнивается на 8 байт и читается из отображения на месте
+    while (out.tellp() % 8 != 0) BinaryUtils::write_u8(out, 0);
+    uint64_t table = (uint64_t)out.tellp();
+    for (uint64_t offset : record_offsets) BinaryUtils::write_u64(out, offset);
+
+    out.seekp(16);
+    BinaryUtils::write_u64(out, table);
+}
+
+bool PackedCorpus::is_packed(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    uint32_t signature = 0;
+    in.read(reinterpret_cast<char*>(&signature), sizeof(signature));
+    return in && signature == SIGNATURE;
+}
+
+void PackedCorpus::open(const std::string& filename) {
+    close();
+    file.open(filename);
+
+    const char* data = file.data();
+    uint32_t header[4] = {0, 0, 0, 0};
+    uint64_t table = 0;
+    if (file.size() >= HEADER_BYTES) {
+        std::memcpy(header, data, sizeof(header));
+        std::memcpy(&table, data + 16, sizeof(table));
+    }
+    if (header[0] != SIGNATURE || header[1] != VERSION) {
+        close();
+        throw std::runtime_error("Invalid packed corpus signature");
+    }
+    count = header[2];
+    if (table % 8 != 0 || table < HEADER_BYTES || table + count * 8ULL > file.size()) {
+        close();
+        throw std::runtime_error("Corrupted packed corpus: bad offset table");
+    }
+    offsets = reinterpret_cast<const uint64_t*>(data + table);
+    file.advise_sequential();
+}
+
+void PackedCorpus::close() {
+    file.close();
+    count = 0;
+    offsets = nullptr;
+}
+
+PackedCorpus::Document PackedCorpus::document(uint32_t index) const {
+    if (index >= count) throw std::out_of_range("Packed corpus record out of range");
+
+    const char* data = file.data();
+    uint64_t pos = offsets[index];
+    auto field = [&]() {
+        uint32_t len = 0;
+        if (pos + 4 <= file.size()) std::memcpy(&len, data + pos, 4);
+        if (pos + 4 + len > file.size()) throw std::runtime_error("Corrupted packed corpus: record out of bounds");
+        std::string_view value(data + pos + 4, len);
+        pos += 4 + len;
+        return value;
+    };
+    Document doc;
+    doc.title = field();
+    doc.url = field();
+    doc.body = field();
+    return doc;
+}
+
+std::string PackedCorpus::text(uint32_t index) const {
+    Document doc = document(index);
+    std::string content;
+    content.reserve(doc.title.size() + 1 + doc.body.size());
+    content.append(doc.title);
+    content += '\n';
+    content.append(doc.body);
+    return content;
+}
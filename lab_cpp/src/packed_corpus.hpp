@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "mapped_file.hpp"
+
+// Упакованный корпус: все документы в одном файле вместо файла на документ
+// (пишет tools/export_corpus.py --packed). Читается через отображение в память
+// по порядку записей, без открытия и stat каждого документа.
+//
+// Формат: заголовок - u32 сигнатура, u32 версия, u32 N документов, u32 0,
+// u64 смещение таблицы; записи - u32 длина + байты для заголовка, URL и тела;
+// таблица - u64 смещение каждой записи. Тело не содержит строки заголовка:
+// текст документа - заголовок, '\n', тело (как в файле corpus_txt/doc_N.txt).
+class PackedCorpus {
+public:
+    static constexpr uint32_t SIGNATURE = 0x4B434150;
+    static constexpr uint32_t VERSION = 1;
+
+    struct Document {
+        std::string_view title;
+        std::string_view url;
+        std::string_view body;
+    };
+
+    struct Record {
+        std::string title;
+        std::string url;
+        std::string body;
+    };
+
+    static void write(const std::string& filename, const std::vector<Record>& records);
+    // Файл начинается с сигнатуры упакованного корпуса
+    static bool is_packed(const std::string& filename);
+
+    void open(const std::string& filename);
+    void close();
+    bool is_open() const { return file.is_open(); }
+
+    uint32_t size() const { return count; }
+    // Представления указывают в отображение и живут до close()
+    Document document(uint32_t index) const;
+    // Полный текст документа: заголовок и тело
+    std::string text(uint32_t index) const;
+
+private:
+    MappedFile file;
+    uint32_t count = 0;
+    const uint64_t* offsets = nullptr;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Оценка размера списка doc_id (по d-gaps) при разных схемах сжатия.
+// Сами кодеки не реализуются: считаются только байты, которые они бы заняли.
+namespace PostingsCodecs {
+
+    inline int bit_width(uint32_t v) {
+        int bits = 0;
+        while (v) {
+            bits++;
+            v >>= 1;
+        }
+        return bits;
+    }
+
+    // gap = doc_id[i] - doc_id[i-1]; первый элемент кодируется как doc_id + 1, чтобы gap >= 1
+    template <class Func>
+    void for_each_gap(const uint32_t* docs, size_t n, Func fn) {
+        uint32_t prev = 0;
+        for (size_t i = 0; i < n; ++i) {
+            fn(i == 0 ? docs[0] + 1 : docs[i] - prev);
+            prev = docs[i];
+        }
+    }
+
+    inline uint64_t vbyte_bytes(const uint32_t* docs, size_t n) {
+        uint64_t bytes = 0;
+        for_each_gap(docs, n, [&](uint32_t g) { bytes += (bit_width(g) + 6) / 7; });
+        return bytes;
+    }
+
+    inline uint64_t gamma_bits(const uint32_t* docs, size_t n) {
+        uint64_t bits = 0;
+        for_each_gap(docs, n, [&](uint32_t g) { bits += 2 * bit_width(g) - 1; });
+        return bits;
+    }
+
+    inline uint64_t delta_bits(const uint32_t* docs, size_t n) {
+        uint64_t bits = 0;
+        for_each_gap(docs, n, [&](uint32_t g) {
+            int len = bit_width(g);
+            bits += (len - 1) + 2 * bit_width((uint32_t)len) - 1;
+        });
+        return bits;
+    }
+
+    // Блоки по 128 gaps, каждый упакован шириной максимального gap + 1 байт заголовка
+    inline uint64_t bitpacking128_bytes(const uint32_t* docs, size_t n) {
+        uint64_t bytes = 0;
+        int block_width = 0;
+        size_t in_block = 0;
+        for_each_gap(docs, n, [&](uint32_t g) {
+            block_width = std::max(block_width, bit_width(g));
+            if (++in_block == 128) {
+                bytes += 1 + (128 * block_width + 7) / 8;
+                block_width = 0;
+                in_block = 0;
+            }
+        });
+        if (in_block > 0) bytes += 1 + (in_block * block_width + 7) / 8;
+        return bytes;
+    }
+
+    // То же, но первый doc_id списка хранится отдельно (VByte), а блоки - только по gaps
+    // между соседними: так абсолютный первый id не задает ширину всего первого блока.
+    // Этим сравниваются нумерации документов при перестановке
+    inline uint64_t bitpacking128_first_apart_bytes(const uint32_t* docs, size_t n) {
+        if (n == 0) return 0;
+        uint64_t bytes = (bit_width(docs[0]) + 6) / 7 + (docs[0] == 0);
+        int block_width = 0;
+        size_t in_block = 0;
+        for (size_t i = 1; i < n; ++i) {
+            block_width = std::max(block_width, bit_width(docs[i] - docs[i - 1]));
+            if (++in_block == 128) {
+                bytes += 1 + (128 * block_width + 7) / 8;
+                block_width = 0;
+                in_block = 0;
+            }
+        }
+        if (in_block > 0) bytes += 1 + (in_block * block_width + 7) / 8;
+        return bytes;
+    }
+
+    inline uint64_t vbyte_bytes(const std::vector<uint32_t>& docs) { return vbyte_bytes(docs.data(), docs.size()); }
+}
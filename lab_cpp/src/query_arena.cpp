@@ -0,0 +1,36 @@
+#include "query_arena.hpp"
+#include <algorithm>
+
+void* QueryArena::Overflow::do_allocate(size_t size, size_t alignment) {
+    bytes += size;
+    return std::pmr::new_delete_resource()->allocate(size, alignment);
+}
+
+void QueryArena::Overflow::do_deallocate(void* p, size_t size, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+}
+
+QueryArena& QueryArena::local() {
+    thread_local QueryArena instance;
+    return instance;
+}
+
+QueryArena::QueryArena()
+    : buffer(new char[INITIAL_BYTES]), buffer_bytes(INITIAL_BYTES) {
+    arena.emplace(buffer.get(), buffer_bytes, &overflow);
+}
+
+void QueryArena::reset() {
+    // Уничтожение ресурса возвращает в кучу все, что было взято сверх буфера
+    arena.reset();
+    if (overflow.bytes > 0) {
+        overflow_count++;
+        size_t peak = buffer_bytes + overflow.bytes;
+        if (buffer_bytes < MAX_BYTES) {
+            buffer_bytes = std::min(MAX_BYTES, std::max(peak, buffer_bytes * 2));
+            buffer.reset(new char[buffer_bytes]);
+        }
+        overflow.bytes = 0;
+    }
+    arena.emplace(buffer.get(), buffer_bytes, &overflow);
+}
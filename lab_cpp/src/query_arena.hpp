@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+// Память одного запроса: монотонный буфер своего потока, который целиком сбрасывается
+// после запроса. Если запросу буфера не хватило, остаток берется из кучи, а при сбросе
+// буфер вырастает до пика, так что в установившемся режиме запросы не обращаются к куче.
+// Не потокобезопасна: параллельные части запроса берут память из кучи
+class QueryArena {
+public:
+    static constexpr size_t INITIAL_BYTES = 256 << 10;
+    static constexpr size_t MAX_BYTES = 64 << 20;
+
+    static QueryArena& local();
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &*arena; }
+    size_t capacity() const { return buffer_bytes; }
+    // Сколько раз запросы выходили за буфер
+    size_t overflows() const { return overflow_count; }
+
+    // Запрос целиком: сброс при выходе из внешней области, вложенные ничего не сбрасывают
+    class Scope {
+    public:
+        Scope() : owner(local()) { owner.depth++; }
+        ~Scope() { if (--owner.depth == 0) owner.reset(); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        std::pmr::memory_resource* resource() const { return owner.resource(); }
+
+    private:
+        QueryArena& owner;
+    };
+
+private:
+    // Память сверх буфера: берется из кучи, объем запоминается для роста буфера
+    class Overflow : public std::pmr::memory_resource {
+    public:
+        size_t bytes = 0;
+
+    private:
+        void* do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void* p, size_t size, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    QueryArena();
+    void reset();
+
+    std::unique_ptr<char[]> buffer;
+    size_t buffer_bytes = 0;
+    size_t overflow_count = 0;
+    int depth = 0;
+    Overflow overflow;
+    std::optional<std::pmr::monotonic_buffer_resource> arena;
+};
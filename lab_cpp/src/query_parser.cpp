@@ -1,16 +1,17 @@
 #include "query_parser.hpp"
-#include <sstream>
 #include <cctype>
 
+static constexpr std::string_view TITLE_PREFIX = "title:";
+
 bool is_operator_char(char c) {
     return c == '&' || c == '|' || c == '!' || c == '(' || c == ')';
 }
 
-std::vector<Token> QueryParser::parse_to_rpn(const std::string& query) {
-    std::vector<Token> output_queue;
-    std::stack<Token> operator_stack;
+std::pmr::vector<Token> QueryParser::parse_to_rpn(std::string_view query, std::pmr::memory_resource* memory) {
+    std::pmr::vector<Token> output_queue(memory);
+    std::pmr::vector<Token> operator_stack(memory);
 
-    std::vector<Token> tokens;
+    std::pmr::vector<Token> tokens(memory);
     for (size_t i = 0; i < query.length(); ++i) {
         char c = query[i];
         if (std::isspace(c)) continue;
@@ -26,18 +27,38 @@ std::vector<Token> QueryParser::parse_to_rpn(const std::string& query) {
             if (i + 1 < query.length() && query[i+1] == '|') i++;
             tokens.push_back({OR, "||", 1});
         }
-        else {
-            std::string term;
-            while (i < query.length() && !is_operator_char(query[i]) && !std::isspace(query[i])) {
-                term += query[i];
+        else if (c == '~') {
+            // ~терм - нечеткий поиск с 1 правкой, ~~терм - с 2 правками
+            int edits = 0;
+            while (i < query.length() && query[i] == '~' && edits < 2) {
+                edits++;
                 i++;
             }
+            size_t begin = i;
+            while (i < query.length() && !is_operator_char(query[i]) && !std::isspace(query[i])) i++;
+            std::string_view term = query.substr(begin, i - begin);
+            i--;
+            if (!term.empty()) tokens.push_back({FUZZY, term, 0, edits});
+        }
+        else {
+            size_t begin = i;
+            while (i < query.length() && !is_operator_char(query[i]) && !std::isspace(query[i])) i++;
+            std::string_view term = query.substr(begin, i - begin);
             i--;
-            tokens.push_back({TERM, term, 0});
+            // *подстрока* - термы, словоформы которых содержат подстроку
+            if (term.size() > 2 && term.front() == '*' && term.back() == '*') {
+                tokens.push_back({SUBSTRING, term.substr(1, term.size() - 2), 0});
+            } else if (term.size() > TITLE_PREFIX.size() && term.substr(0, TITLE_PREFIX.size()) == TITLE_PREFIX) {
+                // title:терм - только документы с термом в заголовке
+                tokens.push_back({TITLE, term.substr(TITLE_PREFIX.size()), 0});
+            } else {
+                tokens.push_back({TERM, term, 0});
+            }
         }
     }
 
-    std::vector<Token> processed_tokens;
+    std::pmr::vector<Token> processed_tokens(memory);
+    processed_tokens.reserve(tokens.size() * 2);
     if (!tokens.empty()) {
         processed_tokens.push_back(tokens[0]);
         for (size_t i = 1; i < tokens.size(); ++i) {
@@ -45,10 +66,10 @@ std::vector<Token> QueryParser::parse_to_rpn(const std::string& query) {
             TokenType curr = tokens[i].type;
             
             bool need_and = false;
-            if (prev == TERM && curr == TERM) need_and = true;
-            if (prev == TERM && curr == LPAREN) need_and = true;
-            if (prev == RPAREN && curr == TERM) need_and = true;
-            if (prev == TERM && curr == NOT) need_and = true;
+            if (is_operand(prev) && is_operand(curr)) need_and = true;
+            if (is_operand(prev) && curr == LPAREN) need_and = true;
+            if (prev == RPAREN && is_operand(curr)) need_and = true;
+            if (is_operand(prev) && curr == NOT) need_and = true;
 
             if (need_and) {
                 processed_tokens.push_back({AND, "&&", 2});
@@ -60,30 +81,30 @@ std::vector<Token> QueryParser::parse_to_rpn(const std::string& query) {
     }
 
     for (const auto& token : processed_tokens) {
-        if (token.type == TERM) {
+        if (is_operand(token.type)) {
             output_queue.push_back(token);
         } else if (token.type == LPAREN) {
-            operator_stack.push(token);
+            operator_stack.push_back(token);
         } else if (token.type == RPAREN) {
-            while (!operator_stack.empty() && operator_stack.top().type != LPAREN) {
-                output_queue.push_back(operator_stack.top());
-                operator_stack.pop();
+            while (!operator_stack.empty() && operator_stack.back().type != LPAREN) {
+                output_queue.push_back(operator_stack.back());
+                operator_stack.pop_back();
             }
-            if (!operator_stack.empty()) operator_stack.pop(); 
+            if (!operator_stack.empty()) operator_stack.pop_back();
         } else {
             while (!operator_stack.empty() && 
-                   operator_stack.top().type != LPAREN &&
-                   operator_stack.top().precedence >= token.precedence) {
-                output_queue.push_back(operator_stack.top());
-                operator_stack.pop();
+                   operator_stack.back().type != LPAREN &&
+                   operator_stack.back().precedence >= token.precedence) {
+                output_queue.push_back(operator_stack.back());
+                operator_stack.pop_back();
             }
-            operator_stack.push(token);
+            operator_stack.push_back(token);
         }
     }
 
     while (!operator_stack.empty()) {
-        output_queue.push_back(operator_stack.top());
-        operator_stack.pop();
+        output_queue.push_back(operator_stack.back());
+        operator_stack.pop_back();
     }
 
     return output_queue;
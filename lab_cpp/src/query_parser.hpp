@@ -1,18 +1,25 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
-#include <stack>
-#include <iostream>
+#include <memory_resource>
 
-enum TokenType { TERM, AND, OR, NOT, LPAREN, RPAREN };
+enum TokenType { TERM, FUZZY, SUBSTRING, TITLE, AND, OR, NOT, LPAREN, RPAREN };
 
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value; // ссылается на строку запроса
     int precedence;
+    int max_edits = 0;
 };
 
+inline bool is_operand(TokenType type) {
+    return type == TERM || type == FUZZY || type == SUBSTRING || type == TITLE;
+}
+
 class QueryParser {
 public:
-    static std::vector<Token> parse_to_rpn(const std::string& query);
+    // Токены ссылаются на query, поэтому строка запроса должна жить дольше результата
+    static std::pmr::vector<Token> parse_to_rpn(std::string_view query,
+                                                std::pmr::memory_resource* memory = std::pmr::get_default_resource());
 };
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+
+namespace RadixSort {
+
+    // Параллельная LSD-сортировка по целочисленному ключу, разряды по 11 бит.
+    // Сортировка устойчивая: элементы с равными ключами сохраняют исходный порядок.
+    template <class T, class KeyFn>
+    void sort_by_key(std::vector<T>& items, uint64_t max_key, KeyFn key, unsigned threads = 0) {
+        const int DIGIT_BITS = 11;
+        const size_t BUCKETS = (size_t)1 << DIGIT_BITS;
+
+        if (items.size() < 2) return;
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = (unsigned)std::min<size_t>(threads, std::max<size_t>(1, items.size() / 65536));
+
+        int key_bits = 0;
+        while (key_bits < 64 && (max_key >> key_bits) != 0) key_bits++;
+        int passes = (key_bits + DIGIT_BITS - 1) / DIGIT_BITS;
+
+        std::vector<T> buffer(items.size());
+        std::vector<std::vector<size_t>> counts(threads, std::vector<size_t>(BUCKETS));
+        size_t chunk = (items.size() + threads - 1) / threads;
+
+        auto run_parallel = [threads](auto&& fn) {
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < threads; ++t) pool.emplace_back(fn, t);
+            fn(0u);
+            for (auto& th : pool) th.join();
+        };
+
+        for (int pass = 0; pass < passes; ++pass) {
+            int shift = pass * DIGIT_BITS;
+
+            // 1. Гистограммы разряда по кускам массива
+            run_parallel([&](unsigned t) {
+                auto& hist = counts[t];
+                std::fill(hist.begin(), hist.end(), 0);
+                size_t end = std::min(items.size(), (t + 1) * chunk);
+                for (size_t i = t * chunk; i < end; ++i) {
+                    hist[(key(items[i]) >> shift) & (BUCKETS - 1)]++;
+                }
+            });
+
+            // 2. Смещения: сначала по разряду, внутри разряда - по номеру куска
+            size_t offset = 0;
+            for (size_t d = 0; d < BUCKETS; ++d) {
+                for (unsigned t = 0; t < threads; ++t) {
+                    size_t c = counts[t][d];
+                    counts[t][d] = offset;
+                    offset += c;
+                }
+            }
+
+            // 3. Раскладка
+            run_parallel([&](unsigned t) {
+                auto& pos = counts[t];
+                size_t end = std::min(items.size(), (t + 1) * chunk);
+                for (size_t i = t * chunk; i < end; ++i) {
+                    buffer[pos[(key(items[i]) >> shift) & (BUCKETS - 1)]++] = items[i];
+                }
+            });
+
+            items.swap(buffer);
+        }
+    }
+}
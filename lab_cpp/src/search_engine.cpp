@@ -2,15 +2,26 @@
 #include "binary_utils.hpp"
 #include "stemmer.hpp"
 #include "tokenizer.hpp"
+#include "fuzzy_matcher.hpp"
+#include "thread_pool.hpp"
+#include "set_ops.hpp"
+#include "query_arena.hpp"
+#include "index_generation.hpp"
 #include <algorithm>
-#include <stack>
-#include <numeric>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <set>
+#include <unordered_set>
+#include <chrono>
+#include <optional>
 
 void SearchEngine::load_index(const std::string& dir) {
     index_dir = dir;
     std::cerr << "Loading index from " << dir << "..." << std::endl;
+    // Штамп читается до файлов и сверяется после: индексатор мог подменить их посреди загрузки
+    std::optional<GenerationStamp> stamp = IndexGeneration::read(dir);
+    build_id = stamp ? stamp->build_id : 0;
 
     std::ifstream docs_in(dir + "/docs_index.bin", std::ios::binary);
     if (!docs_in.is_open()) throw std::runtime_error("Cannot open docs_index.bin");
@@ -45,9 +56,16 @@ void SearchEngine::load_index(const std::string& dir) {
     inv_in.read((char*)&ver, 1);
 
     uint32_t term_count = BinaryUtils::read_u32(inv_in);
+
+    // Постинги читаются из отображения: файл открывается один раз на загрузку, а не на каждый терм
+    postings_file.open(dir + "/inverted_index.bin");
     std::cerr << "Loading " << term_count << " terms..." << std::endl;
 
     dictionary = DictionaryMap(static_cast<size_t>(term_count * 1.5));
+    sorted_terms.clear();
+    sorted_terms.reserve(term_count);
+    std::vector<TermInfo> term_infos;
+    term_infos.reserve(term_count);
 
     for (uint32_t i = 0; i < term_count; ++i) {
         uint8_t term_len;
@@ -58,89 +76,743 @@ void SearchEngine::load_index(const std::string& dir) {
         
         uint32_t doc_freq = BinaryUtils::read_u32(inv_in);
         uint32_t offset = BinaryUtils::read_u32(inv_in);
+        if (!inv_in || (uint64_t)offset + (uint64_t)doc_freq * sizeof(uint32_t) > postings_file.size()) {
+            throw std::runtime_error("Corrupted inverted index: postings of '" + term + "' out of bounds");
+        }
+        // Постинги читаются через const uint32_t* прямо из отображения
+        if (offset % 4 != 0) {
+            throw std::runtime_error("Inverted index postings are not 4-byte aligned (built by an older indexer), rebuild the index");
+        }
         
-        dictionary.insert(term, {doc_freq, offset});
+        dictionary.insert(term, {doc_freq, offset, i});
+        sorted_terms.push_back(term);
+        term_infos.push_back({doc_freq, offset, i});
+    }
+
+    load_clusters(dir + "/doc_clusters.bin");
+    load_impacts(dir + "/impact_index.bin", term_infos);
+
+    trigram_index.close();
+    if (std::ifstream(dir + "/trigram_index.bin").is_open()) {
+        trigram_index.open(dir + "/trigram_index.bin");
+        std::cerr << "Trigram index loaded: " << trigram_index.word_count() << " word forms." << std::endl;
+    }
+    completion_index.close();
+    if (std::ifstream(dir + "/completion.bin").is_open()) {
+        completion_index.open(dir + "/completion.bin");
+        std::cerr << "Completion index loaded: " << completion_index.node_count() << " nodes." << std::endl;
+    }
+    title_index.close();
+    if (std::ifstream(dir + "/title_index.bin").is_open()) {
+        title_index.open(dir + "/title_index.bin");
+        std::cerr << "Title index loaded: " << title_index.term_count() << " terms, "
+                  << title_index.posting_count() << " postings." << std::endl;
+    }
+
+    try {
+        doc_store.open(dir + "/docs_store.bin");
+        std::cerr << "Doc store opened: " << doc_store.size() << " documents." << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Doc store unavailable (" << e.what() << "), snippets disabled." << std::endl;
+    }
+
+    if (stamp) {
+        IndexGeneration::verify(dir, *stamp);
+        if (IndexGeneration::read(dir) != stamp) {
+            throw std::runtime_error("Mixed index generation in " + dir + ": generation.bin changed during load (index is being rebuilt?)");
+        }
+    }
+}
+
+void SearchEngine::load_clusters(const std::string& filename) {
+    doc_cluster.clear();
+    in_cluster.clear();
+
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open()) return;
+
+    if (BinaryUtils::read_u32(in) != 0x53554C43) throw std::runtime_error("Invalid doc clusters signature");
+    uint32_t count = BinaryUtils::read_u32(in);
+    if (count != doc_titles.size()) throw std::runtime_error("doc_clusters.bin does not match docs_index.bin");
+
+    doc_cluster.resize(count);
+    in.read((char*)doc_cluster.data(), (std::streamsize)count * sizeof(uint32_t));
+    if (!in) throw std::runtime_error("Corrupted doc_clusters.bin");
+
+    // Одиночные документы отмечаются заранее, чтобы при схлопывании не трогать для них хеш-таблицу
+    std::vector<uint32_t> cluster_size(count, 0);
+    for (uint32_t cluster : doc_cluster) {
+        if (cluster >= count) throw std::runtime_error("Corrupted doc_clusters.bin");
+        cluster_size[cluster]++;
+    }
+    in_cluster.resize(count);
+    size_t clustered = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        in_cluster[i] = cluster_size[doc_cluster[i]] > 1;
+        clustered += in_cluster[i];
+    }
+    std::cerr << "Loaded near-duplicate clusters: " << clustered << " documents in clusters." << std::endl;
+}
+
+void SearchEngine::load_impacts(const std::string& filename, const std::vector<TermInfo>& terms) {
+    impact_file.close();
+    impact_terms.clear();
+
+    std::ifstream probe(filename, std::ios::binary);
+    if (!probe.is_open()) return;
+    probe.close();
+
+    impact_file.open(filename);
+    const char* data = impact_file.data();
+    auto read_u32 = [data](size_t pos) {
+        uint32_t v;
+        std::memcpy(&v, data + pos, 4);
+        return v;
+    };
+
+    if (impact_file.size() < ImpactIndex::HEADER_BYTES || read_u32(0) != ImpactIndex::SIGNATURE ||
+        (uint8_t)data[4] != ImpactIndex::VERSION) {
+        throw std::runtime_error("Invalid impact index signature");
+    }
+    if (read_u32(5) != terms.size()) throw std::runtime_error("impact_index.bin does not match inverted_index.bin");
+    std::memcpy(&impact_unit, data + 9, 4);
+    if (impact_file.size() < ImpactIndex::HEADER_BYTES + terms.size() * ImpactIndex::TERM_RECORD_BYTES) {
+        throw std::runtime_error("Corrupted impact_index.bin");
+    }
+
+    // Головы и основные постинги читаются из отображений как u32, поэтому проверяется и выравнивание
+    impact_terms.resize(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) {
+        size_t pos = ImpactIndex::HEADER_BYTES + i * ImpactIndex::TERM_RECORD_BYTES;
+        auto& t = impact_terms[i];
+        t.head_count = read_u32(pos);
+        t.head_offset = read_u32(pos + 4);
+        t.impacts_offset = read_u32(pos + 8);
+        t.tail_max = (uint8_t)data[pos + 12];
+
+        if (t.head_count > terms[i].doc_freq || t.head_offset % 4 != 0 || terms[i].offset % 4 != 0 ||
+            (uint64_t)t.head_offset + t.head_count * 5ULL > impact_file.size() ||
+            (uint64_t)t.impacts_offset + terms[i].doc_freq > impact_file.size()) {
+            throw std::runtime_error("Corrupted or unaligned impact index for '" + sorted_terms[i] + "', rebuild with --impacts");
+        }
+    }
+    std::cerr << "Impact index loaded." << std::endl;
+}
+
+void SearchEngine::collapse_duplicates(DocList& doc_ids) const {
+    if (in_cluster.empty() || !options.collapse_duplicates) return;
+
+    std::pmr::unordered_set<uint32_t> seen(doc_ids.get_allocator().resource());
+    auto out = doc_ids.begin();
+    for (uint32_t id : doc_ids) {
+        if (id < in_cluster.size() && in_cluster[id] && !seen.insert(doc_cluster[id]).second) continue;
+        *out++ = id;
     }
+    doc_ids.erase(out, doc_ids.end());
 }
 
-std::vector<uint32_t> SearchEngine::get_postings(const std::string& term) {
-    TermInfo* info = dictionary.find(term);
-    
-    if (info == nullptr) return {};
+SearchEngine::DocSpan SearchEngine::postings_of(const TermInfo& info) const {
+    return {reinterpret_cast<const uint32_t*>(postings_file.data() + info.offset), info.doc_freq};
+}
+
+std::string SearchEngine::normalize_term(std::string_view raw) {
+    std::string term = Tokenizer::to_lower_utf8(std::string(raw));
+    term.resize(Stemmer::stem_length(term));
+    return term;
+}
+
+void SearchEngine::normalize_term(std::string_view raw, std::pmr::string& out) {
+    Tokenizer::to_lower_utf8(raw, out);
+    out.resize(Stemmer::stem_length(out));
+}
+
+std::vector<std::string> SearchEngine::expand_fuzzy(const std::string& term, int max_edits) {
+    FuzzyMatcher matcher(term, max_edits);
+    auto matches = matcher.find(sorted_terms);
+
+    struct Candidate {
+        uint32_t index;
+        uint8_t distance;
+        uint32_t doc_freq;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(matches.size());
+    for (const auto& m : matches) {
+        TermInfo* info = dictionary.find(sorted_terms[m.term_index]);
+        candidates.push_back({m.term_index, m.distance, info ? info->doc_freq : 0});
+    }
+
+    size_t keep = std::min(candidates.size(), options.fuzzy_max_expansions);
+    std::partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(),
+        [](const Candidate& a, const Candidate& b) {
+            if (a.distance != b.distance) return a.distance < b.distance;
+            return a.doc_freq > b.doc_freq;
+        });
 
-    std::ifstream inv_in(index_dir + "/inverted_index.bin", std::ios::binary);
-    if (!inv_in.is_open()) return {};
+    std::vector<std::string> terms;
+    for (size_t i = 0; i < keep; ++i) terms.push_back(sorted_terms[candidates[i].index]);
+    return terms;
+}
 
-    inv_in.seekg(info->offset);
+std::vector<std::string> SearchEngine::expand_substring(const std::string& sub) {
+    std::string lower = Tokenizer::to_lower_utf8(sub);
+    std::vector<uint32_t> ordinals;
+    if (trigram_index.is_open()) {
+        ordinals = trigram_index.find_terms(lower);
+    } else {
+        for (uint32_t i = 0; i < sorted_terms.size(); ++i) {
+            if (sorted_terms[i].find(lower) != std::string::npos) ordinals.push_back(i);
+        }
+    }
 
-    std::vector<uint32_t> result(info->doc_freq);
-    inv_in.read((char*)result.data(), result.size() * sizeof(uint32_t));
-    
-    return result;
+    std::vector<std::pair<uint32_t, uint32_t>> candidates;
+    for (uint32_t ordinal : ordinals) {
+        if (ordinal >= sorted_terms.size()) continue;
+        TermInfo* info = dictionary.find(sorted_terms[ordinal]);
+        candidates.push_back({info ? info->doc_freq : 0, ordinal});
+    }
+    size_t keep = std::min(candidates.size(), options.substring_max_expansions);
+    std::partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::vector<std::string> terms;
+    for (size_t i = 0; i < keep; ++i) terms.push_back(sorted_terms[candidates[i].second]);
+    return terms;
 }
 
+std::vector<CompletionIndex::Suggestion> SearchEngine::complete(const std::string& prefix, size_t k) const {
+    if (!has_completions()) throw std::runtime_error("Index has no completion.bin, rebuild it with --completions");
+    return completion_index.complete(Tokenizer::to_lower_utf8(prefix), k);
+}
 
 std::vector<uint32_t> SearchEngine::intersect_postings(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
-    std::vector<uint32_t> res;
-    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
+    std::vector<uint32_t> res(std::min(a.size(), b.size()) + SetOps::OUTPUT_SLACK);
+    res.resize(SetOps::intersect(a.data(), a.size(), b.data(), b.size(), res.data()));
     return res;
 }
 
 std::vector<uint32_t> SearchEngine::union_postings(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
-    std::vector<uint32_t> res;
-    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
+    std::vector<uint32_t> res(a.size() + b.size() + SetOps::OUTPUT_SLACK);
+    res.resize(SetOps::unite(a.data(), a.size(), b.data(), b.size(), res.data()));
     return res;
 }
 
 std::vector<uint32_t> SearchEngine::difference_postings(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
-    std::vector<uint32_t> res;
-    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
+    std::vector<uint32_t> res(a.size() + SetOps::OUTPUT_SLACK);
+    res.resize(SetOps::difference(a.data(), a.size(), b.data(), b.size(), res.data()));
     return res;
 }
 
-std::vector<uint32_t> SearchEngine::get_all_doc_ids() {
-    std::vector<uint32_t> all(doc_titles.size());
-    std::iota(all.begin(), all.end(), 0); 
-    return all;
+class QueryBudget {
+public:
+    QueryBudget(const QueryLimits& query_limits, const std::atomic<bool>* cancel_flag)
+        : limits(query_limits), cancel(cancel_flag), start(std::chrono::steady_clock::now()) {}
+
+    bool active() const {
+        return limits.max_time_ms || limits.max_postings || limits.max_memory_bytes || cancel;
+    }
+
+    // Учитывает обработанные элементы и объем выделенных списков; false - бюджет исчерпан
+    bool charge(uint64_t postings, uint64_t allocated_bytes) {
+        uint64_t total = touched.fetch_add(postings) + postings;
+        if (cancel && cancel->load(std::memory_order_relaxed)) fail(CANCELLED);
+        else if (limits.max_postings && total > limits.max_postings) fail(POSTINGS);
+        else if (limits.max_memory_bytes && allocated_bytes > limits.max_memory_bytes) fail(MEMORY);
+        else if (limits.max_time_ms) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed > std::chrono::milliseconds(limits.max_time_ms)) fail(TIME);
+        }
+        return !exceeded();
+    }
+
+    bool exceeded() const { return failure.load() != NONE; }
+    uint64_t postings() const { return touched.load(); }
+
+    const char* reason() const {
+        switch (failure.load()) {
+            case TIME: return "time";
+            case POSTINGS: return "postings";
+            case MEMORY: return "memory";
+            case CANCELLED: return "cancelled";
+            default: return "";
+        }
+    }
+
+private:
+    enum Failure { NONE, TIME, POSTINGS, MEMORY, CANCELLED };
+
+    QueryLimits limits;
+    const std::atomic<bool>* cancel;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<uint64_t> touched{0};
+    std::atomic<int> failure{NONE};
+
+    void fail(int reason) {
+        int expected = NONE;
+        failure.compare_exchange_strong(expected, reason);
+    }
+};
+
+void SearchEngine::execute_rpn(const std::pmr::vector<Token>& rpn, QueryStatus& status,
+                               const std::atomic<bool>* cancel, DocList& result) {
+    uint32_t total_docs = get_total_docs();
+    const QueryLimits& limits = options.limits;
+    std::pmr::memory_resource* memory = result.get_allocator().resource();
+    result.clear();
+
+    // 1. Оценка стоимости по doc_freq до чтения постингов: операнды раскрываются в термы,
+    // затем RPN проходится по верхним границам размеров списков. Стоимость - прочитанные
+    // элементы плюс входы всех операций, т.е. верхняя граница того, что посчитает бюджет.
+    // Для выбора параллельного режима - прежняя оценка: операнды и NOT по всем документам.
+    // Постинги термов операнда k - operand_terms[operand_ends[k - 1], operand_ends[k]),
+    // ненайденные термы отброшены; title:терм берет постинги из title_index.bin
+    std::pmr::vector<DocSpan> operand_terms(memory);
+    std::pmr::vector<size_t> operand_ends(memory);
+    std::pmr::vector<uint64_t> bounds(memory);
+    std::pmr::string term(memory);
+    uint64_t cost = 0;
+    uint64_t scan = 0;
+    for (const auto& token : rpn) {
+        if (is_operand(token.type)) {
+            if (token.type == TERM) {
+                normalize_term(token.value, term);
+                if (TermInfo* info = dictionary.find(term)) operand_terms.push_back(postings_of(*info));
+            } else if (token.type == TITLE) {
+                if (!has_titles()) throw std::runtime_error("Index has no title_index.bin, rebuild it with --titles");
+                normalize_term(token.value, term);
+                TitleIndex::Postings title = title_index.find(term);
+                if (title.count > 0) operand_terms.push_back({title.docs, title.count});
+            } else {
+                std::vector<std::string> expanded;
+                if (token.type == FUZZY) {
+                    normalize_term(token.value, term);
+                    expanded = expand_fuzzy(std::string(term), token.max_edits);
+                } else {
+                    expanded = expand_substring(std::string(token.value));
+                }
+                for (const auto& t : expanded) {
+                    if (TermInfo* info = dictionary.find(t)) operand_terms.push_back(postings_of(*info));
+                }
+            }
+
+            uint64_t df = 0;
+            size_t begin = operand_ends.empty() ? 0 : operand_ends.back();
+            for (size_t i = begin; i < operand_terms.size(); ++i) df += operand_terms[i].size;
+            operand_ends.push_back(operand_terms.size());
+            bounds.push_back(std::min<uint64_t>(df, total_docs));
+            cost += df;
+            scan += df;
+        }
+        else if (token.type == NOT) {
+            if (bounds.empty()) continue;
+            cost += total_docs + bounds.back();
+            scan += total_docs;
+            bounds.back() = total_docs;
+        }
+        else if (bounds.size() >= 2) {
+            uint64_t b = bounds.back(); bounds.pop_back();
+            uint64_t a = bounds.back();
+            cost += a + b;
+            bounds.back() = token.type == AND ? std::min(a, b) : std::min<uint64_t>(a + b, total_docs);
+        }
+    }
+    status.estimated_cost = cost;
+    if (limits.max_postings && cost > limits.max_postings) {
+        throw QueryLimitError("Query rejected: estimated cost " + std::to_string(cost) +
+                              " postings exceeds limit " + std::to_string(limits.max_postings));
+    }
+
+    // 2. Постинги операндов: операнд из одного терма ссылается прямо в отображение,
+    // объединение нескольких термов (~терм, *подстрока*) собирается в памяти запроса.
+    // В лимит памяти идут только такие объединения: отображение запрос не выделяет
+    QueryBudget budget(limits, cancel);
+    std::pmr::vector<DocSpan> operands(memory);
+    std::pmr::vector<DocList> merged(memory);
+    merged.reserve(operand_ends.size());
+    uint64_t merged_bytes = 0;
+    size_t begin = 0;
+    for (size_t end : operand_ends) {
+        if (end - begin == 0) {
+            operands.push_back({nullptr, 0});
+        } else if (end - begin == 1) {
+            operands.push_back(operand_terms[begin]);
+        } else {
+            DocList& list = merged.emplace_back();
+            DocList next(memory);
+            for (size_t i = begin; i < end; ++i) {
+                const DocSpan& postings = operand_terms[i];
+                next.resize(list.size() + postings.size + SetOps::OUTPUT_SLACK);
+                next.resize(SetOps::unite(list.data(), list.size(), postings.data, postings.size, next.data()));
+                list.swap(next);
+            }
+            operands.push_back({list.data(), list.size()});
+            merged_bytes += list.size() * sizeof(uint32_t);
+        }
+        begin = end;
+        if (!budget.charge(operands.back().size, merged_bytes)) {
+            status.partial = true;
+            status.reason = budget.reason();
+            status.postings_touched = budget.postings();
+            return;
+        }
+    }
+
+    // 3. Пространство doc_id режется на диапазоны. Параллельно - если запрос достаточно
+    // дорогой; последовательно по частям - если есть лимиты, чтобы при их превышении
+    // вернуть частичный ответ: результаты всех диапазонов до первого невыполненного
+    bool parallel = options.parallel && scan >= options.parallel_min_cost && total_docs > 0;
+    size_t ranges = 1;
+    if (parallel) {
+        ranges = std::min<size_t>((size_t)ThreadPool::shared().size() * options.parallel_ranges_per_thread, total_docs);
+    } else if (budget.active() && total_docs > 0) {
+        ranges = (size_t)std::min<uint64_t>({64, total_docs, 1 + scan / 262144});
+    }
+
+    // Арена принадлежит вызывающему потоку, поэтому потоки пула берут память из кучи
+    std::pmr::memory_resource* range_memory = parallel ? std::pmr::new_delete_resource() : memory;
+    std::pmr::vector<DocList> parts(ranges, range_memory);
+    std::pmr::vector<char> done(ranges, 0, memory);
+    auto run_range = [&](size_t r) {
+        if (budget.exceeded()) return;
+        uint32_t lo = (uint32_t)((uint64_t)total_docs * r / ranges);
+        uint32_t hi = (uint32_t)((uint64_t)total_docs * (r + 1) / ranges);
+        evaluate_range(rpn, operands, merged_bytes, lo, hi, budget, parts[r]);
+        done[r] = !budget.exceeded();
+    };
+    if (parallel) ThreadPool::shared().parallel_for(ranges, run_range);
+    else for (size_t r = 0; r < ranges && !budget.exceeded(); ++r) run_range(r);
+
+    // Диапазоны упорядочены по doc_id, поэтому склеиваются как есть
+    size_t complete = 0;
+    while (complete < ranges && done[complete]) complete++;
+    if (complete < ranges) {
+        status.partial = true;
+        status.reason = budget.reason();
+        status.docs_covered = (uint32_t)((uint64_t)total_docs * complete / ranges);
+    } else {
+        status.docs_covered = total_docs;
+    }
+    status.postings_touched = budget.postings();
+
+    if (complete == 1) {
+        result = std::move(parts[0]);
+        return;
+    }
+    size_t total = 0;
+    for (size_t r = 0; r < complete; ++r) total += parts[r].size();
+    result.reserve(total);
+    for (size_t r = 0; r < complete; ++r) result.insert(result.end(), parts[r].begin(), parts[r].end());
 }
 
-std::vector<uint32_t> SearchEngine::execute_rpn(const std::vector<Token>& rpn) {
-    std::stack<std::vector<uint32_t>> stack;
+void SearchEngine::evaluate_range(const std::pmr::vector<Token>& rpn, const std::pmr::vector<DocSpan>& operands,
+                                  uint64_t merged_bytes, uint32_t lo, uint32_t hi, QueryBudget& budget, DocList& result) {
+    std::pmr::memory_resource* memory = result.get_allocator().resource();
+    result.clear();
+    // На стеке только отрезки: операнды не копируются, результаты операций лежат в owned
+    std::pmr::vector<DocSpan> stack(memory);
+    std::pmr::vector<DocList> owned(memory);
+    owned.reserve(rpn.size());
+    size_t next_operand = 0;
+    // Для лимита памяти: объединения операндов и все результаты операций - owned живет до конца
+    // диапазона. Отрезки операндов указывают в отображение или в merged и памяти не занимают
+    uint64_t allocated = merged_bytes;
+    auto pop = [&]() {
+        DocSpan v = stack.back();
+        stack.pop_back();
+        return v;
+    };
 
     for (const auto& token : rpn) {
-        if (token.type == TERM) {
-            std::string term = Tokenizer::to_lower_utf8(token.value);
-            term = Stemmer::stem(term);
-            stack.push(get_postings(term));
-        } 
+        if (is_operand(token.type)) {
+            // Начало диапазона в постингах ищется бинарным поиском
+            const DocSpan& list = operands[next_operand++];
+            const uint32_t* first = std::lower_bound(list.data, list.data + list.size, lo);
+            const uint32_t* last = std::lower_bound(first, list.data + list.size, hi);
+            stack.push_back({first, (size_t)(last - first)});
+            if (!budget.charge(0, allocated)) return;
+        }
         else if (token.type == NOT) {
             if (stack.empty()) continue;
-            auto op1 = stack.top(); stack.pop();
-            auto all_docs = get_all_doc_ids();
-            stack.push(difference_postings(all_docs, op1));
+            // Проверка до выделения: NOT материализует весь диапазон
+            allocated += (uint64_t)(hi - lo) * sizeof(uint32_t);
+            if (!budget.charge(hi - lo + stack.back().size, allocated)) return;
+            DocSpan op1 = pop();
+            // Дополнение до [lo, hi) - промежутки между doc_id операнда
+            DocList& res = owned.emplace_back();
+            res.resize(hi - lo);
+            size_t n = 0;
+            uint32_t next = lo;
+            for (size_t i = 0; i < op1.size; ++i) {
+                while (next < op1.data[i]) res[n++] = next++;
+                next = op1.data[i] + 1;
+            }
+            while (next < hi) res[n++] = next++;
+            res.resize(n);
+            stack.push_back({res.data(), res.size()});
         }
         else {
             if (stack.size() < 2) continue;
-            auto op2 = stack.top(); stack.pop();
-            auto op1 = stack.top(); stack.pop();
+            DocSpan op2 = pop();
+            DocSpan op1 = pop();
+            uint64_t inputs = op1.size + op2.size;
+            // Как и для NOT, проверка до выделения
+            size_t capacity = (token.type == AND ? std::min(op1.size, op2.size) : op1.size + op2.size) + SetOps::OUTPUT_SLACK;
+            allocated += capacity * sizeof(uint32_t);
+            if (!budget.charge(inputs, allocated)) return;
 
-            if (token.type == AND) stack.push(intersect_postings(op1, op2));
-            else if (token.type == OR) stack.push(union_postings(op1, op2));
+            DocList& res = owned.emplace_back();
+            res.resize(capacity);
+            if (token.type == AND) {
+                res.resize(SetOps::intersect(op1.data, op1.size, op2.data, op2.size, res.data()));
+            } else if (token.type == OR) {
+                res.resize(SetOps::unite(op1.data, op1.size, op2.data, op2.size, res.data()));
+            }
+            stack.push_back({res.data(), res.size()});
         }
     }
-    if (stack.empty()) return {};
-    return stack.top();
+    if (stack.empty()) return;
+    // Результат последней операции забирается целиком, отрезок операнда копируется
+    const DocSpan& top = stack.back();
+    if (!owned.empty() && top.data == owned.back().data() && top.size == owned.back().size()) {
+        result = std::move(owned.back());
+    } else {
+        result.assign(top.data, top.data + top.size);
+    }
 }
 
-std::vector<SearchResult> SearchEngine::search(const std::string& query) {
-    auto rpn = QueryParser::parse_to_rpn(query);
-    auto doc_ids = execute_rpn(rpn);
-    std::vector<SearchResult> results;
+void SearchEngine::run_query(std::string_view query, QueryStatus& status, const std::atomic<bool>* cancel,
+                             DocList& doc_ids) {
+    auto rpn = QueryParser::parse_to_rpn(query, doc_ids.get_allocator().resource());
+    execute_rpn(rpn, status, cancel, doc_ids);
+    collapse_duplicates(doc_ids);
+}
+
+void SearchEngine::search_ids(const std::string& query, std::vector<uint32_t>& doc_ids, QueryStatus* status,
+                              const std::atomic<bool>* cancel) {
+    QueryArena::Scope scope;
+    QueryStatus local;
+    DocList ids(scope.resource());
+    run_query(query, status ? *status : local, cancel, ids);
+    doc_ids.assign(ids.begin(), ids.end());
+}
+
+std::vector<uint32_t> SearchEngine::search_ids(const std::string& query, QueryStatus* status,
+                                               const std::atomic<bool>* cancel) {
+    std::vector<uint32_t> doc_ids;
+    search_ids(query, doc_ids, status, cancel);
+    return doc_ids;
+}
+
+std::vector<RankedResult> SearchEngine::search_top_k(const std::string& query, size_t k,
+                                                     ImpactIndex::TopKStats* stats) {
+    if (!has_impacts()) throw std::runtime_error("Index has no impact_index.bin, rebuild it with --impacts");
+
+    QueryArena::Scope scope;
+    std::vector<ImpactIndex::Cursor> cursors;
+    std::pmr::set<uint32_t> seen_terms(scope.resource());
+    std::pmr::set<const uint32_t*> seen_titles(scope.resource());
+    std::pmr::vector<TitleIndex::Postings> titles(scope.resource());
+    std::pmr::string term(scope.resource());
+    bool boost = has_titles() && options.title_boost > 0;
+    for (const auto& token : QueryParser::parse_to_rpn(query, scope.resource())) {
+        if (token.type != TERM && !(token.type == TITLE && boost)) continue;
+        normalize_term(token.value, term);
+        if (boost) {
+            TitleIndex::Postings title = title_index.find(term);
+            if (title.count > 0 && seen_titles.insert(title.docs).second) titles.push_back(title);
+        }
+        if (token.type != TERM) continue;
+        TermInfo* info = dictionary.find(term);
+        if (!info || !seen_terms.insert(info->ordinal).second) continue;
+
+        const auto& impacts = impact_terms[info->ordinal];
+        const char* base = impact_file.data();
+        ImpactIndex::Cursor cursor;
+        cursor.docs = reinterpret_cast<const uint32_t*>(postings_file.data() + info->offset);
+        cursor.impacts = reinterpret_cast<const uint8_t*>(base + impacts.impacts_offset);
+        cursor.doc_freq = info->doc_freq;
+        cursor.head_docs = reinterpret_cast<const uint32_t*>(base + impacts.head_offset);
+        cursor.head_impacts = reinterpret_cast<const uint8_t*>(base + impacts.head_offset + impacts.head_count * 4ULL);
+        cursor.head_count = impacts.head_count;
+        cursor.tail_max = impacts.tail_max;
+        cursors.push_back(cursor);
+    }
+
+    // Прибавка за заголовок - курсор с постоянным impact: весь список в голове и нет хвоста,
+    // поэтому top_k не ищет в нем и не трогает постинги тела
+    std::pmr::vector<uint8_t> title_impacts(scope.resource());
+    if (!titles.empty()) {
+        uint32_t longest = 0;
+        for (const auto& title : titles) longest = std::max(longest, title.count);
+        long impact = std::clamp(std::lround(options.title_boost / impact_unit), 1L, 255L);
+        title_impacts.assign(longest, (uint8_t)impact);
+        for (const auto& title : titles) {
+            cursors.push_back({title.docs, title_impacts.data(), title.count,
+                               title.docs, title_impacts.data(), title.count, 0});
+        }
+    }
+
+    // Схлопывание дубликатов может сократить ответ: тогда top-k запрашивается с запасом
+    bool collapse = !in_cluster.empty() && options.collapse_duplicates;
+    std::vector<ImpactIndex::ScoredDoc> top;
+    for (size_t want = k;; want *= 2) {
+        if (stats) *stats = ImpactIndex::TopKStats();
+        top = options.early_termination ? ImpactIndex::top_k(cursors, want, stats)
+                                        : ImpactIndex::top_k_exhaustive(cursors, want, stats);
+        if (!collapse) break;
+
+        std::pmr::unordered_set<uint32_t> seen(scope.resource());
+        size_t kept = 0;
+        for (const auto& d : top) {
+            if (!in_cluster[d.doc_id] || seen.insert(doc_cluster[d.doc_id]).second) top[kept++] = d;
+        }
+        bool exhausted = top.size() < want;
+        top.resize(kept);
+        if (kept >= k || exhausted) break;
+    }
+
+    std::vector<RankedResult> results;
+    for (size_t i = 0; i < top.size() && i < k; ++i) {
+        results.push_back({top[i].doc_id, top[i].score * impact_unit, doc_titles[top[i].doc_id]});
+    }
+    return results;
+}
+
+void SearchEngine::search(const std::string& query, std::vector<SearchResult>& results, QueryStatus* status,
+                          const std::atomic<bool>* cancel) {
+    QueryArena::Scope scope;
+    QueryStatus local;
+    DocList doc_ids(scope.resource());
+    run_query(query, status ? *status : local, cancel, doc_ids);
+
+    // Заголовки копируются в строки прежних результатов, их буферы переиспользуются
     results.reserve(doc_ids.size());
+    size_t count = 0;
     for (uint32_t id : doc_ids) {
-        if (id < doc_titles.size()) {
-            results.push_back({id, doc_titles[id], ""}); 
-        }
+        if (id >= doc_titles.size()) continue;
+        if (count == results.size()) results.emplace_back();
+        SearchResult& result = results[count++];
+        result.doc_id = id;
+        result.title.assign(doc_titles[id]);
+        result.url.clear();
     }
+    results.resize(count);
+}
+
+std::vector<SearchResult> SearchEngine::search(const std::string& query, QueryStatus* status,
+                                               const std::atomic<bool>* cancel) {
+    std::vector<SearchResult> results;
+    search(query, results, status, cancel);
     return results;
-}
\ No newline at end of file
+}
+
+std::string SearchEngine::get_document(uint32_t doc_id) {
+    if (!doc_store.is_open()) return "";
+    return doc_store.get_document(doc_id);
+}
+
+std::vector<std::string> SearchEngine::query_terms(const std::string& query) {
+    QueryArena::Scope scope;
+    std::vector<std::string> terms;
+    for (const auto& token : QueryParser::parse_to_rpn(query, scope.resource())) {
+        if (!is_operand(token.type) || token.type == SUBSTRING) continue;
+        std::string term = normalize_term(token.value);
+        if (!term.empty() && std::find(terms.begin(), terms.end(), term) == terms.end()) {
+            terms.push_back(term);
+        }
+    }
+    return terms;
+}
+
+static void append_html_escaped(std::string& out, const std::string& text, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        char c = text[i];
+        if (c == '<') out += "&lt;";
+        else if (c == '>') out += "&gt;";
+        else if (c == '&') out += "&amp;";
+        else if (c == '\n' || c == '\r' || c == '\t') out += ' ';
+        else out += c;
+    }
+}
+
+std::string SearchEngine::make_snippet(uint32_t doc_id, const std::vector<std::string>& terms, size_t max_bytes) {
+    std::string text = get_document(doc_id);
+    if (text.empty()) return "";
+
+    // Первая строка документа - заголовок, сниппет строится по телу
+    size_t body = text.find('\n');
+    body = (body == std::string::npos) ? 0 : body + 1;
+
+    struct Word {
+        size_t begin;
+        size_t end;
+        bool hit;
+    };
+    std::vector<Word> words;
+
+    Tokenizer::split_words(text, [&](size_t b, size_t e) {
+        if (b < body) return;
+        bool hit = false;
+        std::string lower = Tokenizer::to_lower_utf8(text.substr(b, e - b));
+        for (const auto& term : terms) {
+            // Стеммер только отрезает окончания, поэтому стем - префикс слова
+            if (lower.compare(0, term.size(), term) == 0 && Stemmer::stem_length(lower) == term.size()) {
+                hit = true;
+                break;
+            }
+        }
+        words.push_back({b, e, hit});
+    });
+    if (words.empty()) return "";
+
+    // Окно с максимальным числом совпадений
+    size_t best_start = 0;
+    size_t best_hits = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (!words[i].hit) continue;
+        size_t hits = 0;
+        for (size_t j = i; j < words.size() && words[j].end - words[i].begin <= max_bytes; ++j) {
+            if (words[j].hit) hits++;
+        }
+        if (hits > best_hits) {
+            best_hits = hits;
+            best_start = i;
+        }
+    }
+
+    const size_t context_words = 4;
+    size_t first = best_start > context_words ? best_start - context_words : 0;
+    size_t last = first;
+    while (last + 1 < words.size() && words[last + 1].end - words[first].begin <= max_bytes) {
+        last++;
+    }
+
+    std::string snippet;
+    if (first > 0) snippet += "... ";
+    size_t pos = words[first].begin;
+    for (size_t i = first; i <= last; ++i) {
+        append_html_escaped(snippet, text, pos, words[i].begin);
+        if (words[i].hit) snippet += "<b>";
+        append_html_escaped(snippet, text, words[i].begin, words[i].end);
+        if (words[i].hit) snippet += "</b>";
+        pos = words[i].end;
+    }
+    if (last + 1 < words.size()) snippet += " ...";
+    return snippet;
+}
+
+MemoryUsage SearchEngine::memory_usage() const {
+    MemoryUsage usage;
+    usage.dictionary = dictionary.memory_bytes();
+    usage.completion = completion_index.mapped_bytes();
+    usage.title_index = title_index.mapped_bytes();
+    usage.sorted_terms = sorted_terms.capacity() * sizeof(std::string);
+    for (const auto& term : sorted_terms) usage.sorted_terms += string_heap_bytes(term);
+    usage.titles = doc_titles.capacity() * sizeof(std::string);
+    for (const auto& title : doc_titles) usage.titles += string_heap_bytes(title);
+    usage.doc_store_tables = doc_store.table_bytes();
+    usage.doc_store_cache = doc_store.cache_bytes();
+    usage.clusters = doc_cluster.capacity() * sizeof(uint32_t) + in_cluster.capacity() / 8;
+    usage.impact_table = impact_terms.capacity() * sizeof(ImpactIndex::TermImpacts);
+    return usage;
+}
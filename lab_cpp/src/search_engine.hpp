@@ -1,14 +1,30 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory_resource>
 #include <fstream>
+#include <atomic>
+#include <stdexcept>
 #include "query_parser.hpp"
+#include "doc_store.hpp"
+#include "mapped_file.hpp"
+#include "impact_index.hpp"
+#include "trigram_index.hpp"
+#include "completion_index.hpp"
+#include "title_index.hpp"
 
 struct TermInfo {
     uint32_t doc_freq;
     uint32_t offset;
+    uint32_t ordinal; // номер в словаре, он же запись терма в impact_index.bin
 };
 
+// Память под содержимое строки вне самого объекта (короткие строки хранятся внутри, SSO)
+inline size_t string_heap_bytes(const std::string& s) {
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
 class DictionaryMap {
 private:
     struct Node {
@@ -19,7 +35,7 @@ private:
     std::vector<std::vector<Node>> buckets;
     size_t table_size;
 
-    size_t get_hash(const std::string& key) const {
+    size_t get_hash(std::string_view key) const {
         size_t hash = 5381;
         for (char c : key) hash = ((hash << 5) + hash) + c;
         return hash;
@@ -35,7 +51,7 @@ public:
         buckets[idx].push_back({key, val});
     }
 
-    TermInfo* find(const std::string& key) {
+    TermInfo* find(std::string_view key) {
         size_t idx = get_hash(key) % table_size;
         for (auto& node : buckets[idx]) {
             if (node.key == key) {
@@ -44,6 +60,95 @@ public:
         }
         return nullptr;
     }
+
+    size_t memory_bytes() const {
+        size_t total = buckets.capacity() * sizeof(std::vector<Node>);
+        for (const auto& bucket : buckets) {
+            total += bucket.capacity() * sizeof(Node);
+            for (const auto& node : bucket) total += string_heap_bytes(node.key);
+        }
+        return total;
+    }
+};
+
+// Ограничения одного запроса, 0 - без ограничения. Стоимость считается в элементах
+// постингов: до выполнения - оценка по doc_freq (запрос дороже лимита отклоняется сразу),
+// во время выполнения - фактически прочитанные и обработанные элементы
+struct QueryLimits {
+    uint32_t max_time_ms = 0;
+    uint64_t max_postings = 0;
+    uint64_t max_memory_bytes = 0; // выделенные запросом списки doc_id, без постингов в отображении
+};
+
+// Запрос отклонен по оценке стоимости до выполнения
+class QueryLimitError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Итог выполнения запроса. При partial ответ полон только для doc_id < docs_covered
+struct QueryStatus {
+    bool partial = false;
+    std::string reason; // time, postings, memory или cancelled
+    uint32_t docs_covered = 0;
+    uint64_t estimated_cost = 0;
+    uint64_t postings_touched = 0;
+};
+
+class QueryBudget;
+
+struct SearchOptions {
+    // Сколько термов словаря максимум подставляется вместо ~терма
+    size_t fuzzy_max_expansions = 50;
+    // То же для *подстроки*
+    size_t substring_max_expansions = 200;
+
+    // Параллельное выполнение одного запроса по диапазонам doc_id (по умолчанию выключено).
+    // Включается только для запросов дороже parallel_min_cost элементов постингов.
+    bool parallel = false;
+    uint64_t parallel_min_cost = 500000;
+    size_t parallel_ranges_per_thread = 4;
+
+    // Из каждого кластера почти-дубликатов (doc_clusters.bin) в выдаче остается первый документ
+    bool collapse_duplicates = true;
+
+    // Ранжированный top-k останавливается по головам постингов, если хвосты не могут изменить ответ
+    bool early_termination = true;
+
+    // Прибавка к BM25 в top-k за терм запроса в заголовке (нужен title_index.bin), 0 - без нее
+    float title_boost = 2.0f;
+
+    QueryLimits limits;
+};
+
+// Оценка памяти, занятой загруженным индексом (в байтах)
+struct MemoryUsage {
+    size_t dictionary = 0;
+    size_t completion = 0; // completion.bin, отображен в память
+    size_t title_index = 0; // title_index.bin, отображен в память
+    size_t sorted_terms = 0;
+    size_t titles = 0;
+    size_t doc_store_tables = 0;
+    size_t doc_store_cache = 0;
+    size_t clusters = 0;
+    size_t impact_table = 0;
+
+    size_t total() const {
+        return dictionary + completion + title_index + sorted_terms + titles + doc_store_tables + doc_store_cache + clusters + impact_table;
+    }
+
+    MemoryUsage& operator+=(const MemoryUsage& other) {
+        dictionary += other.dictionary;
+        completion += other.completion;
+        title_index += other.title_index;
+        sorted_terms += other.sorted_terms;
+        titles += other.titles;
+        doc_store_tables += other.doc_store_tables;
+        doc_store_cache += other.doc_store_cache;
+        clusters += other.clusters;
+        impact_table += other.impact_table;
+        return *this;
+    }
 };
 
 struct SearchResult {
@@ -52,23 +157,112 @@ struct SearchResult {
     std::string url;
 };
 
+struct RankedResult {
+    uint32_t doc_id;
+    float score;
+    std::string title;
+};
+
 class SearchEngine {
 public:
     void load_index(const std::string& index_dir);
-    std::vector<SearchResult> search(const std::string& query);
+    // cancel - флаг отмены из другого потока, проверяется вместе с лимитами
+    std::vector<SearchResult> search(const std::string& query, QueryStatus* status = nullptr,
+                                     const std::atomic<bool>* cancel = nullptr);
+    // Только id найденных документов, без копирования заголовков
+    std::vector<uint32_t> search_ids(const std::string& query, QueryStatus* status = nullptr,
+                                     const std::atomic<bool>* cancel = nullptr);
+    // То же в буферы вызывающего. Промежуточные данные запроса живут в QueryArena потока,
+    // поэтому при повторном использовании буферов запрос не выделяет память в куче
+    // (кроме ~термов, *подстрок* и параллельного режима)
+    void search(const std::string& query, std::vector<SearchResult>& results, QueryStatus* status = nullptr,
+                const std::atomic<bool>* cancel = nullptr);
+    void search_ids(const std::string& query, std::vector<uint32_t>& doc_ids, QueryStatus* status = nullptr,
+                    const std::atomic<bool>* cancel = nullptr);
+    // Ранжирование по BM25 (нужен impact_index.bin): простые термы запроса через OR,
+    // операторы и ~термы не учитываются. С title_index.bin документ получает title_boost
+    // за каждый терм в заголовке (title:терм - только эту прибавку). Результат по убыванию оценки
+    std::vector<RankedResult> search_top_k(const std::string& query, size_t k,
+                                           ImpactIndex::TopKStats* stats = nullptr);
+    bool has_impacts() const { return impact_file.is_open(); }
     uint32_t get_total_docs() const { return static_cast<uint32_t>(doc_titles.size()); }
+    const std::string& get_title(uint32_t doc_id) const { return doc_titles.at(doc_id); }
+    // Сборка из generation.bin: у шардов одного индекса совпадает; 0 - индекс собран без него
+    uint64_t get_build_id() const { return build_id; }
+
+    void set_options(const SearchOptions& opt) { options = opt; }
+    const SearchOptions& get_options() const { return options; }
+
+    MemoryUsage memory_usage() const;
+
+    // Термы словаря на расстоянии <= max_edits: сначала ближайшие, затем по убыванию doc_freq
+    std::vector<std::string> expand_fuzzy(const std::string& term, int max_edits);
+    // Термы, словоформы которых содержат подстроку, по убыванию doc_freq. Без trigram_index.bin
+    // подстрока ищется перебором по самим термам словаря
+    std::vector<std::string> expand_substring(const std::string& sub);
+    bool has_trigrams() const { return trigram_index.is_open(); }
+
+    // Подсказки по префиксу словоформы из completion.bin, по убыванию doc_freq
+    std::vector<CompletionIndex::Suggestion> complete(const std::string& prefix, size_t k) const;
+    bool has_completions() const { return completion_index.is_open(); }
+    // Постинги заголовков для title:терм (title_index.bin)
+    bool has_titles() const { return title_index.is_open(); }
+
+    // Тексты и сниппеты из сжатого хранилища (если индекс построен с docs_store.bin)
+    bool has_doc_store() const { return doc_store.is_open(); }
+    std::string get_document(uint32_t doc_id);
+    std::string make_snippet(uint32_t doc_id, const std::vector<std::string>& terms, size_t max_bytes = 240);
+    static std::vector<std::string> query_terms(const std::string& query);
+
     static std::vector<uint32_t> intersect_postings(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
     static std::vector<uint32_t> union_postings(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
     static std::vector<uint32_t> difference_postings(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
 
 private:
     std::string index_dir;
+    uint64_t build_id = 0;
     
     DictionaryMap dictionary; 
+    MappedFile postings_file;
+    std::vector<std::string> sorted_terms;
     
     std::vector<std::string> doc_titles;
 
-    std::vector<uint32_t> get_postings(const std::string& term);
-    std::vector<uint32_t> get_all_doc_ids();
-    std::vector<uint32_t> execute_rpn(const std::vector<Token>& rpn);
+    // Кластер каждого документа; пусто, если индекс построен без --dedup collapse
+    std::vector<uint32_t> doc_cluster;
+    std::vector<bool> in_cluster;
+
+    TrigramIndex trigram_index;
+    CompletionIndex completion_index;
+    TitleIndex title_index;
+
+    MappedFile impact_file;
+    std::vector<ImpactIndex::TermImpacts> impact_terms;
+    float impact_unit = 1;
+
+    SearchOptions options;
+
+    DocStore doc_store;
+
+    void load_clusters(const std::string& filename);
+    void load_impacts(const std::string& filename, const std::vector<TermInfo>& terms);
+    // Отрезок doc_id без владения: постинги прямо в отображении inverted_index.bin
+    // или промежуточный список в памяти запроса
+    struct DocSpan {
+        const uint32_t* data;
+        size_t size;
+    };
+    using DocList = std::pmr::vector<uint32_t>;
+
+    void collapse_duplicates(DocList& doc_ids) const;
+    static std::string normalize_term(std::string_view raw);
+    static void normalize_term(std::string_view raw, std::pmr::string& out);
+    DocSpan postings_of(const TermInfo& info) const;
+    // Результат и все промежуточные списки - на ресурсе памяти doc_ids
+    void run_query(std::string_view query, QueryStatus& status, const std::atomic<bool>* cancel, DocList& doc_ids);
+    void execute_rpn(const std::pmr::vector<Token>& rpn, QueryStatus& status,
+                     const std::atomic<bool>* cancel, DocList& result);
+    // merged_bytes - уже выделенные объединения операндов, учитываются в лимите памяти
+    void evaluate_range(const std::pmr::vector<Token>& rpn, const std::pmr::vector<DocSpan>& operands,
+                        uint64_t merged_bytes, uint32_t lo, uint32_t hi, QueryBudget& budget, DocList& result);
 };
\ No newline at end of file
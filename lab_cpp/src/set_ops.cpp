@@ -0,0 +1,437 @@
+#include "set_ops.hpp"
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SET_OPS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace SetOps {
+
+namespace {
+
+    // ---------- Скалярные ядра: сравнения превращены в арифметику вместо ветвлений ----------
+
+    size_t intersect_scalar(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        size_t i = 0, j = 0, count = 0;
+        while (i < na && j < nb) {
+            uint32_t x = a[i], y = b[j];
+            out[count] = x;
+            count += x == y;
+            i += x <= y;
+            j += y <= x;
+        }
+        return count;
+    }
+
+    // Дописывает a и b к out[0, count), пропуская повтор последнего записанного
+    size_t unite_append(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out, size_t count) {
+        size_t i = 0, j = 0;
+        auto emit = [&](uint32_t v) {
+            if (count == 0 || out[count - 1] != v) out[count++] = v;
+        };
+        while (i < na && j < nb) {
+            uint32_t x = a[i], y = b[j];
+            emit(x <= y ? x : y);
+            i += x <= y;
+            j += y <= x;
+        }
+        while (i < na) emit(a[i++]);
+        while (j < nb) emit(b[j++]);
+        return count;
+    }
+
+    size_t difference_scalar(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        size_t i = 0, j = 0, count = 0;
+        while (i < na && j < nb) {
+            uint32_t x = a[i], y = b[j];
+            out[count] = x;
+            count += x < y;
+            i += x <= y;
+            j += y <= x;
+        }
+        std::copy(a + i, a + na, out + count);
+        return count + (na - i);
+    }
+
+    // Первая позиция не раньше from со значением >= x: экспоненциальный шаг, затем двоичный поиск
+    size_t gallop(const uint32_t* list, size_t n, size_t from, uint32_t x) {
+        if (from >= n || list[from] >= x) return from;
+        size_t bound = 1;
+        while (from + bound < n && list[from + bound] < x) bound <<= 1;
+        return std::lower_bound(list + from + bound / 2 + 1, list + std::min(n, from + bound + 1), x) - list;
+    }
+
+    // Для списков сильно разной длины: каждый элемент короткого ищется в длинном от прошлой позиции,
+    // куски длинного между найденными позициями копируются целиком
+    size_t intersect_galloping(const uint32_t* small, size_t ns, const uint32_t* large, size_t nl, uint32_t* out) {
+        size_t j = 0, count = 0;
+        for (size_t i = 0; i < ns && j < nl; ++i) {
+            j = gallop(large, nl, j, small[i]);
+            if (j < nl && large[j] == small[i]) out[count++] = large[j++];
+        }
+        return count;
+    }
+
+    size_t unite_galloping(const uint32_t* small, size_t ns, const uint32_t* large, size_t nl, uint32_t* out) {
+        size_t j = 0, count = 0;
+        for (size_t i = 0; i < ns; ++i) {
+            size_t next = gallop(large, nl, j, small[i]);
+            out = std::copy(large + j, large + next, out);
+            count += next - j;
+            *out++ = small[i];
+            count++;
+            j = next + (next < nl && large[next] == small[i]);
+        }
+        std::copy(large + j, large + nl, out);
+        return count + (nl - j);
+    }
+
+    // a намного длиннее b: из a вырезаются элементы b
+    size_t difference_galloping(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        size_t i = 0, count = 0;
+        for (size_t j = 0; j < nb && i < na; ++j) {
+            size_t next = gallop(a, na, i, b[j]);
+            out = std::copy(a + i, a + next, out);
+            count += next - i;
+            i = next + (next < na && a[next] == b[j]);
+        }
+        std::copy(a + i, a + na, out);
+        return count + (na - i);
+    }
+
+    // a намного короче b: элементы a ищутся в b
+    size_t difference_probing(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        size_t j = 0, count = 0;
+        for (size_t i = 0; i < na; ++i) {
+            j = gallop(b, nb, j, a[i]);
+            if (j == nb || b[j] != a[i]) out[count++] = a[i];
+        }
+        return count;
+    }
+
+#ifdef SET_OPS_X86
+
+    // Таблицы упаковки: для маски выбранных дорожек - перестановка, сдвигающая их в начало
+    struct CompactTables {
+        alignas(16) uint8_t sse[16][16];
+        alignas(32) uint32_t avx[256][8];
+
+        CompactTables() {
+            for (int mask = 0; mask < 16; ++mask) {
+                int pos = 0;
+                for (int lane = 0; lane < 4; ++lane) {
+                    if (!(mask >> lane & 1)) continue;
+                    for (int byte = 0; byte < 4; ++byte) sse[mask][pos * 4 + byte] = (uint8_t)(lane * 4 + byte);
+                    pos++;
+                }
+                for (; pos < 4; ++pos) {
+                    for (int byte = 0; byte < 4; ++byte) sse[mask][pos * 4 + byte] = 0x80;
+                }
+            }
+            for (int mask = 0; mask < 256; ++mask) {
+                int pos = 0;
+                for (int lane = 0; lane < 8; ++lane) {
+                    if (mask >> lane & 1) avx[mask][pos++] = (uint32_t)lane;
+                }
+                for (; pos < 8; ++pos) avx[mask][pos] = 0;
+            }
+        }
+    };
+
+    const CompactTables& tables() {
+        static const CompactTables instance;
+        return instance;
+    }
+
+    // ---------- SSE4.2: блоки по 4 ----------
+
+    // Маска дорожек va, значения которых есть в vb: сравнение со всеми 4 поворотами vb
+    __attribute__((target("sse4.2"))) inline int match4(__m128i va, __m128i vb) {
+        __m128i eq = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+        return _mm_movemask_ps(_mm_castsi128_ps(eq));
+    }
+
+    __attribute__((target("sse4.2"))) inline size_t store4(__m128i v, int mask, uint32_t* out,
+                                                           const CompactTables& t) {
+        __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(t.sse[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(v, shuffle));
+        return (size_t)__builtin_popcount(mask);
+    }
+
+    __attribute__((target("sse4.2"))) inline __m128i load4(const uint32_t* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+    __attribute__((target("sse4.2")))
+    size_t intersect_sse(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        const CompactTables& t = tables();
+        size_t i = 0, j = 0, count = 0;
+        if (na >= 4 && nb >= 4) {
+            __m128i va = load4(a), vb = load4(b);
+            while (true) {
+                count += store4(va, match4(va, vb), out + count, t);
+                // Продвигается блок с меньшим максимумом: он не пересечется со следующими блоками другого
+                uint32_t a_max = a[i + 3], b_max = b[j + 3];
+                if (a_max <= b_max) {
+                    i += 4;
+                    if (i + 4 > na) break;
+                    va = load4(a + i);
+                }
+                if (b_max <= a_max) {
+                    j += 4;
+                    if (j + 4 > nb) break;
+                    vb = load4(b + j);
+                }
+            }
+        }
+        return count + intersect_scalar(a + i, na - i, b + j, nb - j, out + count);
+    }
+
+    // Сеть слияния двух отсортированных векторов: min - 4 меньших, max - 4 больших, оба по возрастанию
+    __attribute__((target("sse4.2"))) inline void merge4(__m128i x, __m128i y, __m128i& min, __m128i& max) {
+        __m128i tmp = _mm_min_epu32(x, y);
+        max = _mm_max_epu32(x, y);
+        for (int round = 0; round < 3; ++round) {
+            tmp = _mm_alignr_epi8(tmp, tmp, 4);
+            min = _mm_min_epu32(tmp, max);
+            max = _mm_max_epu32(tmp, max);
+            tmp = min;
+        }
+        min = _mm_alignr_epi8(min, min, 4);
+    }
+
+    // Пишет дорожки v, отличные от предыдущей (для первой - от последней дорожки prev)
+    __attribute__((target("sse4.2"))) inline size_t store_unique4(__m128i prev, __m128i v, uint32_t* out,
+                                                                  const CompactTables& t) {
+        __m128i shifted = _mm_alignr_epi8(v, prev, 12);
+        int repeats = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(shifted, v)));
+        return store4(v, ~repeats & 15, out, t);
+    }
+
+    __attribute__((target("sse4.2")))
+    size_t unite_sse(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        if (na < 4 || nb < 4) return unite_append(a, na, b, nb, out, 0);
+        const CompactTables& t = tables();
+        // Выход идет по возрастанию: блок берется из списка с меньшей головой,
+        // сеть слияния отдает 4 наименьших, 4 наибольших ждут следующего блока
+        __m128i min, max;
+        merge4(load4(a), load4(b), min, max);
+        __m128i prev = _mm_set1_epi32((int)(std::min(a[0], b[0]) - 1));
+        size_t i = 4, j = 4, count = store_unique4(prev, min, out, t);
+        prev = min;
+        while (i + 4 <= na && j + 4 <= nb) {
+            __m128i v;
+            if (a[i] <= b[j]) {
+                v = load4(a + i);
+                i += 4;
+            } else {
+                v = load4(b + j);
+                j += 4;
+            }
+            merge4(v, max, min, max);
+            count += store_unique4(prev, min, out + count, t);
+            prev = min;
+        }
+        // Остаток: 4 ждущих значения, хвост одного списка короче блока и остаток другого
+        alignas(16) uint32_t pending[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(pending), max);
+        uint32_t buffer[8];
+        if (i + 4 > na) {
+            size_t n = unite_append(pending, 4, a + i, na - i, buffer, 0);
+            return unite_append(buffer, n, b + j, nb - j, out, count);
+        }
+        size_t n = unite_append(pending, 4, b + j, nb - j, buffer, 0);
+        return unite_append(buffer, n, a + i, na - i, out, count);
+    }
+
+    __attribute__((target("sse4.2")))
+    size_t difference_sse(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        const CompactTables& t = tables();
+        size_t i = 0, j = 0, count = 0;
+        if (nb >= 4) {
+            for (; i + 4 <= na; i += 4) {
+                __m128i va = load4(a + i);
+                uint32_t a_max = a[i + 3];
+                int found = 0;
+                // Блоки b, которые начинаются не позже конца блока a; последний может задеть и следующий
+                while (j + 4 <= nb && b[j] <= a_max) {
+                    found |= match4(va, load4(b + j));
+                    if (b[j + 3] > a_max) break;
+                    j += 4;
+                }
+                if (j + 4 > nb) {
+                    for (int lane = 0; lane < 4; ++lane) {
+                        if (std::find(b + j, b + nb, a[i + lane]) != b + nb) found |= 1 << lane;
+                    }
+                }
+                count += store4(va, ~found & 15, out + count, t);
+            }
+        }
+        return count + difference_scalar(a + i, na - i, b + j, nb - j, out + count);
+    }
+
+    // ---------- AVX2: блоки по 8 ----------
+
+    __attribute__((target("avx2"))) inline __m256i load8(const uint32_t* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    // Сравнение со всеми 8 поворотами: 4 внутри половин и 4 с переставленными половинами
+    __attribute__((target("avx2"))) inline int match8(__m256i va, __m256i vb) {
+        __m256i swapped = _mm256_permute2x128_si256(vb, vb, 1);
+        __m256i eq = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, vb),
+                                _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                                _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))))),
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, swapped),
+                                _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(swapped, _MM_SHUFFLE(0, 3, 2, 1)))),
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(swapped, _MM_SHUFFLE(1, 0, 3, 2))),
+                                _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(swapped, _MM_SHUFFLE(2, 1, 0, 3))))));
+        return _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+    }
+
+    __attribute__((target("avx2"))) inline size_t store8(__m256i v, int mask, uint32_t* out,
+                                                         const CompactTables& t) {
+        __m256i permutation = _mm256_load_si256(reinterpret_cast<const __m256i*>(t.avx[mask]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permutevar8x32_epi32(v, permutation));
+        return (size_t)__builtin_popcount(mask);
+    }
+
+    __attribute__((target("avx2")))
+    size_t intersect_avx2(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        const CompactTables& t = tables();
+        size_t i = 0, j = 0, count = 0;
+        if (na >= 8 && nb >= 8) {
+            __m256i va = load8(a), vb = load8(b);
+            while (true) {
+                count += store8(va, match8(va, vb), out + count, t);
+                uint32_t a_max = a[i + 7], b_max = b[j + 7];
+                if (a_max <= b_max) {
+                    i += 8;
+                    if (i + 8 > na) break;
+                    va = load8(a + i);
+                }
+                if (b_max <= a_max) {
+                    j += 8;
+                    if (j + 8 > nb) break;
+                    vb = load8(b + j);
+                }
+            }
+        }
+        return count + intersect_sse(a + i, na - i, b + j, nb - j, out + count);
+    }
+
+    __attribute__((target("avx2")))
+    size_t difference_avx2(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+        const CompactTables& t = tables();
+        size_t i = 0, j = 0, count = 0;
+        if (nb >= 8) {
+            for (; i + 8 <= na; i += 8) {
+                __m256i va = load8(a + i);
+                uint32_t a_max = a[i + 7];
+                int found = 0;
+                while (j + 8 <= nb && b[j] <= a_max) {
+                    found |= match8(va, load8(b + j));
+                    if (b[j + 7] > a_max) break;
+                    j += 8;
+                }
+                if (j + 8 > nb) {
+                    for (int lane = 0; lane < 8; ++lane) {
+                        if (std::find(b + j, b + nb, a[i + lane]) != b + nb) found |= 1 << lane;
+                    }
+                }
+                count += store8(va, ~found & 255, out + count, t);
+            }
+        }
+        return count + difference_scalar(a + i, na - i, b + j, nb - j, out + count);
+    }
+
+#endif
+
+    Kernel detect() {
+#ifdef SET_OPS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return Kernel::AVX2;
+        if (__builtin_cpu_supports("sse4.2")) return Kernel::SSE42;
+#endif
+        return Kernel::SCALAR;
+    }
+
+    Kernel& active() {
+        static Kernel current = best_kernel();
+        return current;
+    }
+}
+
+Kernel best_kernel() {
+    static const Kernel best = detect();
+    return best;
+}
+
+Kernel kernel() {
+    return active();
+}
+
+void set_kernel(Kernel requested) {
+    active() = std::min(requested, best_kernel());
+}
+
+const char* kernel_name(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::AVX2: return "avx2";
+        case Kernel::SSE42: return "sse4.2";
+        default: return "scalar";
+    }
+}
+
+size_t intersect(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+    if (na > nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (na == 0) return 0;
+    if (na * GALLOP_RATIO < nb) return intersect_galloping(a, na, b, nb, out);
+#ifdef SET_OPS_X86
+    if (active() == Kernel::AVX2) return intersect_avx2(a, na, b, nb, out);
+    if (active() == Kernel::SSE42) return intersect_sse(a, na, b, nb, out);
+#endif
+    return intersect_scalar(a, na, b, nb, out);
+}
+
+size_t unite(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+    if (na == 0 || nb == 0) {
+        const uint32_t* src = na == 0 ? b : a;
+        std::copy(src, src + na + nb, out);
+        return na + nb;
+    }
+    if (na * GALLOP_RATIO < nb) return unite_galloping(a, na, b, nb, out);
+    if (nb * GALLOP_RATIO < na) return unite_galloping(b, nb, a, na, out);
+#ifdef SET_OPS_X86
+    // Отдельного ядра объединения на AVX2 нет: работает ядро SSE4.2
+    if (active() != Kernel::SCALAR) return unite_sse(a, na, b, nb, out);
+#endif
+    return unite_append(a, na, b, nb, out, 0);
+}
+
+size_t difference(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+    if (na == 0 || nb == 0 || b[nb - 1] < a[0] || a[na - 1] < b[0]) {
+        std::copy(a, a + na, out);
+        return na;
+    }
+    if (nb * GALLOP_RATIO < na) return difference_galloping(a, na, b, nb, out);
+    if (na * GALLOP_RATIO < nb) return difference_probing(a, na, b, nb, out);
+#ifdef SET_OPS_X86
+    if (active() == Kernel::AVX2) return difference_avx2(a, na, b, nb, out);
+    if (active() == Kernel::SSE42) return difference_sse(a, na, b, nb, out);
+#endif
+    return difference_scalar(a, na, b, nb, out);
+}
+
+}
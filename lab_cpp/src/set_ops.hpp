@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Пересечение, объединение и разность отсортированных списков doc_id без повторов.
+// Векторные ядра (SSE4.2 - блоки по 4, AVX2 - по 8) выбираются при первом вызове
+// по возможностям процессора; без x86 и GCC/Clang остаются скалярные.
+// Результат пишется в заранее выделенный буфер: вектора сохраняются целиком,
+// поэтому за нужной длиной нужно еще OUTPUT_SLACK элементов.
+namespace SetOps {
+
+    enum class Kernel { SCALAR, SSE42, AVX2 };
+
+    constexpr size_t OUTPUT_SLACK = 8;
+    // Начиная с какого соотношения длин длинный список обходится галопом, а не слиянием
+    constexpr size_t GALLOP_RATIO = 32;
+
+    // Лучшее ядро, которое поддерживает процессор
+    Kernel best_kernel();
+    Kernel kernel();
+    // Для тестов и бенчмарков: ядро выше поддерживаемого не включается. Не потокобезопасно
+    void set_kernel(Kernel kernel);
+    const char* kernel_name(Kernel kernel);
+
+    // out вмещает min(na, nb) + OUTPUT_SLACK; возвращают число записанных элементов
+    size_t intersect(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out);
+    // out вмещает na + nb + OUTPUT_SLACK
+    size_t unite(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out);
+    // a без b; out вмещает na + OUTPUT_SLACK
+    size_t difference(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out);
+}
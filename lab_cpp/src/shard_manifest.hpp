@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include "binary_utils.hpp"
+
+// Разбиение индекса на шарды: index_dir/shards.bin + index_dir/shard_<k>/.
+// Шард k содержит документы с глобальными id [doc_base, doc_base + doc_count).
+
+struct ShardInfo {
+    uint32_t doc_base;
+    uint32_t doc_count;
+};
+
+namespace ShardManifest {
+
+    const uint32_t SIGNATURE = 0x44524853;
+
+    inline std::string manifest_path(const std::string& index_dir) {
+        return index_dir + "/shards.bin";
+    }
+
+    inline std::string shard_dir(const std::string& index_dir, uint32_t shard) {
+        return index_dir + "/shard_" + std::to_string(shard);
+    }
+
+    inline void write(const std::string& index_dir, const std::vector<ShardInfo>& shards) {
+        std::ofstream out(manifest_path(index_dir), std::ios::binary);
+        BinaryUtils::write_u32(out, SIGNATURE);
+        BinaryUtils::write_u32(out, (uint32_t)shards.size());
+        for (const auto& s : shards) {
+            BinaryUtils::write_u32(out, s.doc_base);
+            BinaryUtils::write_u32(out, s.doc_count);
+        }
+    }
+
+    // Пустой результат - индекс не шардирован
+    inline std::vector<ShardInfo> read(const std::string& index_dir) {
+        std::ifstream in(manifest_path(index_dir), std::ios::binary);
+        if (!in.is_open()) return {};
+        if (BinaryUtils::read_u32(in) != SIGNATURE) throw std::runtime_error("Invalid shards manifest signature");
+
+        std::vector<ShardInfo> shards(BinaryUtils::read_u32(in));
+        for (auto& s : shards) {
+            s.doc_base = BinaryUtils::read_u32(in);
+            s.doc_count = BinaryUtils::read_u32(in);
+        }
+        if (!in) throw std::runtime_error("Truncated shards manifest");
+        return shards;
+    }
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Вероятностные структуры для статистики с фиксированным объемом памяти.
+
+inline uint64_t hash64(const std::string& key) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Count-Min: оценка сверху, ошибка <= eps * N с вероятностью 1 - delta,
+// где eps = e / width, delta = e^(-depth).
+class CountMinSketch {
+private:
+    size_t width;
+    size_t depth;
+    std::vector<uint32_t> table;
+
+    size_t cell(uint64_t hash, size_t row) const {
+        uint32_t h1 = (uint32_t)hash;
+        uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+        return row * width + (h1 + row * h2) % width;
+    }
+
+public:
+    CountMinSketch(size_t w = 1 << 16, size_t d = 4) : width(w), depth(d) {
+        table.assign(width * depth, 0);
+    }
+
+    uint32_t add(uint64_t hash, uint32_t count = 1) {
+        uint32_t est = UINT32_MAX;
+        for (size_t r = 0; r < depth; ++r) {
+            uint32_t& c = table[cell(hash, r)];
+            c += count;
+            est = std::min(est, c);
+        }
+        return est;
+    }
+
+    uint32_t estimate(uint64_t hash) const {
+        uint32_t est = UINT32_MAX;
+        for (size_t r = 0; r < depth; ++r) {
+            est = std::min(est, table[cell(hash, r)]);
+        }
+        return est;
+    }
+
+    void merge(const CountMinSketch& other) {
+        for (size_t i = 0; i < table.size(); ++i) table[i] += other.table[i];
+    }
+
+    double epsilon() const { return std::exp(1.0) / width; }
+    double confidence() const { return 1.0 - std::exp(-(double)depth); }
+    size_t memory_bytes() const { return table.size() * sizeof(uint32_t); }
+};
+
+// HyperLogLog: стандартная ошибка 1.04 / sqrt(2^precision).
+class HyperLogLog {
+private:
+    int precision;
+    std::vector<uint8_t> registers;
+
+public:
+    HyperLogLog(int p = 14) : precision(p) {
+        registers.assign((size_t)1 << precision, 0);
+    }
+
+    void add(uint64_t hash) {
+        size_t idx = hash >> (64 - precision);
+        uint64_t rest = (hash << precision) | ((uint64_t)1 << (precision - 1));
+        uint8_t rank = 1;
+        while ((rest & 0x8000000000000000ULL) == 0) {
+            rank++;
+            rest <<= 1;
+        }
+        if (rank > registers[idx]) registers[idx] = rank;
+    }
+
+    double estimate() const {
+        double m = (double)registers.size();
+        double sum = 0;
+        size_t zeros = 0;
+        for (uint8_t r : registers) {
+            sum += std::ldexp(1.0, -r);
+            if (r == 0) zeros++;
+        }
+        double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double est = alpha * m * m / sum;
+        if (est <= 2.5 * m && zeros > 0) {
+            est = m * std::log(m / zeros);
+        }
+        return est;
+    }
+
+    void merge(const HyperLogLog& other) {
+        for (size_t i = 0; i < registers.size(); ++i) {
+            registers[i] = std::max(registers[i], other.registers[i]);
+        }
+    }
+
+    double relative_error() const { return 1.04 / std::sqrt((double)registers.size()); }
+    size_t memory_bytes() const { return registers.size(); }
+};
+
+// Top-K самых частых ключей по оценкам Count-Min (min-куча + индекс по хешу).
+class TopK {
+public:
+    struct Item {
+        std::string key;
+        uint64_t hash;
+        uint32_t count;
+    };
+
+private:
+    size_t capacity;
+    std::vector<Item> heap;
+    std::vector<std::vector<uint32_t>> buckets;
+
+    std::vector<uint32_t>& bucket_of(uint64_t hash) {
+        return buckets[hash % buckets.size()];
+    }
+
+    int find(const std::string& key, uint64_t hash) {
+        for (uint32_t pos : bucket_of(hash)) {
+            if (heap[pos].hash == hash && heap[pos].key == key) return (int)pos;
+        }
+        return -1;
+    }
+
+    void relink(uint64_t hash, uint32_t from, uint32_t to) {
+        for (auto& pos : bucket_of(hash)) {
+            if (pos == from) {
+                pos = to;
+                return;
+            }
+        }
+    }
+
+    void swap_items(uint32_t a, uint32_t b) {
+        relink(heap[a].hash, a, UINT32_MAX);
+        relink(heap[b].hash, b, a);
+        relink(heap[a].hash, UINT32_MAX, b);
+        std::swap(heap[a], heap[b]);
+    }
+
+    void sift_up(uint32_t pos) {
+        while (pos > 0) {
+            uint32_t parent = (pos - 1) / 2;
+            if (heap[parent].count <= heap[pos].count) break;
+            swap_items(pos, parent);
+            pos = parent;
+        }
+    }
+
+    void sift_down(uint32_t pos) {
+        while (true) {
+            uint32_t smallest = pos;
+            uint32_t l = 2 * pos + 1, r = 2 * pos + 2;
+            if (l < heap.size() && heap[l].count < heap[smallest].count) smallest = l;
+            if (r < heap.size() && heap[r].count < heap[smallest].count) smallest = r;
+            if (smallest == pos) break;
+            swap_items(pos, smallest);
+            pos = smallest;
+        }
+    }
+
+public:
+    TopK(size_t k = 1000) : capacity(k) {
+        heap.reserve(k);
+        buckets.resize(std::max<size_t>(k * 2, 16));
+    }
+
+    void offer(const std::string& key, uint64_t hash, uint32_t estimate) {
+        // Оценка ключа только растет: если она не выше минимума, ключ уже
+        // хранится с тем же значением либо не попадает в кучу.
+        if (heap.size() == capacity && (capacity == 0 || estimate <= heap[0].count)) return;
+
+        int pos = find(key, hash);
+        if (pos >= 0) {
+            heap[pos].count = estimate;
+            sift_down((uint32_t)pos);
+            return;
+        }
+
+        if (heap.size() == capacity) {
+            uint32_t last = (uint32_t)heap.size() - 1;
+            swap_items(0, last);
+            auto& b = bucket_of(heap[last].hash);
+            b.erase(std::find(b.begin(), b.end(), last));
+            heap.pop_back();
+            sift_down(0);
+        }
+
+        heap.push_back({key, hash, estimate});
+        uint32_t new_pos = (uint32_t)heap.size() - 1;
+        bucket_of(hash).push_back(new_pos);
+        sift_up(new_pos);
+    }
+
+    std::vector<Item> get_sorted_items() const {
+        std::vector<Item> items = heap;
+        std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+            return a.count > b.count;
+        });
+        return items;
+    }
+
+    size_t size() const { return heap.size(); }
+};
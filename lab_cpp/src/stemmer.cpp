@@ -1,55 +1,81 @@
 #include "stemmer.hpp"
-#include <regex>
+#include <initializer_list>
 
-std::string Stemmer::stem(const std::string& word) {
-    std::string rv = word;
-    
-    static const std::regex reflexive("(ся|сь)$");
-    
-    static const std::regex adjective("(ее|ие|ые|ое|ими|ыми|ей|ий|ый|ой|ем|им|ым|ом|его|ого|ому|ему|их|ых|ую|юю|ая|яя|ою|ею)$");
-    
-    static const std::regex participle("((ивш|ывш|ующ)|(ем|нн|вш|ющ|щ))$");
-    
-    static const std::regex verb(
-        "((ила|ыла|ена|ейте|уйте|ите|или|ыли|ей|уй|ил|ыл|им|ым|ен|ило|ыло|ено|ят|ует|уют|ит|ыт|ены|ить|ыть|ишь|ую|ю|"
-        "ала|яла|ела|али|яли|ели|ало|яло|ело|" 
-        "ал|ял|ел)" 
-        ")$");
-    
-    static const std::regex noun("(а|ев|ов|ие|ье|е|иями|ями|ами|еи|ии|и|ией|ей|ой|ий|й|иям|ям|ием|ем|ам|ом|о|у|ах|иях|ях|ы|ь|ию|ью|ю|ия|ья|я)$");
-    
-    static const std::regex superlative("(ейш|ейше)$");
-    static const std::regex i_ending("и$");
-    static const std::regex derivational(".*[^аеиоуыэюя](ост|ость)$");
-
-    auto replace_if_match = [&](const std::regex& re) -> bool {
-            std::smatch match;
-            if (std::regex_search(rv, match, re)) {
-                if (match.position() > 4) { 
-                    rv = std::regex_replace(rv, re, "");
-                    return true;
-                }
-            }
-            return false;
-        };
-
-    replace_if_match(reflexive);
-
-    if (replace_if_match(adjective)) {
-        replace_if_match(participle);
-    } else {
-        if (!replace_if_match(verb)) {
-            replace_if_match(noun);
+namespace {
+    using Suffixes = std::initializer_list<std::string_view>;
+
+    const Suffixes REFLEXIVE = {"ся", "сь"};
+    const Suffixes ADJECTIVE = {"ее", "ие", "ые", "ое", "ими", "ыми", "ей", "ий", "ый", "ой", "ем", "им", "ым", "ом",
+                                "его", "ого", "ому", "ему", "их", "ых", "ую", "юю", "ая", "яя", "ою", "ею"};
+    const Suffixes PARTICIPLE = {"ивш", "ывш", "ующ", "ем", "нн", "вш", "ющ", "щ"};
+    const Suffixes VERB = {"ила", "ыла", "ена", "ейте", "уйте", "ите", "или", "ыли", "ей", "уй", "ил", "ыл", "им", "ым",
+                           "ен", "ило", "ыло", "ено", "ят", "ует", "уют", "ит", "ыт", "ены", "ить", "ыть", "ишь", "ую",
+                           "ю", "ала", "яла", "ела", "али", "яли", "ели", "ало", "яло", "ело", "ал", "ял", "ел"};
+    const Suffixes NOUN = {"а", "ев", "ов", "ие", "ье", "е", "иями", "ями", "ами", "еи", "ии", "и", "ией", "ей", "ой",
+                           "ий", "й", "иям", "ям", "ием", "ем", "ам", "ом", "о", "у", "ах", "иях", "ях", "ы", "ь",
+                           "ию", "ью", "ю", "ия", "ья", "я"};
+    const Suffixes SUPERLATIVE = {"ейш", "ейше"};
+    const Suffixes I_ENDING = {"и"};
+
+    bool ends_with(std::string_view word, std::string_view suffix) {
+        return word.size() >= suffix.size() && word.compare(word.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Отрезает самое длинное из окончаний, если перед ним остается больше 4 байт.
+    // Если самое длинное начинается слишком близко к началу, более короткие не пробуются
+    bool cut(std::string_view& word, const Suffixes& suffixes) {
+        size_t longest = 0;
+        for (std::string_view suffix : suffixes) {
+            if (suffix.size() > longest && ends_with(word, suffix)) longest = suffix.size();
+        }
+        if (longest == 0 || word.size() - longest <= 4) return false;
+        word.remove_suffix(longest);
+        return true;
+    }
+
+    // Байты гласных а, е, и, о, у, ы, э, ю, я в UTF-8: перед "ость" должен стоять байт не из них
+    bool is_vowel_byte(unsigned char c) {
+        switch (c) {
+            case 0xD0: case 0xD1: case 0xB0: case 0xB5: case 0xB8: case 0xBE:
+            case 0x83: case 0x8B: case 0x8D: case 0x8E: case 0x8F:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void cut_derivational(std::string_view& word) {
+        const std::string_view suffix = "ость";
+        if (!ends_with(word, suffix)) return;
+        size_t p = word.size() - suffix.size();
+        if (p == 0 || is_vowel_byte((unsigned char)word[p - 1])) return;
+        for (size_t i = 0; i + 1 < p; ++i) {
+            if (word[i] == '\n' || word[i] == '\r') return;
         }
+        word.remove_suffix(suffix.size());
     }
-    
-    replace_if_match(i_ending);
-    
-    if (std::regex_match(rv, derivational)) {
-         rv = std::regex_replace(rv, std::regex("ость?$"), "");
+}
+
+size_t Stemmer::stem_length(std::string_view word) {
+    std::string_view rv = word;
+
+    cut(rv, REFLEXIVE);
+
+    if (cut(rv, ADJECTIVE)) {
+        cut(rv, PARTICIPLE);
+    } else {
+        if (!cut(rv, VERB)) {
+            cut(rv, NOUN);
+        }
     }
 
-    replace_if_match(superlative);
-    
-    return rv;
-}
\ No newline at end of file
+    cut(rv, I_ENDING);
+    cut_derivational(rv);
+    cut(rv, SUPERLATIVE);
+
+    return rv.size();
+}
+
+std::string Stemmer::stem(const std::string& word) {
+    return word.substr(0, stem_length(word));
+}
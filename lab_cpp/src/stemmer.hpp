@@ -1,8 +1,10 @@
 #pragma once
 #include <string>
-#include <regex>
+#include <string_view>
 
 class Stemmer {
 public:
     static std::string stem(const std::string& word);
-};
\ No newline at end of file
+    // Длина стема: стеммер только отрезает окончания, поэтому стем - префикс слова
+    static size_t stem_length(std::string_view word);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Отображение терм -> плотный id (0, 1, 2, ... в порядке первого появления).
+// Открытая адресация с линейным пробированием.
+class TermInterner {
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::vector<std::string> terms;
+    std::vector<uint32_t> slots;
+    size_t mask;
+
+    size_t get_hash(const std::string& key) const {
+        size_t hash = 5381;
+        for (char c : key) hash = ((hash << 5) + hash) + c;
+        return (hash * 0x9E3779B97F4A7C15ULL) >> 17;
+    }
+
+    void grow() {
+        std::vector<uint32_t> old = std::move(slots);
+        slots.assign(old.size() * 2, EMPTY);
+        mask = slots.size() - 1;
+        for (uint32_t id : old) {
+            if (id == EMPTY) continue;
+            size_t idx = get_hash(terms[id]) & mask;
+            while (slots[idx] != EMPTY) idx = (idx + 1) & mask;
+            slots[idx] = id;
+        }
+    }
+
+public:
+    TermInterner(size_t capacity = 1 << 16) {
+        size_t size = 16;
+        while (size < capacity * 2) size <<= 1;
+        slots.assign(size, EMPTY);
+        mask = size - 1;
+        terms.reserve(capacity);
+    }
+
+    uint32_t intern(const std::string& term) {
+        size_t idx = get_hash(term) & mask;
+        while (slots[idx] != EMPTY) {
+            if (terms[slots[idx]] == term) return slots[idx];
+            idx = (idx + 1) & mask;
+        }
+
+        uint32_t id = (uint32_t)terms.size();
+        terms.push_back(term);
+        slots[idx] = id;
+        if (terms.size() * 10 > slots.size() * 7) grow();
+        return id;
+    }
+
+    const std::string& term(uint32_t id) const { return terms[id]; }
+    const std::vector<std::string>& all_terms() const { return terms; }
+    size_t size() const { return terms.size(); }
+};
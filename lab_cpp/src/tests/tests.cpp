@@ -1,11 +1,42 @@
 #include "test_runner.hpp"
 #include "../custom_map.hpp"
+#include "../sketches.hpp"
+#include "../term_interner.hpp"
+#include "../radix_sort.hpp"
 #include "../tokenizer.hpp"
 #include "../stemmer.hpp"
 #include "../query_parser.hpp"
 #include "../search_engine.hpp" 
+#include "../broker.hpp"
+#include "../lz_codec.hpp"
+#include "../doc_store.hpp"
+#include "../set_ops.hpp"
+#include "../postings_codecs.hpp"
+#include "../doc_reorder.hpp"
+#include "../near_duplicates.hpp"
+#include "../impact_index.hpp"
+#include "../trigram_index.hpp"
+#include "../completion_index.hpp"
+#include "../packed_corpus.hpp"
+#include "../index_checkpoint.hpp"
+#include "../fuzzy_matcher.hpp"
+#include "../thread_pool.hpp"
+#include "../latency_histogram.hpp"
+#include "../query_arena.hpp"
+#include "../alloc_counter.hpp"
+#include "../indexer.hpp"
+#include <atomic>
+#include <thread>
 #include <algorithm>
 #include <set>
+#include <random>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <regex>
+#include <optional>
 
 
 void TestCustomMapStress() {
@@ -31,6 +62,61 @@ void TestCustomMapStress() {
 }
 
 
+void TestSketches() {
+    CountMinSketch cms(1024, 4);
+    HyperLogLog hll(12);
+    TopK top(5);
+    
+    for (int i = 0; i < 5000; ++i) {
+        std::string key = "k" + std::to_string(i % 1000);
+        uint64_t h = hash64(key);
+        top.offer(key, h, cms.add(h));
+        hll.add(h);
+    }
+    for (int rep = 0; rep < 100; ++rep) {
+        uint64_t h = hash64("hot");
+        top.offer("hot", h, cms.add(h));
+    }
+    
+    uint32_t est = cms.estimate(hash64("k7"));
+    Assert(est >= 5, "Count-Min never underestimates");
+    Assert(est <= 5 + cms.epsilon() * 5100 * 2, "Count-Min error bound");
+    
+    double unique = hll.estimate();
+    Assert(unique > 1001 * 0.9 && unique < 1001 * 1.1, "HLL estimate within 10%");
+    
+    auto items = top.get_sorted_items();
+    AssertEqual((int)items.size(), 5, "TopK keeps K items");
+    AssertEqual(items[0].key, "hot", "TopK heavy hitter first");
+}
+
+
+void TestInternAndRadixSort() {
+    TermInterner interner(4);
+    for (int i = 0; i < 1000; ++i) {
+        AssertEqual((int)interner.intern("term_" + std::to_string(i)), i, "Dense ids in first-seen order");
+    }
+    AssertEqual((int)interner.intern("term_42"), 42, "Repeated term keeps its id");
+    AssertEqual(interner.term(999), "term_999", "Reverse lookup");
+    
+    struct Pair { uint32_t key; uint32_t seq; };
+    std::vector<Pair> items;
+    uint32_t x = 12345;
+    for (uint32_t i = 0; i < 200000; ++i) {
+        x = x * 1103515245 + 12345;
+        items.push_back({(x >> 8) % 70000, i});
+    }
+    auto expected = items;
+    std::stable_sort(expected.begin(), expected.end(), [](const Pair& a, const Pair& b) { return a.key < b.key; });
+    RadixSort::sort_by_key(items, 69999, [](const Pair& p) { return p.key; }, 3);
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].key != expected[i].key || items[i].seq != expected[i].seq) {
+            throw std::runtime_error("Radix sort mismatch at " + std::to_string(i));
+        }
+    }
+}
+
+
 void TestStemmerExtended() {
     AssertEqual(Stemmer::stem("бегал"), "бег", "Verb 'al' removal");
     AssertEqual(Stemmer::stem("смотрела"), "смотр", "Verb 'la/ela' removal"); 
@@ -47,6 +133,70 @@ void TestStemmerExtended() {
 }
 
 
+// Прежний стеммер на регулярных выражениях - эталон для сравнения
+std::string ReferenceStem(const std::string& word) {
+    std::string rv = word;
+    static const std::regex reflexive("(ся|сь)$");
+    static const std::regex adjective("(ее|ие|ые|ое|ими|ыми|ей|ий|ый|ой|ем|им|ым|ом|его|ого|ому|ему|их|ых|ую|юю|ая|яя|ою|ею)$");
+    static const std::regex participle("((ивш|ывш|ующ)|(ем|нн|вш|ющ|щ))$");
+    static const std::regex verb(
+        "((ила|ыла|ена|ейте|уйте|ите|или|ыли|ей|уй|ил|ыл|им|ым|ен|ило|ыло|ено|ят|ует|уют|ит|ыт|ены|ить|ыть|ишь|ую|ю|"
+        "ала|яла|ела|али|яли|ели|ало|яло|ело|ал|ял|ел))$");
+    static const std::regex noun("(а|ев|ов|ие|ье|е|иями|ями|ами|еи|ии|и|ией|ей|ой|ий|й|иям|ям|ием|ем|ам|ом|о|у|ах|иях|ях|ы|ь|ию|ью|ю|ия|ья|я)$");
+    static const std::regex superlative("(ейш|ейше)$");
+    static const std::regex i_ending("и$");
+    static const std::regex derivational(".*[^аеиоуыэюя](ост|ость)$");
+
+    auto replace_if_match = [&](const std::regex& re) {
+        std::smatch match;
+        if (std::regex_search(rv, match, re) && match.position() > 4) {
+            rv = std::regex_replace(rv, re, "");
+            return true;
+        }
+        return false;
+    };
+    replace_if_match(reflexive);
+    if (replace_if_match(adjective)) replace_if_match(participle);
+    else if (!replace_if_match(verb)) replace_if_match(noun);
+    replace_if_match(i_ending);
+    if (std::regex_match(rv, derivational)) rv = std::regex_replace(rv, std::regex("ость?$"), "");
+    replace_if_match(superlative);
+    return rv;
+}
+
+void TestStemmerMatchesRegex() {
+    // Основы разной длины с каждым окончанием всех шагов, с возвратными частицами и без
+    const char* bases[] = {"", "к", "дом", "стол", "красн", "радост", "говор", "нов", "быстр", "ост"};
+    const char* suffixes[] = {"ся", "сь", "ее", "ие", "ые", "ое", "ими", "ыми", "ей", "ий", "ый", "ой", "ем", "им",
+        "ым", "ом", "его", "ого", "ому", "ему", "их", "ых", "ую", "юю", "ая", "яя", "ою", "ею", "ивш", "ывш", "ующ",
+        "нн", "вш", "ющ", "щ", "ила", "ыла", "ена", "ейте", "уйте", "ите", "или", "ыли", "уй", "ил", "ыл", "ен",
+        "ило", "ыло", "ено", "ят", "ует", "уют", "ит", "ыт", "ены", "ить", "ыть", "ишь", "ю", "ала", "яла", "ела",
+        "али", "яли", "ели", "ало", "яло", "ело", "ал", "ял", "ел", "а", "ев", "ов", "ье", "е", "иями", "ями", "ами",
+        "еи", "ии", "и", "ией", "й", "иям", "ям", "ием", "ам", "о", "у", "ах", "иях", "ях", "ы", "ь", "ию", "ью",
+        "ия", "ья", "я", "ейш", "ейше", "ость", "ост", "ейшего", "остью", ""};
+    std::vector<std::string> words;
+    for (const char* base : bases) {
+        for (const char* a : suffixes) {
+            for (const char* b : {"", "ся", "сь", "и", "ость"}) words.push_back(std::string(base) + a + b);
+        }
+    }
+    std::mt19937 rng(7);
+    const char* letters[] = {"а", "в", "е", "и", "й", "л", "м", "н", "о", "с", "т", "у", "ш", "щ", "ы", "ь", "ю", "я", "x"};
+    for (int i = 0; i < 20000; ++i) {
+        std::string w;
+        for (int n = rng() % 12; n > 0; --n) w += letters[rng() % 19];
+        words.push_back(w);
+    }
+
+    size_t mismatches = 0;
+    for (const auto& w : words) {
+        std::string expected = ReferenceStem(w);
+        if (Stemmer::stem(w) != expected || Stemmer::stem_length(w) != expected.size()) mismatches++;
+    }
+    AssertEqual(mismatches, (size_t)0, "Suffix stemmer matches regex stemmer");
+}
+
+
 void TestBooleanLogic() {
     std::vector<uint32_t> docs_a = {1, 5, 10, 20};
     std::vector<uint32_t> docs_b = {5, 8, 10, 100};
@@ -71,7 +221,978 @@ void TestBooleanLogic() {
 }
 
 
-std::string RpnToString(const std::vector<Token>& rpn) {
+void TestSetOperations() {
+    // Каждое доступное ядро: случаи TestBooleanLogic и сравнение со std::set_* на случайных списках
+    // разной длины, плотности и соотношения длин (в том числе крайние значения doc_id)
+    std::vector<SetOps::Kernel> kernels = {SetOps::Kernel::SCALAR};
+    if (SetOps::best_kernel() >= SetOps::Kernel::SSE42) kernels.push_back(SetOps::Kernel::SSE42);
+    if (SetOps::best_kernel() >= SetOps::Kernel::AVX2) kernels.push_back(SetOps::Kernel::AVX2);
+
+    std::mt19937 rng(7);
+    auto random_list = [&rng](size_t size, uint32_t universe) {
+        std::vector<uint32_t> list;
+        std::uniform_int_distribution<uint32_t> pick(0, universe);
+        for (size_t i = 0; i < size; ++i) list.push_back(pick(rng));
+        if (size > 0 && rng() % 4 == 0) list.push_back(UINT32_MAX);
+        if (size > 0 && rng() % 4 == 0) list.push_back(0);
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        return list;
+    };
+
+    for (SetOps::Kernel kernel : kernels) {
+        SetOps::set_kernel(kernel);
+        const std::string name = SetOps::kernel_name(kernel);
+        TestBooleanLogic();
+
+        for (int round = 0; round < 3000; ++round) {
+            size_t na = rng() % 300, nb = rng() % 300;
+            if (round % 5 == 0) nb = na * (2 + rng() % 100);
+            uint32_t universe = round % 3 == 0 ? 400 : (round % 3 == 1 ? 5000 : UINT32_MAX - 1);
+            auto a = random_list(na, universe);
+            auto b = random_list(nb, universe);
+            if (round % 2) a.swap(b);
+
+            std::vector<uint32_t> expected;
+            std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+            if (SearchEngine::intersect_postings(a, b) != expected) {
+                throw std::runtime_error("AND differs from std::set_intersection (" + name + ")");
+            }
+            expected.clear();
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+            if (SearchEngine::union_postings(a, b) != expected) {
+                throw std::runtime_error("OR differs from std::set_union (" + name + ")");
+            }
+            expected.clear();
+            std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+            if (SearchEngine::difference_postings(a, b) != expected) {
+                throw std::runtime_error("NOT differs from std::set_difference (" + name + ")");
+            }
+        }
+    }
+    SetOps::set_kernel(SetOps::best_kernel());
+}
+
+void TestDocStore() {
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        text += "налог на доход " + std::to_string(i % 37) + "; ";
+    }
+    std::string packed = LzCodec::compress(text.data(), text.size());
+    Assert(packed.size() < text.size() / 2, "LZ compresses repetitive text");
+    std::string restored(text.size(), '\0');
+    LzCodec::decompress(packed.data(), packed.size(), &restored[0], restored.size());
+    AssertEqual(restored == text, true, "LZ round trip");
+    
+    std::string tiny = "abc";
+    packed = LzCodec::compress(tiny.data(), tiny.size());
+    restored.assign(tiny.size(), '\0');
+    LzCodec::decompress(packed.data(), packed.size(), &restored[0], restored.size());
+    AssertEqual(restored, tiny, "LZ round trip on short input");
+    
+    const std::string path = "test_docs_store.bin";
+    std::vector<std::string> docs;
+    {
+        DocStoreWriter writer(path, 1024);
+        for (int i = 0; i < 300; ++i) {
+            docs.push_back("Заголовок " + std::to_string(i) + "\n" + text.substr(i * 7, 50 + i));
+            writer.add(docs.back());
+        }
+        writer.finish();
+    }
+    DocStore store(2);
+    store.open(path);
+    AssertEqual((int)store.size(), 300, "Doc store size");
+    for (int i : {0, 299, 150, 1, 151, 0}) {
+        AssertEqual(store.get_document(i) == docs[i], true, "Doc store random access " + std::to_string(i));
+    }
+
+    // Поврежденные таблицы отклоняются при открытии, поврежденный блок - при чтении
+    std::ifstream in(path, std::ios::binary);
+    std::string original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    auto rejected = [&](const std::string& bytes, bool on_read) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+        try {
+            DocStore damaged;
+            damaged.open(path);
+            if (!on_read) return false;
+            damaged.get_document(0);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what()).find("Corrupted doc store") != std::string::npos;
+        }
+        return false;
+    };
+    Assert(rejected(original.substr(0, original.size() - 4), false), "Truncated doc store rejected");
+    std::string bad_length = original;
+    uint64_t tables_offset;
+    std::memcpy(&tables_offset, bad_length.data() + bad_length.size() - 8, 8);
+    uint32_t blocks;
+    std::memcpy(&blocks, bad_length.data() + tables_offset, 4);
+    uint32_t huge = 1u << 30;
+    std::memcpy(&bad_length[tables_offset + 4 + blocks * 16 + 4 + 8], &huge, 4);
+    Assert(rejected(bad_length, false), "Document past its block rejected");
+    std::string bad_block = original;
+    std::fill(bad_block.begin() + 9, bad_block.begin() + 9 + 64, '\xFF');
+    Assert(rejected(bad_block, true), "Damaged block rejected on read");
+    std::remove(path.c_str());
+}
+
+
+void TestPostingsCodecs() {
+    // gaps: 1, 1, 2, 127, 170
+    std::vector<uint32_t> docs = {0, 1, 3, 130, 300};
+    AssertEqual(PostingsCodecs::vbyte_bytes(docs), (uint64_t)6, "VByte: 7-bit gaps take 1 byte, 8-bit gap 2 bytes");
+    AssertEqual(PostingsCodecs::gamma_bits(docs.data(), 4), (uint64_t)(1 + 1 + 3 + 13), "Elias-gamma bits");
+    AssertEqual(PostingsCodecs::delta_bits(docs.data(), 4), (uint64_t)(1 + 1 + 4 + 11), "Elias-delta bits");
+    AssertEqual(PostingsCodecs::bitpacking128_bytes(docs.data(), docs.size()), (uint64_t)(1 + (5 * 8 + 7) / 8),
+                "BP128: one partial block at max gap width");
+    
+    std::vector<uint32_t> dense(256);
+    for (uint32_t i = 0; i < dense.size(); ++i) dense[i] = i;
+    AssertEqual(PostingsCodecs::bitpacking128_bytes(dense.data(), dense.size()), (uint64_t)(2 * (1 + 16)),
+                "BP128: two full 1-bit blocks");
+}
+
+void TestBitpackingFirstApart() {
+    // Первый doc_id отдельно: 300 - два байта VByte, gaps 1, 1, 128 - блок шириной 8 бит
+    std::vector<uint32_t> docs = {300, 301, 302, 430};
+    AssertEqual(PostingsCodecs::bitpacking128_first_apart_bytes(docs.data(), docs.size()), (uint64_t)(2 + 1 + (3 * 8 + 7) / 8),
+                "First doc_id apart, one partial block of gaps");
+    AssertEqual(PostingsCodecs::bitpacking128_bytes(docs.data(), docs.size()), (uint64_t)(1 + (4 * 9 + 7) / 8),
+                "Plain BP128: first doc_id widens the block");
+
+    std::vector<uint32_t> dense(256);
+    for (uint32_t i = 0; i < dense.size(); ++i) dense[i] = i;
+    AssertEqual(PostingsCodecs::bitpacking128_first_apart_bytes(dense.data(), dense.size()), (uint64_t)(1 + 2 * (1 + 16)),
+                "First doc_id 0 takes a byte, then full and partial 1-bit blocks");
+    AssertEqual(PostingsCodecs::bitpacking128_first_apart_bytes(dense.data(), 1), (uint64_t)1, "Single doc_id");
+    AssertEqual(PostingsCodecs::bitpacking128_first_apart_bytes(dense.data(), 0), (uint64_t)0, "Empty list");
+}
+
+void TestDocReorder() {
+    // 16 тем вперемешку: документ берет 15 термов своей темы и 5 случайных общих
+    std::mt19937 rng(7);
+    std::vector<std::vector<uint32_t>> doc_terms(2048);
+    for (auto& terms : doc_terms) {
+        uint32_t topic = rng() % 16;
+        std::set<uint32_t> unique;
+        while (unique.size() < 15) unique.insert(topic * 50 + rng() % 50);
+        while (unique.size() < 20) unique.insert(800 + rng() % 2000);
+        terms.assign(unique.begin(), unique.end());
+    }
+    
+    auto baseline = DocReorder::evaluate(doc_terms, 2800, {});
+    for (DocOrder order : {DocOrder::MINHASH, DocOrder::BP}) {
+        auto new_to_old = order == DocOrder::BP ? DocReorder::bp_order(doc_terms, 2800)
+                                                : DocReorder::minhash_order(doc_terms);
+        std::vector<uint32_t> sorted = new_to_old;
+        std::sort(sorted.begin(), sorted.end());
+        for (uint32_t k = 0; k < sorted.size(); ++k) AssertEqual(sorted[k], k, "Order is a permutation");
+        
+        if (order == DocOrder::BP) {
+            auto reordered = DocReorder::evaluate(doc_terms, 2800, new_to_old);
+            Assert(reordered.bp128_bytes < baseline.bp128_bytes * 0.95, "Bisection shrinks bit-packed postings");
+        }
+    }
+}
+
+void TestNearDuplicates() {
+    // Документ из 400 случайных термов, его копия с 4 замененными термами и независимый документ
+    std::mt19937 rng(11);
+    std::vector<uint32_t> original(400), edited, other(400);
+    for (auto& t : original) t = rng() % 5000;
+    for (auto& t : other) t = rng() % 5000;
+    edited = original;
+    for (int i = 0; i < 4; ++i) edited[rng() % edited.size()] = 5000 + i;
+
+    auto signature = [](const std::vector<uint32_t>& terms) {
+        SimHashBuilder builder;
+        for (uint32_t t : terms) builder.add_token(t);
+        return builder.finish();
+    };
+    uint64_t a = signature(original), b = signature(edited), c = signature(other);
+    AssertEqual(signature(original), a, "Builder is reset after finish");
+    Assert(NearDuplicateIndex::hamming_distance(a, b) <= 6, "Small edit keeps signatures close");
+    Assert(NearDuplicateIndex::hamming_distance(a, c) > 12, "Unrelated documents are far apart");
+
+    NearDuplicateIndex index(6);
+    AssertEqual(index.find(a), (int64_t)-1, "Empty index finds nothing");
+    index.add(a, 0);
+    index.add(c, 1);
+    AssertEqual(index.find(b), (int64_t)0, "Edited copy maps to the original");
+    AssertEqual(index.find(c ^ 0x8000000000000001ULL), (int64_t)1, "Two flipped bits are within distance");
+    AssertEqual(index.find(~a), (int64_t)-1, "Inverted signature is not a duplicate");
+}
+
+void TestImpactTopK() {
+    // Термы с разной длиной постингов; у немногих документов большой impact, у остальных - малый
+    struct Term {
+        std::vector<uint32_t> docs, head_docs;
+        std::vector<uint8_t> impacts, head_impacts;
+        uint8_t tail_max = 0;
+    };
+    std::mt19937 rng(5);
+    std::vector<Term> terms(3);
+    for (size_t t = 0; t < terms.size(); ++t) {
+        std::set<uint32_t> docs;
+        while (docs.size() < 500 + 1500 * t) docs.insert(rng() % 20000);
+        terms[t].docs.assign(docs.begin(), docs.end());
+        for (size_t i = 0; i < docs.size(); ++i) terms[t].impacts.push_back(rng() % 50 == 0 ? 150 + rng() % 100 : 1 + rng() % 40);
+
+        std::vector<uint32_t> order(docs.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t a, uint32_t b) { return terms[t].impacts[a] > terms[t].impacts[b]; });
+        uint32_t head = ImpactIndex::head_size((uint32_t)order.size());
+        if (head < order.size()) terms[t].tail_max = terms[t].impacts[order[head]];
+        order.resize(head);
+        std::sort(order.begin(), order.end());
+        for (uint32_t i : order) {
+            terms[t].head_docs.push_back(terms[t].docs[i]);
+            terms[t].head_impacts.push_back(terms[t].impacts[i]);
+        }
+    }
+    auto cursor = [](const Term& t) {
+        return ImpactIndex::Cursor{t.docs.data(), t.impacts.data(), (uint32_t)t.docs.size(), t.head_docs.data(),
+                                   t.head_impacts.data(), (uint32_t)t.head_docs.size(), t.tail_max};
+    };
+
+    std::vector<std::vector<ImpactIndex::Cursor>> queries = {
+        {cursor(terms[0])}, {cursor(terms[2])}, {cursor(terms[0]), cursor(terms[1])},
+        {cursor(terms[0]), cursor(terms[1]), cursor(terms[2])}
+    };
+    bool any_early = false;
+    for (const auto& q : queries) {
+        for (size_t k : {1, 10, 100, 5000}) {
+            ImpactIndex::TopKStats stats;
+            auto fast = ImpactIndex::top_k(q, k, &stats);
+            auto full = ImpactIndex::top_k_exhaustive(q, k);
+            AssertEqual(fast.size(), full.size(), "Top-k size");
+            for (size_t i = 0; i < fast.size(); ++i) {
+                AssertEqual(fast[i].doc_id, full[i].doc_id, "Same top-k documents");
+                AssertEqual(fast[i].score, full[i].score, "Same top-k scores");
+            }
+            if (stats.early_terminated) {
+                any_early = true;
+                Assert(stats.postings_scored < stats.postings_total, "Early termination skips tails");
+            }
+        }
+    }
+    Assert(any_early, "Skewed impacts allow early termination");
+}
+
+void TestTrigramIndex() {
+    std::vector<std::pair<std::string, uint32_t>> words = {
+        {"налоговый", 0}, {"налог", 0}, {"налоговик", 1}, {"логистика", 2}, {"x86_64", 3},
+        {"ab", 4}, {"a", 5}, {"суд", 6}, {"судья", 7}, {"пересуды", 6}
+    };
+    const std::string path = "test_trigram_index.bin";
+    TrigramIndex::write(path, words);
+    TrigramIndex index;
+    index.open(path);
+    AssertEqual(index.word_count(), (uint32_t)words.size(), "Trigram index word count");
+
+    // Ответ сравнивается с перебором словоформ
+    for (const std::string sub : {"логов", "лог", "ло", "л", "суд", "уд", "86_", "_6", "b", "a", "ab", "abc", "z", "налоговый"}) {
+        std::set<uint32_t> expected;
+        for (const auto& w : words) {
+            if (w.first.find(sub) != std::string::npos) expected.insert(w.second);
+        }
+        auto found = index.find_terms(sub);
+        AssertEqual(std::set<uint32_t>(found.begin(), found.end()) == expected, true, "Substring " + sub);
+        AssertEqual(found.size(), expected.size(), "No duplicate terms for " + sub);
+    }
+    index.close();
+    std::remove(path.c_str());
+}
+
+void TestCompletionIndex() {
+    std::vector<std::pair<std::string, uint32_t>> words = {
+        {"налог", 50}, {"налоговый", 30}, {"налоговик", 30}, {"наличие", 70}, {"на", 900},
+        {"москва", 40}, {"московский", 45}, {"мост", 5}, {"м", 1}, {"суд", 12}, {"судья", 12}
+    };
+    for (int i = 0; i < 40; ++i) words.push_back({"нал" + std::to_string(i), (uint32_t)i});
+    const std::string path = "test_completion.bin";
+    CompletionIndex::write(path, words);
+    CompletionIndex index;
+    index.open(path);
+    AssertEqual(index.word_count(), (uint32_t)words.size(), "Completion word count");
+
+    // Ответ сравнивается с сортировкой всех словоформ с префиксом
+    for (const std::string prefix : {"", "н", "на", "нал", "нало", "налоговы", "мос", "м", "суд", "x", "налогх", "нал3"}) {
+        std::vector<std::pair<std::string, uint32_t>> expected;
+        for (const auto& w : words) {
+            if (w.first.compare(0, prefix.size(), prefix) == 0) expected.push_back(w);
+        }
+        std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) {
+            if (a.second != b.second) return a.second > b.second;
+            return a.first < b.first;
+        });
+        if (expected.size() > CompletionIndex::TOP_K) expected.resize(CompletionIndex::TOP_K);
+
+        auto found = index.complete(prefix, CompletionIndex::TOP_K);
+        AssertEqual(found.size(), expected.size(), "Suggestion count for '" + prefix + "'");
+        for (size_t i = 0; i < found.size() && i < expected.size(); ++i) {
+            AssertEqual(found[i].word, expected[i].first, "Suggestion order for '" + prefix + "'");
+            AssertEqual(found[i].doc_freq, expected[i].second, "Suggestion doc_freq");
+        }
+    }
+    AssertEqual(index.complete("на", 3).size(), (size_t)3, "Suggestions limited by k");
+    index.close();
+    std::remove(path.c_str());
+}
+
+void TestPackedCorpus() {
+    std::vector<PackedCorpus::Record> records = {
+        {"Налоговый кодекс", "https://example.ru/1", "Статья 1.\nНалоги и сборы."},
+        {"", "", ""},
+        {"Без URL", "", std::string("бинарные\0данные", 29)},
+        {"Последний", "https://example.ru/3", std::string(100000, 'x')}
+    };
+    const std::string path = "test_corpus.pack";
+    PackedCorpus::write(path, records);
+    AssertEqual(PackedCorpus::is_packed(path), true, "Packed corpus signature");
+
+    PackedCorpus corpus;
+    corpus.open(path);
+    AssertEqual(corpus.size(), (uint32_t)records.size(), "Packed corpus size");
+    for (uint32_t i = 0; i < records.size(); ++i) {
+        auto doc = corpus.document(i);
+        AssertEqual(std::string(doc.title), records[i].title, "Packed title");
+        AssertEqual(std::string(doc.url), records[i].url, "Packed url");
+        AssertEqual(std::string(doc.body), records[i].body, "Packed body");
+        AssertEqual(corpus.text(i), records[i].title + "\n" + records[i].body, "Packed text = title + body");
+    }
+    corpus.close();
+
+    // Обрезанный файл: таблица смещений за концом
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    bool rejected = false;
+    try {
+        corpus.open(path);
+    } catch (const std::exception&) {
+        rejected = true;
+    }
+    Assert(rejected, "Truncated packed corpus rejected");
+    std::remove(path.c_str());
+}
+
+void TestCheckpointResume() {
+    // Сканирование 30 документов с точками после 10 и 20; "падение" на 25-м, продолжение с 20-го
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "test_checkpoint";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    const std::string store_path = (root / "store.bin").string();
+    const std::string reference_path = (root / "reference.bin").string();
+    auto text_of = [](uint32_t d) { return "Документ " + std::to_string(d) + "\nтекст " + std::string(d * 13, 'a'); };
+    auto scan = [&](ShardBuildState& state, DocStoreWriter& store, uint32_t d) {
+        DocMeta meta;
+        meta.id = d;
+        meta.title = "Документ " + std::to_string(d);
+        meta.length = d + 1;
+        state.docs.push_back(meta);
+        state.file_of_doc.push_back(d + 100);
+        state.doc_cluster.push_back(d / 2 * 2);
+        uint32_t term = state.vocabulary.intern("терм" + std::to_string(d % 7));
+        state.entries.push_back({term, d});
+        state.entry_tf.push_back((uint16_t)(d % 5 + 1));
+        uint32_t word = state.surface_words.intern("слово" + std::to_string(d % 11));
+        if (word == state.word_term.size()) {
+            state.word_term.push_back(term);
+            state.word_df.push_back(0);
+        }
+        state.word_df[word]++;
+        if (d % 2 == 0) state.representatives.push_back({0x9E3779B97F4A7C15ULL * (d + 1), d});
+        state.text_bytes += text_of(d).size();
+        state.next_doc_id = d + 1;
+        state.next_file = d + 1;
+        store.add(text_of(d));
+    };
+
+    {
+        DocStoreWriter reference(reference_path, 256);
+        for (uint32_t d = 0; d < 30; ++d) reference.add(text_of(d));
+        reference.finish();
+    }
+    ShardBuildState expected;
+    {
+        IndexCheckpoint checkpoint((root / "checkpoint").string(), 42);
+        checkpoint.start();
+        ShardBuildState state;
+        DocStoreWriter store(store_path, 256);
+        for (uint32_t d = 0; d < 25; ++d) {
+            if (d == 10 || d == 20) checkpoint.save(state, store);
+            if (d == 20) expected = state;
+            scan(state, store, d);
+        }
+        // Файлы брошены недописанными, как при kill
+    }
+
+    bool mismatch = false;
+    try {
+        IndexCheckpoint((root / "checkpoint").string(), 43).summary();
+    } catch (const std::exception&) {
+        mismatch = true;
+    }
+    Assert(mismatch, "Checkpoint of another build rejected");
+
+    IndexCheckpoint checkpoint((root / "checkpoint").string(), 42);
+    AssertEqual(checkpoint.summary().finished, false, "Checkpoint not finished");
+    AssertEqual(checkpoint.summary().docs, (uint64_t)20, "Checkpoint doc count");
+    ShardBuildState state;
+    DocStoreWriter store(store_path, 256, true);
+    checkpoint.load(state, store);
+    AssertEqual(state.next_file, (size_t)20, "Resume position");
+    AssertEqual(state.next_doc_id, 20u, "Resume doc id");
+    AssertEqual(state.text_bytes, expected.text_bytes, "Resumed text bytes");
+    AssertEqual(state.docs.size(), expected.docs.size(), "Resumed docs");
+    AssertEqual(state.docs[13].title, expected.docs[13].title, "Resumed title");
+    AssertEqual(state.docs[13].length, expected.docs[13].length, "Resumed doc length");
+    AssertEqual(state.file_of_doc == expected.file_of_doc, true, "Resumed file numbers");
+    AssertEqual(state.doc_cluster == expected.doc_cluster, true, "Resumed clusters");
+    AssertEqual(state.entries.size(), expected.entries.size(), "Resumed entries");
+    AssertEqual(state.entries[17].doc_id, expected.entries[17].doc_id, "Resumed entry");
+    AssertEqual(state.entry_tf == expected.entry_tf, true, "Resumed tf");
+    AssertEqual(state.vocabulary.all_terms() == expected.vocabulary.all_terms(), true, "Resumed vocabulary");
+    AssertEqual(state.vocabulary.intern("терм3"), expected.vocabulary.intern("терм3"), "Resumed term ids");
+    AssertEqual(state.surface_words.all_terms() == expected.surface_words.all_terms(), true, "Resumed words");
+    AssertEqual(state.word_df == expected.word_df, true, "Resumed word df");
+    AssertEqual(state.representatives == expected.representatives, true, "Resumed representatives");
+
+    // Хранилище продолжается с той же границы блока: файл совпадает с записанным без перерыва
+    for (uint32_t d = 20; d < 30; ++d) scan(state, store, d);
+    store.finish();
+    std::ifstream a(store_path, std::ios::binary), b(reference_path, std::ios::binary);
+    std::string resumed_bytes((std::istreambuf_iterator<char>(a)), std::istreambuf_iterator<char>());
+    std::string reference_bytes((std::istreambuf_iterator<char>(b)), std::istreambuf_iterator<char>());
+    AssertEqual(resumed_bytes == reference_bytes, true, "Resumed doc store identical");
+
+    IndexCheckpoint::Summary summary;
+    summary.docs = 30;
+    checkpoint.finish(summary);
+    AssertEqual(checkpoint.summary().finished, true, "Finished checkpoint");
+    AssertEqual(fs::exists(root / "checkpoint" / "entries.bin"), false, "Runs removed after finish");
+    fs::remove_all(root);
+}
+
+// Пока жив, глушит вывод индексатора и загрузки; восстанавливает потоки и при падении проверки
+class QuietOutput {
+public:
+    QuietOutput() : saved_out(std::cout.rdbuf(quiet.rdbuf())), saved_err(std::cerr.rdbuf(quiet.rdbuf())) {}
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+    QuietOutput(const QuietOutput&) = delete;
+    QuietOutput& operator=(const QuietOutput&) = delete;
+
+private:
+    std::ostringstream quiet;
+    std::streambuf* saved_out;
+    std::streambuf* saved_err;
+};
+
+// Тексты документов: write(out, i) пишет i-й документ, первая строка - заголовок
+template <class Writer>
+std::vector<std::string> MakeTexts(uint32_t count, Writer write) {
+    std::vector<std::string> texts;
+    for (uint32_t i = 0; i < count; ++i) {
+        std::ostringstream out;
+        write(out, i);
+        texts.push_back(out.str());
+    }
+    return texts;
+}
+
+// Временный каталог теста с корпусами doc000.txt, doc001.txt, ... и индексами по ним; удаляется в деструкторе
+class TestIndexDir {
+public:
+    explicit TestIndexDir(const std::string& name) : root(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+    }
+    ~TestIndexDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(root, ec);
+    }
+    TestIndexDir(const TestIndexDir&) = delete;
+    TestIndexDir& operator=(const TestIndexDir&) = delete;
+
+    std::string path(const std::string& name) const { return (root / name).string(); }
+
+    std::string write_corpus(const std::vector<std::string>& texts, const std::string& corpus = "corpus") const {
+        std::filesystem::create_directories(root / corpus);
+        for (size_t i = 0; i < texts.size(); ++i) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "doc%03u.txt", (unsigned)i);
+            std::ofstream out(root / corpus / name);
+            out << texts[i];
+        }
+        return path(corpus);
+    }
+
+    std::string build_index(const std::string& index, const IndexerOptions& options = IndexerOptions(),
+                            const std::string& corpus = "corpus") const {
+        QuietOutput quiet;
+        Indexer(options).build_index(path(corpus), path(index));
+        return path(index);
+    }
+
+private:
+    std::filesystem::path root;
+};
+
+void TestShardedSearch() {
+    // Один корпус как 1 и как 3 шарда: глобальные id, заголовки и счетчики должны совпасть
+    const uint32_t DOCS = 90;
+    TestIndexDir dir("test_sharded_search");
+    dir.write_corpus(MakeTexts(DOCS, [](std::ostream& out, uint32_t i) {
+        out << "Документ " << i << "\nобщий текст" << (i % 7 == 0 ? " редкий" : "") << (i % 3 == 1 ? " частый" : "")
+            << (i >= 60 ? " поздний" : "");
+        for (uint32_t w = 0; w < i % 5; ++w) out << " общий";
+        out << "\n";
+    }));
+    IndexerOptions options;
+    options.impacts = true;
+    std::string single_dir = dir.build_index("single", options);
+    options.shards = 3;
+    std::string sharded_dir = dir.build_index("sharded", options);
+    ShardBroker single, sharded;
+    {
+        QuietOutput quiet;
+        single.load_index(single_dir);
+        sharded.load_index(sharded_dir);
+    }
+
+    AssertEqual(sharded.shard_count(), (size_t)3, "Sharded index has 3 shards");
+    AssertEqual(sharded.get_total_docs(), single.get_total_docs(), "Same total docs");
+    for (const std::string query : {"общий", "редкий", "редкий || частый", "общий && !частый", "~редкй", "нет"}) {
+        QueryStatus single_status, sharded_status;
+        auto expected = single.search(query, &single_status);
+        auto found = sharded.search(query, &sharded_status);
+        AssertEqual(found.size(), expected.size(), "Same result count for '" + query + "'");
+        for (size_t i = 0; i < found.size() && i < expected.size(); ++i) {
+            AssertEqual(found[i].doc_id, expected[i].doc_id, "Same global id for '" + query + "'");
+            AssertEqual(found[i].title, expected[i].title, "Title of global id");
+        }
+        AssertEqual(sharded_status.docs_covered, DOCS, "Complete answer covers all shards");
+        AssertEqual(sharded_status.postings_touched, single_status.postings_touched, "Postings summed over shards");
+        AssertEqual(sharded.search_ids(query) == single.search_ids(query), true, "Same ids for '" + query + "'");
+
+        // BM25 считается по статистике шарда, поэтому сравниваются множества документов, а не оценки
+        auto single_top = single.search_top_k(query, DOCS);
+        auto sharded_top = sharded.search_top_k(query, DOCS);
+        std::set<uint32_t> single_ids, sharded_ids;
+        for (const auto& r : single_top) single_ids.insert(r.doc_id);
+        for (const auto& r : sharded_top) sharded_ids.insert(r.doc_id);
+        AssertEqual(sharded_ids == single_ids, true, "Same top-k documents for '" + query + "'");
+        for (size_t i = 1; i < sharded_top.size(); ++i) {
+            Assert(sharded_top[i - 1].score >= sharded_top[i].score, "Merged top-k sorted by score");
+        }
+    }
+    AssertEqual(sharded.search_top_k("общий", 5).size(), (size_t)5, "Merged top-k cut to k");
+
+    // Частичный ответ: "поздний" есть только в последнем шарде, поэтому с подходящим лимитом
+    // памяти первые шарды отвечают полностью, а ответ обрезается по последнему.
+    // Результат должен быть ровно полным ответом на префиксе [0, docs_covered)
+    const std::string heavy = "общий || поздний";
+    auto full = sharded.search_ids(heavy);
+    bool cut_inside = false;
+    for (uint64_t limit = 16; limit < (1u << 20) && !cut_inside; limit *= 2) {
+        SearchOptions opt;
+        opt.limits.max_memory_bytes = limit;
+        sharded.set_options(opt);
+        QueryStatus status;
+        auto partial = sharded.search_ids(heavy, &status);
+        std::vector<uint32_t> prefix;
+        for (uint32_t id : full) {
+            if (id < status.docs_covered) prefix.push_back(id);
+        }
+        AssertEqual(partial == prefix, true, "Partial result is the full answer on the covered prefix");
+        cut_inside = status.partial && status.docs_covered > 0;
+    }
+    Assert(cut_inside, "Some limit cuts the answer after the first shard");
+    sharded.set_options(SearchOptions());
+}
+
+void TestQueryLimits() {
+    // Маленький индекс во временном каталоге: "общий" есть во всех документах, "редкий" - в каждом десятом
+    const uint32_t DOCS = 200;
+    TestIndexDir dir("test_query_limits");
+    dir.write_corpus(MakeTexts(DOCS, [](std::ostream& out, uint32_t i) {
+        out << "Документ " << i << "\nобщий текст" << (i % 10 == 0 ? " редкий" : "") << "\n";
+    }));
+    std::string index_dir = dir.build_index("index");
+    SearchEngine engine;
+    {
+        QuietOutput quiet;
+        engine.load_index(index_dir);
+    }
+
+    QueryStatus status;
+    auto all = engine.search_ids("общий && !редкий", &status);
+    AssertEqual(all.size(), (size_t)(DOCS - DOCS / 10), "Unlimited query result");
+    AssertEqual(status.partial, false, "Unlimited query is complete");
+    AssertEqual(status.docs_covered, DOCS, "Complete query covers all docs");
+    Assert(status.estimated_cost >= status.postings_touched, "Estimate bounds postings touched");
+
+    // Оценка по doc_freq отклоняет запрос до чтения постингов
+    SearchOptions opt;
+    opt.limits.max_postings = DOCS / 2;
+    engine.set_options(opt);
+    bool rejected = false;
+    try {
+        engine.search_ids("общий", &status);
+    } catch (const QueryLimitError&) {
+        rejected = true;
+    }
+    Assert(rejected, "Expensive query rejected up front");
+    AssertEqual(engine.search_ids("редкий").size(), (size_t)(DOCS / 10), "Cheap query passes postings limit");
+
+    // Лимит памяти и отмена дают частичный (здесь пустой) ответ вместо ошибки.
+    // В лимит идут только выделенные списки: один терм читается прямо из отображения
+    opt.limits = QueryLimits();
+    opt.limits.max_memory_bytes = 16;
+    engine.set_options(opt);
+    status = QueryStatus();
+    AssertEqual(engine.search_ids("общий", &status).size(), (size_t)DOCS, "Single term allocates no lists");
+    AssertEqual(status.partial, false, "Single term fits any memory limit");
+    status = QueryStatus();
+    auto limited = engine.search_ids("общий && !редкий", &status);
+    AssertEqual(status.partial, true, "Memory limit gives partial result");
+    AssertEqual(status.reason, std::string("memory"), "Memory limit reason");
+    Assert(limited.size() <= status.docs_covered, "Partial result within covered prefix");
+
+    engine.set_options(SearchOptions());
+    std::atomic<bool> cancel{true};
+    status = QueryStatus();
+    auto cancelled = engine.search_ids("общий || редкий", &status, &cancel);
+    AssertEqual(status.partial, true, "Cancelled query is partial");
+    AssertEqual(status.reason, std::string("cancelled"), "Cancel reason");
+    AssertEqual(cancelled.size(), (size_t)0, "Cancelled before any range");
+}
+
+void TestTitleIndex() {
+    // "налог" в теле каждого четного документа и в заголовках 3, 13, 23, 33,
+    // где в теле его нет и сам документ длинный - по BM25 они внизу
+    const uint32_t DOCS = 40;
+    TestIndexDir dir("test_title_index");
+    dir.write_corpus(MakeTexts(DOCS, [](std::ostream& out, uint32_t i) {
+        out << "Документ " << i << (i % 10 == 3 ? " Налоги" : "") << "\n";
+        if (i % 2 == 0) out << "налог налог текст " << i << "\n";
+        else for (uint32_t w = 0; w < 50; ++w) out << "слово" << w << " ";
+    }));
+    std::string plain_dir = dir.build_index("plain");
+    IndexerOptions options;
+    options.impacts = true;
+    options.titles = true;
+    std::string index_dir = dir.build_index("index", options);
+    SearchEngine plain;
+    SearchEngine engine;
+    {
+        QuietOutput quiet;
+        plain.load_index(plain_dir);
+        engine.load_index(index_dir);
+    }
+
+    bool rejected = false;
+    try {
+        plain.search_ids("title:налог");
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    Assert(rejected, "title: query needs title_index.bin");
+    AssertEqual(plain.has_titles(), false, "No title index without --titles");
+    AssertEqual(engine.has_titles(), true, "Title index loaded");
+
+    // title:терм нормализуется как обычный терм и берет только постинги заголовков
+    auto in_titles = engine.search("title:НАЛОГ");
+    AssertEqual(in_titles.size(), (size_t)4, "title: matches only titles");
+    for (const auto& r : in_titles) Assert(r.title.find("Налоги") != std::string::npos, "title: hit has term in title");
+    AssertEqual(engine.search_ids("налог").size(), (size_t)(DOCS / 2 + 4), "Plain term matches title and body");
+    AssertEqual(engine.search_ids("title:налог && текст").size(), (size_t)0, "title: combines with body terms");
+    AssertEqual(engine.search_ids("title:документ").size(), (size_t)DOCS, "Common title term");
+    AssertEqual(engine.search_ids("title:кодекс").size(), (size_t)0, "Unknown title term");
+    auto rpn = QueryParser::parse_to_rpn("title:налог");
+    AssertEqual((int)rpn[0].type, (int)TITLE, "Title token type");
+    AssertEqual(std::string(rpn[0].value), std::string("налог"), "Title token value");
+
+    // Без буста документы с "налог" в заголовке проигрывают коротким с "налог налог" в теле
+    std::vector<uint32_t> title_docs = engine.search_ids("title:налог");
+    auto is_title_doc = [&](uint32_t id) {
+        return std::find(title_docs.begin(), title_docs.end(), id) != title_docs.end();
+    };
+    SearchOptions opt;
+    opt.title_boost = 0;
+    engine.set_options(opt);
+    for (const auto& r : engine.search_top_k("налог", 4)) Assert(!is_title_doc(r.doc_id), "No boost: body matches first");
+    opt.title_boost = 100;
+    engine.set_options(opt);
+    auto boosted = engine.search_top_k("налог", 4);
+    AssertEqual(boosted.size(), (size_t)4, "Boosted top-k size");
+    for (const auto& r : boosted) Assert(is_title_doc(r.doc_id), "Boost: title matches first");
+    auto only_titles = engine.search_top_k("title:налог", 10);
+    AssertEqual(only_titles.size(), (size_t)4, "Ranked title: query sees only titles");
+}
+
+void TestFuzzyMatcher() {
+    std::vector<std::string> vocab = {
+        "закон", "законн", "закуп", "зако", "налог", "налоговик", "нолог", "суд", "суда", "судь", "сут", "ипотек"
+    };
+    std::sort(vocab.begin(), vocab.end());
+    
+    for (const std::string q : {"закон", "налок", "сыд", "ипотека", "x"}) {
+        for (int d = 1; d <= 2; ++d) {
+            FuzzyMatcher matcher(q, d);
+            auto fast = matcher.find(vocab);
+            auto slow = matcher.find_brute_force(vocab);
+            AssertEqual(fast.size(), slow.size(), "Automaton vs brute force for " + q);
+            for (size_t i = 0; i < fast.size(); ++i) {
+                AssertEqual(fast[i].term_index, slow[i].term_index, "Same matches for " + q);
+                AssertEqual((int)fast[i].distance, (int)slow[i].distance, "Same distance for " + q);
+            }
+        }
+    }
+    
+    auto matches = FuzzyMatcher("налок", 1).find(vocab);
+    AssertEqual((int)matches.size(), 1, "One term within distance 1");
+    AssertEqual(vocab[matches[0].term_index], "налог", "Cyrillic substitution counts as one edit");
+}
+
+
+void TestThreadPool() {
+    ThreadPool pool(4);
+    std::vector<long long> parts(100, 0);
+    pool.parallel_for(parts.size(), [&](size_t i) {
+        for (size_t k = 0; k <= i * 1000; ++k) parts[i] += k;
+    });
+    for (size_t i = 0; i < parts.size(); ++i) {
+        long long n = (long long)i * 1000;
+        AssertEqual(parts[i], n * (n + 1) / 2, "Task " + std::to_string(i) + " result");
+    }
+    
+    // Вложенные вызовы не должны взаимоблокироваться: ожидающий поток помогает
+    std::atomic<int> inner{0};
+    pool.parallel_for(8, [&](size_t) {
+        pool.parallel_for(8, [&](size_t) { inner++; });
+    });
+    AssertEqual(inner.load(), 64, "Nested parallel_for");
+    
+    bool thrown = false;
+    try {
+        pool.parallel_for(10, [](size_t i) { if (i == 7) throw std::runtime_error("boom"); });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    Assert(thrown, "Task exception is rethrown to the caller");
+}
+
+
+void TestHotReload() {
+    // Два индекса разного размера и разбиения; запросы из нескольких потоков идут,
+    // пока индекс много раз перезагружается то из одного, то из другого каталога.
+    // Каждый ответ должен целиком совпадать с ответом одного из индексов
+    TestIndexDir dir("test_hot_reload");
+    std::string index_dirs[2];
+    for (uint32_t v = 0; v < 2; ++v) {
+        std::string corpus = "corpus" + std::to_string(v);
+        dir.write_corpus(MakeTexts(40 + 30 * v, [v](std::ostream& out, uint32_t i) {
+            out << "Версия " << v << " документ " << i << "\nобщий текст" << (i % (3 + v) == 0 ? " редкий" : "") << "\n";
+        }), corpus);
+        IndexerOptions options;
+        options.shards = v == 0 ? 3 : 1;
+        options.impacts = true;
+        index_dirs[v] = dir.build_index("index" + std::to_string(v), options, corpus);
+    }
+    // Загрузки и перезагрузки пишут в cerr
+    std::optional<QuietOutput> quiet(std::in_place);
+
+    const std::vector<std::string> queries = {"общий", "редкий", "общий && !редкий"};
+    std::vector<std::vector<SearchResult>> expected[2];
+    std::vector<std::vector<RankedResult>> expected_top[2];
+    for (uint32_t v = 0; v < 2; ++v) {
+        ShardBroker reference;
+        reference.load_index(index_dirs[v]);
+        for (const auto& q : queries) {
+            expected[v].push_back(reference.search(q));
+            expected_top[v].push_back(reference.search_top_k(q, 5));
+        }
+    }
+    auto same = [](const std::vector<SearchResult>& a, const std::vector<SearchResult>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].doc_id != b[i].doc_id || a[i].title != b[i].title) return false;
+        }
+        return true;
+    };
+    // В top-k заголовок должен принадлежать тому же индексу, что и id
+    auto same_top = [](const std::vector<RankedResult>& a, const std::vector<RankedResult>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].doc_id != b[i].doc_id || a[i].title != b[i].title) return false;
+        }
+        return true;
+    };
+
+    ShardBroker broker;
+    broker.load_index(index_dirs[0]);
+    std::atomic<bool> stop{false};
+    std::atomic<int> mismatches{0};
+    std::atomic<int> answers{0};
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 4; ++t) {
+        clients.emplace_back([&, t] {
+            for (size_t n = t; !stop; ++n) {
+                size_t q = n % queries.size();
+                auto found = broker.search(queries[q]);
+                if (!same(found, expected[0][q]) && !same(found, expected[1][q])) mismatches++;
+                auto top = broker.search_top_k(queries[q], 5);
+                if (!same_top(top, expected_top[0][q]) && !same_top(top, expected_top[1][q])) mismatches++;
+                answers++;
+            }
+        });
+    }
+    const int RELOADS = 20;
+    for (int r = 1; r <= RELOADS; ++r) {
+        while (!broker.start_reload(index_dirs[r % 2])) std::this_thread::yield();
+    }
+    while (broker.is_reloading()) std::this_thread::yield();
+    stop = true;
+    for (auto& c : clients) c.join();
+
+    AssertEqual(mismatches.load(), 0, "Every answer comes from one whole index");
+    Assert(answers.load() > 0, "Queries ran during reloads");
+    AssertEqual(broker.generation(), (uint64_t)RELOADS + 1, "Every reload swapped the snapshot");
+    AssertEqual(broker.last_reload_error(), std::string(), "No reload errors");
+    AssertEqual(same(broker.search("редкий"), expected[0][1]), true, "Last reload wins");
+
+    // Перезагрузку запускают сразу несколько потоков, как SIGHUP и :reload
+    std::vector<std::thread> reloaders;
+    for (int t = 0; t < 3; ++t) {
+        reloaders.emplace_back([&] {
+            for (int started = 0; started < 4;) {
+                if (broker.start_reload(index_dirs[0])) started++;
+                else std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& r : reloaders) r.join();
+    while (broker.is_reloading()) std::this_thread::yield();
+    AssertEqual(broker.generation(), (uint64_t)RELOADS + 1 + 12, "Concurrent starts each reload once");
+
+    // Неудачная перезагрузка оставляет текущий индекс
+    auto reload_error = [&](const std::string& index_dir) {
+        while (!broker.start_reload(index_dir)) std::this_thread::yield();
+        while (broker.is_reloading()) std::this_thread::yield();
+        return broker.last_reload_error();
+    };
+    std::string missing_error = reload_error(dir.path("missing"));
+
+    // Смесь файлов двух сборок (индексатор подменяет их по одному) тоже не загружается
+    namespace fs = std::filesystem;
+    fs::copy(index_dirs[1], dir.path("mixed"), fs::copy_options::recursive);
+    fs::copy_file(index_dirs[0] + "/shard_0/docs_index.bin", dir.path("mixed") + "/docs_index.bin",
+                  fs::copy_options::overwrite_existing);
+    std::string mixed_error = reload_error(dir.path("mixed"));
+    // Шард другой сборки: build_id лежит в generation.bin сразу после сигнатуры
+    fs::copy(index_dirs[0], dir.path("mixed_shards"), fs::copy_options::recursive);
+    {
+        std::fstream stamp(dir.path("mixed_shards") + "/shard_1/generation.bin", std::ios::in | std::ios::out | std::ios::binary);
+        stamp.seekg(4);
+        char byte = (char)stamp.get();
+        stamp.seekp(4);
+        stamp.put((char)(byte ^ 1));
+    }
+    std::string mixed_shards_error = reload_error(dir.path("mixed_shards"));
+    quiet.reset();
+    Assert(!missing_error.empty(), "Failed reload reports an error");
+    Assert(mixed_error.find("generation") != std::string::npos, "Mixed files rejected: " + mixed_error);
+    Assert(mixed_shards_error.find("generation") != std::string::npos, "Mixed shards rejected: " + mixed_shards_error);
+    AssertEqual(same(broker.search("редкий"), expected[0][1]), true, "Failed reload keeps the index");
+}
+
+void TestQueryArena() {
+    const uint32_t DOCS = 200;
+    TestIndexDir dir("test_query_arena");
+    dir.write_corpus(MakeTexts(DOCS, [](std::ostream& out, uint32_t i) {
+        out << "Документ " << i << "\nобщий текст" << (i % 10 == 0 ? " редкий" : "") << "\n";
+    }));
+    std::string index_dir = dir.build_index("index");
+    SearchEngine engine;
+    {
+        QuietOutput quiet;
+        engine.load_index(index_dir);
+    }
+
+    // Токены парсера ссылаются на строку запроса и лежат на переданном ресурсе
+    {
+        QueryArena::Scope scope;
+        std::string query = "Общий && !редкий";
+        auto rpn = QueryParser::parse_to_rpn(query, scope.resource());
+        Assert(rpn.get_allocator().resource() == scope.resource(), "RPN allocated in arena");
+        Assert(rpn[0].value.data() == query.data(), "Token points into query");
+    }
+
+    const std::string queries[] = {"общий && !редкий", "документ || редкий", "текст редкий", "(общий || редкий) && !документ"};
+    const size_t expected[] = {DOCS - DOCS / 10, DOCS, DOCS / 10, 0};
+    std::vector<uint32_t> ids;
+    // Укороченный ответ освобождает строки лишних результатов, поэтому у каждого запроса свой буфер
+    std::vector<SearchResult> results[4];
+    QueryStatus status;
+    // Первые проходы прогревают арену и буферы результатов
+    for (int warmup = 0; warmup < 2; ++warmup) {
+        for (size_t i = 0; i < 4; ++i) {
+            engine.search_ids(queries[i], ids, &status);
+            engine.search(queries[i], results[i], &status);
+        }
+    }
+
+    uint64_t before = AllocationCounter::total();
+    size_t wrong = 0;
+    for (int round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < 4; ++i) {
+            engine.search_ids(queries[i], ids, &status);
+            if (ids.size() != expected[i] || status.partial) wrong++;
+            engine.search(queries[i], results[i], &status);
+            if (results[i].size() != expected[i]) wrong++;
+        }
+    }
+    uint64_t allocations = AllocationCounter::total() - before;
+    AssertEqual(wrong, (size_t)0, "Results in reused buffers");
+    AssertEqual(allocations, (uint64_t)0, "Steady-state queries do not touch the heap");
+
+    engine.search_ids(queries[0], ids);
+    Assert(engine.search_ids(queries[0]) == ids, "Returning API gives the same ids");
+    AssertEqual(engine.search(queries[0]).size(), ids.size(), "Returning search gives the same count");
+
+    // Постинги читаются по указателю из отображения: индекс с невыровненным смещением
+    // (как у собранных до выравнивания) не загружается. Сдвигается смещение первого терма
+    {
+        std::fstream inv(index_dir + "/inverted_index.bin", std::ios::in | std::ios::out | std::ios::binary);
+        inv.seekg(9);
+        uint8_t len = (uint8_t)inv.get();
+        size_t offset_pos = 9 + 1 + len + 4;
+        uint32_t offset = 0;
+        inv.seekg(offset_pos);
+        inv.read((char*)&offset, 4);
+        offset += 1;
+        inv.seekp(offset_pos);
+        inv.write((const char*)&offset, 4);
+    }
+    std::string error;
+    try {
+        QuietOutput quiet;
+        SearchEngine().load_index(index_dir);
+    } catch (const std::runtime_error& e) {
+        error = e.what();
+    }
+    Assert(error.find("aligned") != std::string::npos, "Unaligned postings rejected at load: " + error);
+}
+
+
+std::string RpnToString(const std::pmr::vector<Token>& rpn) {
     std::string res;
     for (const auto& t : rpn) {
         if (!res.empty()) res += " ";
@@ -80,6 +1201,29 @@ std::string RpnToString(const std::vector<Token>& rpn) {
     return res;
 }
 
+void TestLatencyHistogram() {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 100000; ++v) h.record(v);
+    AssertEqual(h.count(), (uint64_t)100000, "Count");
+    AssertEqual(h.max(), (uint64_t)100000, "Max");
+    for (double q : {50.0, 99.0, 99.9}) {
+        double expected = q / 100 * 100000;
+        double got = (double)h.percentile(q);
+        Assert(got >= expected && got <= expected * 1.001, "Percentile " + std::to_string(q) + " within 0.1%");
+    }
+    AssertEqual(h.percentile(100), (uint64_t)100000, "p100 = max");
+    
+    // Одна задержка 1000 при ожидаемом интервале 100 - еще 9 пропущенных запросов
+    LatencyHistogram c;
+    c.record_corrected(1000, 100);
+    AssertEqual(c.count(), (uint64_t)10, "Coordinated omission fill-in");
+    AssertEqual(c.percentile(10), (uint64_t)100, "Smallest synthetic sample");
+    
+    LatencyHistogram raw;
+    raw.record(1000);
+    AssertEqual(raw.corrected(100).count(), c.count(), "Post-hoc correction matches online");
+}
+
 void TestQueryParser() {
     auto rpn1 = QueryParser::parse_to_rpn("A || B");
     AssertEqual(RpnToString(rpn1), "A B ||", "Simple OR");
@@ -98,6 +1242,17 @@ void TestQueryParser() {
     
     auto rpn6 = QueryParser::parse_to_rpn("  A    B  ");
     AssertEqual(RpnToString(rpn6), "A B &&", "Whitespace tolerance");
+    
+    auto rpn7 = QueryParser::parse_to_rpn("~налок ~~суд !A");
+    AssertEqual(RpnToString(rpn7), "налок суд && A ! &&", "Fuzzy operands");
+    AssertEqual((int)rpn7[0].type, (int)FUZZY, "Fuzzy token type");
+    AssertEqual(rpn7[0].max_edits, 1, "Single tilde = 1 edit");
+    AssertEqual(rpn7[1].max_edits, 2, "Double tilde = 2 edits");
+
+    auto rpn8 = QueryParser::parse_to_rpn("*логов* || *");
+    AssertEqual(RpnToString(rpn8), "логов * ||", "Substring operand");
+    AssertEqual((int)rpn8[0].type, (int)SUBSTRING, "Substring token type");
+    AssertEqual((int)rpn8[1].type, (int)TERM, "Lone star is a term");
 }
 
 int main() {
@@ -108,8 +1263,30 @@ int main() {
     std::cerr << "=== RUNNING EXTENDED TESTS ===" << std::endl;
     
     RunTest(TestCustomMapStress, "CustomMap Stress Test");
+    RunTest(TestSketches,        "Count-Min / HLL / TopK Sketches");
+    RunTest(TestInternAndRadixSort, "Term Interner & Radix Sort");
     RunTest(TestStemmerExtended, "Stemmer Extended Russian");
+    RunTest(TestStemmerMatchesRegex, "Suffix Stemmer vs Regex Reference");
     RunTest(TestBooleanLogic,    "Boolean Set Operations");
+    RunTest(TestSetOperations,   "SIMD Set Operations vs std::set_*");
+    RunTest(TestDocStore,        "LZ Codec & Doc Store");
+    RunTest(TestPostingsCodecs,  "Postings Codec Size Estimates");
+    RunTest(TestBitpackingFirstApart, "BP128 Estimate With First Doc-id Apart");
+    RunTest(TestDocReorder,      "Doc-id Reordering (MinHash / BP)");
+    RunTest(TestNearDuplicates,  "SimHash Near-Duplicate Detection");
+    RunTest(TestImpactTopK,      "Impact-Ordered Top-k Early Termination");
+    RunTest(TestTrigramIndex,    "Trigram Substring Lookup");
+    RunTest(TestCompletionIndex, "Top-k Prefix Completion Trie");
+    RunTest(TestPackedCorpus,    "Packed Corpus Container");
+    RunTest(TestCheckpointResume, "Checkpointed Build Resume");
+    RunTest(TestShardedSearch,   "Sharded Build & Scatter-Gather Broker");
+    RunTest(TestQueryLimits,     "Query Budgets & Cancellation");
+    RunTest(TestTitleIndex,      "Title Field Postings & Boost");
+    RunTest(TestQueryArena,      "Arena Query Path Without Allocations");
+    RunTest(TestFuzzyMatcher,    "Levenshtein Automaton Lookup");
+    RunTest(TestHotReload,       "Hot Reload Under Concurrent Queries");
+    RunTest(TestThreadPool,      "Work-Stealing Thread Pool");
+    RunTest(TestLatencyHistogram, "HDR Latency Histogram");
     RunTest(TestQueryParser,     "Shunting-Yard Query Parser");
     
     return 0;
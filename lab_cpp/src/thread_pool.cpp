@@ -0,0 +1,112 @@
+#include "thread_pool.hpp"
+#include <exception>
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Очередь 0 принадлежит внешним потокам, вызывающим parallel_for
+    for (unsigned i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stop = true;
+    }
+    sleep_cv.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+bool ThreadPool::pop_own(size_t queue, Task& task) {
+    Queue& q = *queues[queue];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    pending--;
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, Task& task) {
+    for (size_t k = 1; k <= queues.size(); ++k) {
+        Queue& q = *queues[(thief + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) continue;
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        pending--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    while (true) {
+        Task task;
+        if (pop_own(index, task) || steal(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_cv.wait(lock, [this] { return stop || pending > 0; });
+        if (stop && pending == 0) return;
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    if (count == 1 || workers.empty()) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t remaining = count;
+    std::exception_ptr error;
+
+    auto run = [&](size_t i) {
+        std::exception_ptr task_error;
+        try {
+            fn(i);
+        } catch (...) {
+            task_error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(done_mutex);
+        if (task_error && !error) error = task_error;
+        if (--remaining == 0) done_cv.notify_all();
+    };
+
+    // Задачи раскладываются по очередям рабочих по кругу
+    for (size_t i = 0; i < count; ++i) {
+        Queue& q = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back([&run, i] { run(i); });
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    sleep_cv.notify_all();
+
+    // Вызывающий поток помогает, пока есть что забрать
+    Task task;
+    while (pop_own(0, task) || steal(0, task)) {
+        task();
+    }
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&remaining] { return remaining == 0; });
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+// Пул потоков с захватом работы: у каждого рабочего своя очередь, свои задачи
+// он берет с конца, а при пустой очереди забирает задачи с начала чужих очередей.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Выполняет fn(0..count-1) и ждет завершения; вызывающий поток тоже выполняет задачи
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+    unsigned size() const { return (unsigned)workers.size() + 1; }
+
+    static ThreadPool& shared();
+
+private:
+    using Task = std::function<void()>;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    std::atomic<size_t> pending{0};
+    bool stop = false;
+
+    bool pop_own(size_t queue, Task& task);
+    bool steal(size_t thief, Task& task);
+    void worker_loop(size_t index);
+};
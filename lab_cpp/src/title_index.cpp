@@ -0,0 +1,91 @@
+#include "title_index.hpp"
+#include "binary_utils.hpp"
+#include "tokenizer.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    const size_t HEADER_BYTES = 4 * 4;
+}
+
+void TitleIndex::write(const std::string& filename, const std::vector<std::string>& titles) {
+    // Пары (терм, doc_id) без повторов: терм, встреченный в заголовке дважды, дает один постинг
+    std::vector<std::pair<std::string, uint32_t>> pairs;
+    Tokenizer tokenizer;
+    for (uint32_t doc = 0; doc < titles.size(); ++doc) {
+        tokenizer.tokenize_text(titles[doc], [&](const std::string& token) { pairs.push_back({token, doc}); });
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    std::vector<uint32_t> term_first;
+    for (uint32_t i = 0; i < pairs.size(); ++i) {
+        if (term_first.empty() || pairs[term_first.back()].first != pairs[i].first) term_first.push_back(i);
+    }
+    uint32_t term_total = (uint32_t)term_first.size();
+
+    std::ofstream out(filename, std::ios::binary);
+    BinaryUtils::write_u32(out, SIGNATURE);
+    BinaryUtils::write_u32(out, VERSION);
+    BinaryUtils::write_u32(out, term_total);
+    BinaryUtils::write_u32(out, (uint32_t)pairs.size());
+
+    uint32_t offset = 0;
+    for (uint32_t i : term_first) {
+        BinaryUtils::write_u32(out, offset);
+        offset += (uint32_t)pairs[i].first.size();
+    }
+    BinaryUtils::write_u32(out, offset);
+    for (uint32_t i : term_first) BinaryUtils::write_u32(out, i);
+    BinaryUtils::write_u32(out, (uint32_t)pairs.size());
+    for (const auto& p : pairs) BinaryUtils::write_u32(out, p.second);
+    for (uint32_t i : term_first) out.write(pairs[i].first.data(), pairs[i].first.size());
+    if (!out) throw std::runtime_error("Cannot write " + filename);
+}
+
+void TitleIndex::open(const std::string& filename) {
+    close();
+    file.open(filename);
+
+    const char* data = file.data();
+    auto u32_at = [data](size_t pos) { return reinterpret_cast<const uint32_t*>(data + pos); };
+    if (file.size() < HEADER_BYTES || *u32_at(0) != SIGNATURE || *u32_at(4) != VERSION) {
+        close();
+        throw std::runtime_error("Invalid title index signature");
+    }
+    terms = *u32_at(8);
+    total_postings = *u32_at(12);
+
+    uint64_t pos = HEADER_BYTES;
+    term_offset = u32_at(pos);
+    pos += (terms + 1) * 4ULL;
+    post_begin = u32_at(pos);
+    pos += (terms + 1) * 4ULL;
+    postings = u32_at(pos);
+    pos += total_postings * 4ULL;
+
+    if (pos > file.size() || pos + term_offset[terms] > file.size() || post_begin[terms] != total_postings) {
+        close();
+        throw std::runtime_error("Corrupted title index");
+    }
+    pool = data + pos;
+}
+
+void TitleIndex::close() {
+    file.close();
+    terms = total_postings = 0;
+}
+
+TitleIndex::Postings TitleIndex::find(std::string_view key) const {
+    if (!is_open()) return {};
+
+    uint32_t lo = 0, hi = terms;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (term(mid) < key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == terms || term(lo) != key) return {};
+    return {postings + post_begin[lo], post_begin[lo + 1] - post_begin[lo]};
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "mapped_file.hpp"
+
+// Постинги поля заголовка (title_index.bin) для запросов title:терм и буста заголовка в top-k.
+//
+// Заголовок - первая строка документа, его термы нормализуются так же, как в основном
+// словаре. Заголовок короткий, поэтому списки здесь на порядки меньше основных и запрос
+// title:терм не трогает inverted_index.bin.
+//
+// Формат (все массивы выровнены, читаются из отображения на месте):
+// заголовок из 4 x u32: сигнатура, версия, T термов, P постингов;
+// u32 term_offset[T + 1]; u32 post_begin[T + 1]; u32 postings[P] (doc_id по возрастанию);
+// байты термов в порядке возрастания.
+class TitleIndex {
+public:
+    static constexpr uint32_t SIGNATURE = 0x4C544954;
+    static constexpr uint32_t VERSION = 1;
+
+    struct Postings {
+        const uint32_t* docs = nullptr;
+        uint32_t count = 0;
+    };
+
+    // titles[doc_id] - заголовки документов шарда
+    static void write(const std::string& filename, const std::vector<std::string>& titles);
+
+    void open(const std::string& filename);
+    void close();
+    bool is_open() const { return file.is_open(); }
+
+    // Документы, в заголовке которых есть терм (уже нормализованный); без выделения памяти
+    Postings find(std::string_view term) const;
+
+    uint32_t term_count() const { return terms; }
+    uint32_t posting_count() const { return total_postings; }
+    size_t mapped_bytes() const { return file.size(); }
+
+private:
+    MappedFile file;
+    uint32_t terms = 0;
+    uint32_t total_postings = 0;
+    const uint32_t* term_offset = nullptr;
+    const uint32_t* post_begin = nullptr;
+    const uint32_t* postings = nullptr;
+    const char* pool = nullptr;
+
+    std::string_view term(uint32_t t) const {
+        return std::string_view(pool + term_offset[t], term_offset[t + 1] - term_offset[t]);
+    }
+};
@@ -14,10 +14,8 @@ size_t get_utf8_char_len(char c) {
 
 // А-Я (U+0410..U+042F) -> а-я (U+0430..U+044F)
 // Ё (U+0401) -> ё (U+0451)
-std::string Tokenizer::to_lower_utf8(const std::string& str) {
-    std::string res;
-    res.reserve(str.size());
-
+template <typename String>
+static void append_lower_utf8(std::string_view str, String& res) {
     for (size_t i = 0; i < str.size(); ) {
         unsigned char c = static_cast<unsigned char>(str[i]);
         size_t len = get_utf8_char_len(str[i]);
@@ -54,15 +52,31 @@ std::string Tokenizer::to_lower_utf8(const std::string& str) {
             i += len;
         }
     }
+}
+
+std::string Tokenizer::to_lower_utf8(const std::string& str) {
+    std::string res;
+    res.reserve(str.size());
+    append_lower_utf8(str, res);
     return res;
 }
 
+void Tokenizer::to_lower_utf8(std::string_view str, std::pmr::string& out) {
+    out.clear();
+    out.reserve(str.size());
+    append_lower_utf8(str, out);
+}
+
 bool Tokenizer::is_separator(char c) {
     static const std::string separators = " \t\n\r.,!?:;\"'()[]{}-<>/|\\*&^%$#@~`=";
     return separators.find(c) != std::string::npos;
 }
 
 void Tokenizer::tokenize_file(const std::string& filepath, CustomMap& map) {
+    tokenize_file(filepath, [&map](const std::string& token) { map.increment(token); });
+}
+
+void Tokenizer::tokenize_file(const std::string& filepath, const TokenCallback& on_token) {
     std::ifstream file(filepath, std::ios::binary); 
     if (!file.is_open()) return;
 
@@ -73,37 +87,51 @@ void Tokenizer::tokenize_file(const std::string& filepath, CustomMap& map) {
     file.read(&content[0], size);
     file.close();
 
-    std::string current_token;
+    tokenize_text(content, on_token);
+}
+
+void Tokenizer::tokenize_text(const std::string& content, CustomMap& map) {
+    tokenize_text(content, [&map](const std::string& token) { map.increment(token); });
+}
+
+void Tokenizer::tokenize_text(const std::string& content, const TokenCallback& on_token) {
+    tokenize_words(content, [&on_token](const std::string&, const std::string& stem) { on_token(stem); });
+}
+
+void Tokenizer::tokenize_words(const std::string& content, const WordCallback& on_word) {
+    split_words(content, [&](size_t begin, size_t end) {
+        std::string lower = to_lower_utf8(content.substr(begin, end - begin));
+        std::string stemmed = Stemmer::stem(lower); 
+        if (!stemmed.empty()) {
+            on_word(lower, stemmed);
+        }
+    });
+}
+
+void Tokenizer::split_words(const std::string& content, const SpanCallback& on_word) {
+    size_t word_begin = 0;
+    bool in_word = false;
     
     for (size_t i = 0; i < content.size(); ) {
-        unsigned char c = content[i];
         size_t len = get_utf8_char_len(content[i]);
         
         if (len == 1 && is_separator(content[i])) {
-            if (!current_token.empty()) {
-                std::string lower = to_lower_utf8(current_token);
-                std::string stemmed = Stemmer::stem(lower); 
-                if (!stemmed.empty()) {
-                    map.increment(stemmed);
-                }
-                current_token.clear();
+            if (in_word) {
+                on_word(word_begin, i);
+                in_word = false;
             }
             i++;
             continue;
         }
         
-        for (size_t k = 0; k < len && i + k < content.size(); k++) {
-            current_token += content[i + k];
+        if (!in_word) {
+            word_begin = i;
+            in_word = true;
         }
-        i += len;
+        i = std::min(i + len, content.size());
     }
 
-    if (!current_token.empty()) {
-        std::string lower = to_lower_utf8(current_token);
-        std::string stemmed = Stemmer::stem(lower); 
-        if (!stemmed.empty()) {
-            map.increment(stemmed);
-        }
-        current_token.clear();
+    if (in_word) {
+        on_word(word_begin, content.size());
     }
-}
\ No newline at end of file
+}
@@ -1,13 +1,30 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <memory_resource>
 #include <vector>
 #include <fstream>
+#include <functional>
 #include "custom_map.hpp"
 
 class Tokenizer {
 public:
+    using TokenCallback = std::function<void(const std::string&)>;
+    using SpanCallback = std::function<void(size_t begin, size_t end)>;
+    // Слово в нижнем регистре до стемминга и его терм
+    using WordCallback = std::function<void(const std::string& word, const std::string& stem)>;
+
     void tokenize_file(const std::string& filepath, CustomMap& map);
+    void tokenize_file(const std::string& filepath, const TokenCallback& on_token);
+    void tokenize_text(const std::string& content, CustomMap& map);
+    void tokenize_text(const std::string& content, const TokenCallback& on_token);
+    void tokenize_words(const std::string& content, const WordCallback& on_word);
+
+    // Границы слов (в байтах) без нормализации, общая логика для токенизации и сниппетов.
+    static void split_words(const std::string& content, const SpanCallback& on_word);
 
     static std::string to_lower_utf8(const std::string& str);
+    // То же в строку на переданном ресурсе памяти (для запросов - в арене)
+    static void to_lower_utf8(std::string_view str, std::pmr::string& out);
     static bool is_separator(char c);
 };
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "trigram_index.hpp"
+#include "binary_utils.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    const size_t HEADER_BYTES = 6 * 4;
+    const uint32_t MAX_CODE_POINT = 0x1FFFFF;
+
+    // Триграммы слова, дополненного двумя PAD: по одной на каждую позицию
+    std::vector<uint64_t> padded_trigrams(const std::vector<uint32_t>& cp) {
+        std::vector<uint64_t> result;
+        for (size_t i = 0; i < cp.size(); ++i) {
+            uint32_t b = i + 1 < cp.size() ? cp[i + 1] : TrigramIndex::PAD;
+            uint32_t c = i + 2 < cp.size() ? cp[i + 2] : TrigramIndex::PAD;
+            result.push_back(TrigramIndex::key(cp[i], b, c));
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+}
+
+std::vector<uint32_t> TrigramIndex::code_points(const std::string& s) {
+    std::vector<uint32_t> cp;
+    for (size_t i = 0; i < s.size();) {
+        unsigned char c = (unsigned char)s[i];
+        size_t len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 1;
+        uint32_t value = len == 1 ? c : c & (0x7F >> len);
+        for (size_t k = 1; k < len; ++k) {
+            value = (value << 6) | (i + k < s.size() ? ((unsigned char)s[i + k] & 0x3F) : 0);
+        }
+        cp.push_back(std::min(value, MAX_CODE_POINT));
+        i += len;
+    }
+    return cp;
+}
+
+void TrigramIndex::write(const std::string& filename, std::vector<std::pair<std::string, uint32_t>> word_terms) {
+    std::sort(word_terms.begin(), word_terms.end());
+
+    std::vector<std::pair<uint64_t, uint32_t>> pairs;
+    for (uint32_t w = 0; w < word_terms.size(); ++w) {
+        for (uint64_t trigram : padded_trigrams(code_points(word_terms[w].first))) pairs.push_back({trigram, w});
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> post_begin;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (keys.empty() || keys.back() != pairs[i].first) {
+            keys.push_back(pairs[i].first);
+            post_begin.push_back((uint32_t)i);
+        }
+    }
+    post_begin.push_back((uint32_t)pairs.size());
+
+    std::ofstream out(filename, std::ios::binary);
+    BinaryUtils::write_u32(out, SIGNATURE);
+    BinaryUtils::write_u32(out, VERSION);
+    BinaryUtils::write_u32(out, (uint32_t)word_terms.size());
+    BinaryUtils::write_u32(out, (uint32_t)keys.size());
+    BinaryUtils::write_u32(out, (uint32_t)pairs.size());
+    BinaryUtils::write_u32(out, 0);
+
+    for (uint64_t k : keys) BinaryUtils::write_u64(out, k);
+    for (uint32_t b : post_begin) BinaryUtils::write_u32(out, b);
+    uint32_t offset = 0;
+    for (const auto& w : word_terms) {
+        BinaryUtils::write_u32(out, offset);
+        offset += (uint32_t)w.first.size();
+    }
+    BinaryUtils::write_u32(out, offset);
+    for (const auto& w : word_terms) BinaryUtils::write_u32(out, w.second);
+    for (const auto& p : pairs) BinaryUtils::write_u32(out, p.second);
+    for (const auto& w : word_terms) BinaryUtils::write_string(out, w.first);
+}
+
+void TrigramIndex::open(const std::string& filename) {
+    close();
+    file.open(filename);
+
+    const char* data = file.data();
+    auto u32_at = [data](size_t pos) { return reinterpret_cast<const uint32_t*>(data + pos); };
+    if (file.size() < HEADER_BYTES || *u32_at(0) != SIGNATURE || *u32_at(4) != VERSION) {
+        close();
+        throw std::runtime_error("Invalid trigram index signature");
+    }
+    words = *u32_at(8);
+    trigrams = *u32_at(12);
+    uint64_t postings_count = *u32_at(16);
+
+    uint64_t pos = HEADER_BYTES;
+    keys = reinterpret_cast<const uint64_t*>(data + pos);
+    pos += trigrams * 8ULL;
+    post_begin = u32_at(pos);
+    pos += (trigrams + 1) * 4ULL;
+    word_offset = u32_at(pos);
+    pos += (words + 1) * 4ULL;
+    word_term = u32_at(pos);
+    pos += words * 4ULL;
+    postings = u32_at(pos);
+    pos += postings_count * 4;
+    pool = data + pos;
+
+    if (pos > file.size() || pos + word_offset[words] > file.size() || post_begin[trigrams] != postings_count) {
+        close();
+        throw std::runtime_error("Corrupted trigram index");
+    }
+}
+
+void TrigramIndex::close() {
+    file.close();
+    words = trigrams = 0;
+}
+
+std::pair<const uint32_t*, const uint32_t*> TrigramIndex::postings_of(uint64_t trigram) const {
+    const uint64_t* it = std::lower_bound(keys, keys + trigrams, trigram);
+    if (it == keys + trigrams || *it != trigram) return {postings, postings};
+    size_t t = it - keys;
+    return {postings + post_begin[t], postings + post_begin[t + 1]};
+}
+
+std::vector<uint32_t> TrigramIndex::find_terms(const std::string& sub) const {
+    std::vector<uint32_t> cp = code_points(sub);
+    if (!is_open() || cp.empty()) return {};
+
+    std::vector<uint32_t> candidates;
+    if (cp.size() >= 3) {
+        // Списки триграмм подстроки пересекаются от коротких к длинным
+        std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+        for (size_t i = 0; i + 2 < cp.size(); ++i) lists.push_back(postings_of(key(cp[i], cp[i + 1], cp[i + 2])));
+        std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+            return a.second - a.first < b.second - b.first;
+        });
+
+        candidates.assign(lists[0].first, lists[0].second);
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+            std::vector<uint32_t> next;
+            std::set_intersection(candidates.begin(), candidates.end(), lists[i].first, lists[i].second,
+                                  std::back_inserter(next));
+            candidates.swap(next);
+        }
+    } else {
+        // Короткая подстрока - префикс триграмм: их диапазон в отсортированных ключах непрерывен
+        uint64_t lo = key(cp[0], cp.size() > 1 ? cp[1] : 0, 0);
+        uint64_t hi = key(cp[0], cp.size() > 1 ? cp[1] : MAX_CODE_POINT, MAX_CODE_POINT);
+        size_t first = std::lower_bound(keys, keys + trigrams, lo) - keys;
+        size_t last = std::upper_bound(keys, keys + trigrams, hi) - keys;
+        candidates.assign(postings + post_begin[first], postings + post_begin[last]);
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+
+    std::vector<uint32_t> terms;
+    for (uint32_t w : candidates) {
+        std::string word(pool + word_offset[w], word_offset[w + 1] - word_offset[w]);
+        if (word.find(sub) != std::string::npos) terms.push_back(word_term[w]);
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    return terms;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "mapped_file.hpp"
+
+// Триграммный индекс по словоформам корпуса (trigram_index.bin) для запросов *подстрока*.
+//
+// Словоформа - слово в нижнем регистре до стемминга, каждой сопоставлен терм
+// основного словаря. Триграммы берутся по кодовым точкам слова, дополненного
+// двумя символами PAD в конце, поэтому с каждой позиции слова начинается триграмма.
+// Подстрока от 3 символов - пересечение списков ее триграмм, 1-2 символа -
+// диапазон триграмм с таким префиксом. Кандидаты проверяются поиском подстроки.
+//
+// Формат (все массивы выровнены, читаются из отображения на месте):
+// заголовок из 6 x u32: сигнатура, версия, W слов, T триграмм, P постингов, 0;
+// u64 keys[T] по возрастанию; u32 post_begin[T + 1]; u32 word_offset[W + 1];
+// u32 word_term[W]; u32 postings[P] (id словоформ); байты словоформ.
+class TrigramIndex {
+public:
+    static constexpr uint32_t SIGNATURE = 0x4D475254;
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t PAD = 1;
+
+    // words: словоформа и номер ее терма в словаре inverted_index.bin
+    static void write(const std::string& filename, std::vector<std::pair<std::string, uint32_t>> words);
+
+    void open(const std::string& filename);
+    void close();
+    bool is_open() const { return file.is_open(); }
+
+    // Номера термов словаря, у которых есть словоформа с подстрокой sub (sub в нижнем регистре)
+    std::vector<uint32_t> find_terms(const std::string& sub) const;
+
+    uint32_t word_count() const { return words; }
+    uint32_t trigram_count() const { return trigrams; }
+
+    static std::vector<uint32_t> code_points(const std::string& utf8);
+    static uint64_t key(uint32_t a, uint32_t b, uint32_t c) {
+        return ((uint64_t)a << 42) | ((uint64_t)b << 21) | c;
+    }
+
+private:
+    MappedFile file;
+    uint32_t words = 0;
+    uint32_t trigrams = 0;
+    const uint64_t* keys = nullptr;
+    const uint32_t* post_begin = nullptr;
+    const uint32_t* word_offset = nullptr;
+    const uint32_t* word_term = nullptr;
+    const uint32_t* postings = nullptr;
+    const char* pool = nullptr;
+
+    std::pair<const uint32_t*, const uint32_t*> postings_of(uint64_t trigram) const;
+};
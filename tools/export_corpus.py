@@ -1,3 +1,6 @@
+import argparse
+import os
+import struct
 import psycopg2
 import yaml
 from pathlib import Path
@@ -7,6 +10,38 @@ import re
 
 CONFIG_PATH = "config.yaml"  
 OUTPUT_DIR = Path("corpus_txt")  
+PACKED_PATH = Path("corpus.pack")
+
+PACKED_SIGNATURE = 0x4B434150
+PACKED_VERSION = 1
+
+
+class PackedCorpusWriter:
+    """Упакованный корпус для lab3 / lab4_indexer (формат в lab_cpp/src/packed_corpus.hpp):
+    заголовок, записи (u32 длина + байты для заголовка, URL и тела), таблица смещений записей"""
+
+    def __init__(self, path: Path):
+        self.path = path
+        self.tmp_path = path.with_name(path.name + ".tmp")
+        self.file = open(self.tmp_path, "wb")
+        self.file.write(struct.pack("<IIIIQ", PACKED_SIGNATURE, PACKED_VERSION, 0, 0, 0))
+        self.offsets = []
+
+    def add(self, title: str, url: str, body: str):
+        self.offsets.append(self.file.tell())
+        for field in (title, url, body):
+            data = field.encode("utf-8")
+            self.file.write(struct.pack("<I", len(data)))
+            self.file.write(data)
+
+    def close(self):
+        self.file.write(b"\0" * (-self.file.tell() % 8))
+        table = self.file.tell()
+        self.file.write(struct.pack(f"<{len(self.offsets)}Q", *self.offsets))
+        self.file.seek(0)
+        self.file.write(struct.pack("<IIIIQ", PACKED_SIGNATURE, PACKED_VERSION, len(self.offsets), 0, table))
+        self.file.close()
+        os.replace(self.tmp_path, self.path)
 
 
 def parse_consultant_html(html_content: str) -> str | None:
@@ -67,6 +102,11 @@ def load_config(path: str) -> dict:
 
 
 def main():
+    parser = argparse.ArgumentParser(description="Выгрузка корпуса из БД")
+    parser.add_argument("--packed", nargs="?", const=str(PACKED_PATH), default=None, metavar="FILE",
+                        help="писать один упакованный файл вместо файла на документ (по умолчанию corpus.pack)")
+    args = parser.parse_args()
+
     config = load_config(CONFIG_PATH)
     db_conf = config['db']
 
@@ -78,12 +118,14 @@ def main():
         dbname=db_conf['dbname']
     )
 
-    OUTPUT_DIR.mkdir(parents=True, exist_ok=True)
+    packed = PackedCorpusWriter(Path(args.packed)) if args.packed else None
+    if not packed:
+        OUTPUT_DIR.mkdir(parents=True, exist_ok=True)
 
     print("Начинаем экспорт документов из БД...")
 
     with conn.cursor() as cursor:
-        cursor.execute("SELECT id, source_name, raw_html FROM documents")
+        cursor.execute("SELECT id, source_name, raw_html, url FROM documents ORDER BY id")
 
         count = 0
         skipped = 0
@@ -93,7 +135,7 @@ def main():
             if not rows:
                 break
 
-            for doc_id, source, html in rows:
+            for doc_id, source, html, url in rows:
                 parsed_text = None
 
                 if source == 'consultant':
@@ -101,7 +143,11 @@ def main():
                 elif source == 'business_ru':
                     parsed_text = parse_business_html(html)
 
-                if parsed_text:
+                if parsed_text and packed:
+                    title, _, body = parsed_text.partition("\n")
+                    packed.add(title, url or "", body)
+                    count += 1
+                elif parsed_text:
                     file_path = OUTPUT_DIR / f"doc_{doc_id}.txt"
                     file_path.write_text(parsed_text, encoding='utf-8')
                     count += 1
@@ -110,7 +156,11 @@ def main():
 
             print(f"\rОбработано: {count} (Пропущено: {skipped})", end="")
 
-    print(f"\nГотово! Файлы сохранены в {OUTPUT_DIR.resolve()}")
+    if packed:
+        packed.close()
+        print(f"\nГотово! Корпус упакован в {packed.path.resolve()}")
+    else:
+        print(f"\nГотово! Файлы сохранены в {OUTPUT_DIR.resolve()}")
     conn.close()
 
 
@@ -4,13 +4,27 @@ import json
 import time
 import os
 import sys
+from search_lib import SearchLibrary, SearchError, find_library
 
 EXE_PATH = os.path.abspath("../lab_cpp/build/Release/lab4_search.exe")
+BUILD_DIR = os.path.abspath("../lab_cpp/build")
 if sys.platform != "win32":
     EXE_PATH = os.path.abspath("../lab_cpp/build/lab4_search")
+INDEX_DIR = os.path.normpath(os.path.join(BUILD_DIR, "..", "..", "index_data"))
 
 
-CORPUS_DIR = os.path.abspath("../corpus_txt")
+@st.cache_resource
+def get_library():
+    """Движок в процессе через libsearch (один на все сессии). None - работаем через lab4_search"""
+    lib_path = find_library(BUILD_DIR)
+    if not lib_path:
+        return None
+    try:
+        return SearchLibrary(lib_path, INDEX_DIR)
+    except (OSError, SearchError) as e:
+        st.warning(f"libsearch недоступна ({e}), используется lab4_search")
+        return None
+
 
 def get_engine():
     """Запускает C++ процесс и держит его открытым в session_state"""
@@ -51,13 +65,14 @@ def get_engine():
             
     return st.session_state["engine_process"]
 
-def search_in_cpp(query):
+def engine_request(line):
+    """Отправляет строку движку и читает одну строку JSON-ответа"""
     process = get_engine()
     if not process:
         return None
 
     try:
-        process.stdin.write(query + "\n")
+        process.stdin.write(line + "\n")
         process.stdin.flush()
         
         json_line = process.stdout.readline()
@@ -68,18 +83,53 @@ def search_in_cpp(query):
     except Exception as e:
         return {"error": str(e)}
 
+def search_in_cpp(query):
+    lib = get_library()
+    if lib:
+        # Страницы запрашиваются по мере показа, здесь нужно только число найденных
+        try:
+            total, _ = lib.search(query, 0, 0)
+            return {"count": total, "results": None}
+        except SearchError as e:
+            return {"error": str(e)}
+    return engine_request(query)
+
+def get_page_results(start_idx, end_idx):
+    """Документы текущей страницы: [{"id", "title"}, ...]"""
+    lib = get_library()
+    if lib:
+        _, hits = lib.search(st.session_state.last_query, start_idx, end_idx - start_idx)
+        return [{"id": doc_id, "title": title} for doc_id, title in hits]
+    return st.session_state.results[start_idx:end_idx]
+
+def get_page_snippets(start_idx, end_idx, page_items):
+    """Сниппеты с подсветкой для текущей страницы (по последнему запросу)"""
+    lib = get_library()
+    if lib:
+        try:
+            return {item["id"]: lib.snippet(st.session_state.last_query, item["id"]) for item in page_items}
+        except SearchError:
+            return {}
+    response = engine_request(f":snippets {start_idx} {end_idx - start_idx}")
+    if not response or "error" in response:
+        return {}
+    return {item["id"]: item["snippet"] for item in response.get("snippets", [])}
+
 def get_document_content(doc_id):
-    """Читает текст файла из папки corpus_txt"""
-    filepath = os.path.join(CORPUS_DIR, f"doc_{doc_id}.txt")
-    
-    if not os.path.exists(filepath):
-        return "⚠️ Текст документа не найден на диске (возможно, он не был экспортирован)."
-    
-    try:
-        with open(filepath, "r", encoding="utf-8") as f:
-            return f.read()
-    except Exception as e:
-        return f"Ошибка чтения файла: {e}"
+    """Полный текст документа из сжатого хранилища движка"""
+    lib = get_library()
+    if lib:
+        try:
+            text = lib.document(doc_id)
+        except SearchError as e:
+            return f"Ошибка чтения документа: {e}"
+        return text or "⚠️ Текст документа не найден в хранилище (индекс построен без docs_store.bin)."
+    response = engine_request(f":doc {doc_id}")
+    if not response or "error" in response:
+        return f"Ошибка чтения документа: {response.get('error') if response else 'движок недоступен'}"
+    if not response.get("text"):
+        return "⚠️ Текст документа не найден в хранилище (индекс построен без docs_store.bin)."
+    return response["text"]
 
 
 st.set_page_config(page_title="InfoSearch", page_icon="🔍", layout="wide")
@@ -102,6 +152,24 @@ if "last_query" not in st.session_state:
 st.sidebar.title("Навигация")
 mode = st.sidebar.radio("Меню", ["Поиск", "Справка"])
 
+if st.sidebar.button("Перезагрузить индекс"):
+    # Движок подгружает новый индекс в фоне и продолжает отвечать на запросы по старому
+    lib = get_library()
+    if lib:
+        try:
+            status = "started" if lib.reload() else "in_progress"
+        except SearchError:
+            status = "error"
+    else:
+        response = engine_request(":reload")
+        status = "error" if not response or "error" in response else response.get("reload")
+    if status == "error":
+        st.sidebar.error("Не удалось запустить перезагрузку")
+    elif status == "started":
+        st.sidebar.success("Перезагрузка индекса запущена")
+    else:
+        st.sidebar.info("Перезагрузка уже идет")
+
 if mode == "Справка":
     st.title("Как пользоваться")
     st.info("Поиск поддерживает сложные булевы запросы.")
@@ -144,12 +212,13 @@ else:
             if "error" in response:
                 st.error(f"Ошибка поиска: {response['error']}")
                 st.session_state.results = []
+                st.session_state.count = 0
             else:
-                st.session_state.results = response.get("results", [])
+                st.session_state.results = response.get("results") or []
                 st.session_state.count = response.get("count", 0)
                 st.session_state.time_taken = (end_time - start_time) * 1000 
 
-    if st.session_state.results:
+    if st.session_state.get("count"):
         total = st.session_state.count
         timing = st.session_state.time_taken
         
@@ -166,20 +235,25 @@ else:
         start_idx = st.session_state.page * RESULTS_PER_PAGE
         end_idx = min(start_idx + RESULTS_PER_PAGE, total)
         
-        page_items = st.session_state.results[start_idx:end_idx]
+        page_items = get_page_results(start_idx, end_idx)
         
         st.caption(f"Показаны результаты {start_idx + 1} - {end_idx}")
         
+        snippets = get_page_snippets(start_idx, end_idx, page_items)
+        
         for item in page_items:
             doc_id = item['id']
             title = item['title']
             
-            with st.expander(f"📄 {title}"):
+            with st.expander(f"📄 {title}", expanded=True):
                 st.markdown(f"<div class='doc-meta'>Document ID: {doc_id}</div>", unsafe_allow_html=True)
                 
-                content = get_document_content(doc_id)
+                if snippets.get(doc_id):
+                    st.markdown(snippets[doc_id], unsafe_allow_html=True)
                 
-                st.text_area("Текст документа:", value=content, height=300, disabled=True, key=f"txt_{doc_id}")
+                if st.checkbox("Показать полный текст", key=f"full_{doc_id}"):
+                    content = get_document_content(doc_id)
+                    st.text_area("Текст документа:", value=content, height=300, disabled=True, key=f"txt_{doc_id}")
             
         if total_pages > 1:
             st.write("")
@@ -0,0 +1,104 @@
+"""Обертка ctypes над libsearch: поиск в процессе Python без запуска lab4_search."""
+import ctypes
+import os
+import sys
+import threading
+
+SEARCH_OK = 0
+SEARCH_ERROR_BUFFER_TOO_SMALL = 5
+SEARCH_ERROR_BUSY = 6
+
+LIB_NAME = "libsearch.dll" if sys.platform == "win32" else "libsearch.so"
+
+
+class SearchError(RuntimeError):
+    pass
+
+
+class SearchLibrary:
+    def __init__(self, lib_path, index_dir):
+        self.lib = ctypes.CDLL(lib_path)
+        self._declare()
+
+        handle = ctypes.c_void_p()
+        self._check(self.lib.search_open(index_dir.encode("utf-8"), ctypes.byref(handle)))
+        self.handle = handle
+        # Буфер под тексты свой у каждого потока: объект можно делить между сессиями
+        self._local = threading.local()
+
+    def _declare(self):
+        lib = self.lib
+        u32, u32p = ctypes.c_uint32, ctypes.POINTER(ctypes.c_uint32)
+        sizep = ctypes.POINTER(ctypes.c_size_t)
+
+        lib.search_last_error.restype = ctypes.c_char_p
+        lib.search_open.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_void_p)]
+        lib.search_close.argtypes = [ctypes.c_void_p]
+        lib.search_reload.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        lib.search_doc_count.argtypes = [ctypes.c_void_p]
+        lib.search_doc_count.restype = u32
+        lib.search_query.argtypes = [ctypes.c_void_p, ctypes.c_char_p, u32, u32, u32p, u32, u32p, u32p]
+        lib.search_title.argtypes = [ctypes.c_void_p, u32, ctypes.c_char_p, ctypes.c_size_t, sizep]
+        lib.search_document.argtypes = [ctypes.c_void_p, u32, ctypes.c_char_p, ctypes.c_size_t, sizep]
+        lib.search_snippet.argtypes = [ctypes.c_void_p, ctypes.c_char_p, u32, ctypes.c_char_p, ctypes.c_size_t, sizep]
+
+    def _check(self, code):
+        if code != SEARCH_OK:
+            raise SearchError(self.lib.search_last_error().decode("utf-8", "replace"))
+
+    def close(self):
+        if self.handle:
+            self.lib.search_close(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
+
+    @property
+    def doc_count(self):
+        return self.lib.search_doc_count(self.handle)
+
+    def reload(self, index_dir=None):
+        """Перезагрузка индекса в фоне; False - предыдущая еще идет"""
+        code = self.lib.search_reload(self.handle, index_dir.encode("utf-8") if index_dir else None)
+        if code == SEARCH_ERROR_BUSY:
+            return False
+        self._check(code)
+        return True
+
+    def search(self, query, offset=0, limit=20):
+        """Возвращает (всего найдено, [(doc_id, title), ...]) для страницы offset..offset+limit"""
+        ids = (ctypes.c_uint32 * limit)()
+        count, total = ctypes.c_uint32(), ctypes.c_uint32()
+        self._check(self.lib.search_query(self.handle, query.encode("utf-8"), offset, limit,
+                                          ids, limit, ctypes.byref(count), ctypes.byref(total)))
+        return total.value, [(ids[i], self.title(ids[i])) for i in range(count.value)]
+
+    def title(self, doc_id):
+        return self._read_text(lambda buf, cap, out: self.lib.search_title(self.handle, doc_id, buf, cap, out))
+
+    def _read_text(self, call):
+        buf = getattr(self._local, "buffer", None)
+        if buf is None:
+            buf = self._local.buffer = ctypes.create_string_buffer(64 * 1024)
+        length = ctypes.c_size_t()
+        code = call(buf, len(buf), ctypes.byref(length))
+        if code == SEARCH_ERROR_BUFFER_TOO_SMALL:
+            buf = self._local.buffer = ctypes.create_string_buffer(length.value + 1)
+            code = call(buf, len(buf), ctypes.byref(length))
+        self._check(code)
+        return buf.raw[:length.value].decode("utf-8", "replace")
+
+    def document(self, doc_id):
+        return self._read_text(lambda buf, cap, out: self.lib.search_document(self.handle, doc_id, buf, cap, out))
+
+    def snippet(self, query, doc_id):
+        q = query.encode("utf-8")
+        return self._read_text(lambda buf, cap, out: self.lib.search_snippet(self.handle, q, doc_id, buf, cap, out))
+
+
+def find_library(build_dir):
+    for candidate in (os.path.join(build_dir, LIB_NAME), os.path.join(build_dir, "Release", LIB_NAME)):
+        if os.path.exists(candidate):
+            return candidate
+    return None